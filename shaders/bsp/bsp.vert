@@ -4,6 +4,8 @@ precision lowp float;
 
 uniform mat4 world_matrix;
 uniform mat4 view_projection_matrix;
+uniform vec3 location_offset;
+uniform vec3 location_scale;
 uniform sampler2D diffuse_texture;
 uniform sampler2D lightmap_texture;
 
@@ -15,7 +17,9 @@ out vec2 out_diffuse_texcoord;
 out vec2 out_lightmap_texcoord;
 
 void main() {
-    gl_Position = view_projection_matrix * (world_matrix * vec4(location, 1));
+    //quantised levels store positions relative to the level center, float ones use 0 and 1
+    vec3 world_location = location_offset + (location * location_scale);
+    gl_Position = view_projection_matrix * (world_matrix * vec4(world_location, 1));
 
     //out_normal = normal;
     out_diffuse_texcoord = diffuse_texcoord;
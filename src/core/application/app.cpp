@@ -16,6 +16,7 @@
 //#include "../../device/audio/audioSystem.hpp"
 #include "../../device/gpu/buffers/gpuBufferManager.hpp"
 #include "../../resources/image.hpp"
+#include "../../rendering/commands/renderQueue.hpp"
 
 namespace Core::Application {
     App app;
@@ -122,12 +123,18 @@ namespace Core::Application {
     void App::render() {
         const auto screenSize = Platform::platform.getScreenSize();
 
+        Device::GPU::gpu.stateCache.beginFrame();
         Device::GPU::gpu.viewports.push(Device::GPU::GpuViewportType(0.0f, 0.0f, screenSize.x, screenSize.y));
         Device::GPU::gpu.clear(Device::GPU::Gpu::CLEAR_FLAG_COLOR | Device::GPU::Gpu::CLEAR_FLAG_DEPTH);
 
         Platform::platform.appRenderStart();
         this->game->onRenderStart();
+        //queued draws go out between the scene pass and the overlay pass, so the immediate GUI
+        //drawn in onRenderEnd stays on top of queued world draws
+        Rendering::Commands::renderQueue.flush();
         this->game->onRenderEnd();
+        //whatever the overlay pass queued, e.g. debug outlines, goes over it before the swap
+        Rendering::Commands::renderQueue.flush();
         Platform::platform.appRenderEnd();
 
         Device::GPU::gpu.viewports.pop();
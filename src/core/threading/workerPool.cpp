@@ -0,0 +1,69 @@
+#include "workerPool.hpp"
+
+namespace Core::Threading {
+    WorkerPool workers;
+
+    WorkerPool::WorkerPool(size_t threadCount) {
+        threadCount = std::max<size_t>(1, threadCount);
+        this->threads.reserve(threadCount);
+        for (size_t i = 0; i < threadCount; ++i) {
+            this->threads.emplace_back(&WorkerPool::run, this);
+        }
+    }
+
+    WorkerPool::~WorkerPool() {
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            this->isStopping = true;
+        }
+        this->condition.notify_all();
+        for (std::thread& thread : this->threads) {
+            thread.join();
+        }
+    }
+
+    size_t WorkerPool::defaultThreadCount() {
+        //leave a core for the thread that owns the GL context
+        const unsigned int hardwareConcurrency = std::thread::hardware_concurrency();
+        return hardwareConcurrency > 1 ? hardwareConcurrency - 1 : 1;
+    }
+
+    void WorkerPool::enqueue(JobType job, bool isLoopJob) {
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            (isLoopJob ? this->loopJobs : this->jobs).push_back(std::move(job));
+        }
+        this->condition.notify_one();
+    }
+
+    //parallelFor helpers first, their caller is blocked until the loop is done
+    bool WorkerPool::popJob(JobType& job) {
+        std::deque<JobType>& queue = this->loopJobs.empty() ? this->jobs : this->loopJobs;
+        if (queue.empty()) return false;
+        job = std::move(queue.front());
+        queue.pop_front();
+        return true;
+    }
+
+    bool WorkerPool::tryRunJob() {
+        JobType job;
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            if (!popJob(job)) return false;
+        }
+        job();
+        return true;
+    }
+
+    void WorkerPool::run() {
+        for (;;) {
+            JobType job;
+            {
+                std::unique_lock<std::mutex> lock(this->mutex);
+                this->condition.wait(lock, [this]() { return this->isStopping || !this->jobs.empty() || !this->loopJobs.empty(); });
+                if (!popJob(job)) return;
+            }
+            job();
+        }
+    }
+}
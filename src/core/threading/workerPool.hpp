@@ -0,0 +1,190 @@
+#pragma once
+
+#ifndef QUAKE_WORKERPOOL_HPP
+#define QUAKE_WORKERPOOL_HPP
+
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <future>
+#include <memory>
+#include <exception>
+#include <functional>
+#include <type_traits>
+#include <condition_variable>
+
+namespace Core::Threading {
+    struct WorkerPool {
+        typedef std::function<void()> JobType;
+
+        explicit WorkerPool(size_t threadCount = defaultThreadCount());
+        ~WorkerPool();
+
+        template<typename F>
+        std::future<std::invoke_result_t<F>> submit(F&& f) {
+            typedef std::invoke_result_t<F> ResultType;
+            auto task = std::make_shared<std::packaged_task<ResultType()>>(std::forward<F>(f));
+            std::future<ResultType> future = task->get_future();
+            enqueue([task]() { (*task)(); });
+            return future;
+        }
+
+        // Blocks until the future is ready. The waiting thread runs queued jobs in the
+        // meantime, so jobs may wait on other jobs without starving the pool.
+        template<typename T>
+        T wait(std::future<T>& future) {
+            while (future.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+                if (!tryRunJob()) {
+                    future.wait_for(std::chrono::microseconds(100));
+                }
+            }
+            return future.get();
+        }
+
+        // Waits for every future before rethrowing the first exception, so no job is left
+        // running against state owned by the caller.
+        template<typename T>
+        void wait(std::vector<std::future<T>>& futures) {
+            std::exception_ptr exception;
+            for (std::future<T>& future : futures) {
+                try {
+                    wait(future);
+                } catch (...) {
+                    if (!exception) exception = std::current_exception();
+                }
+            }
+            if (exception) std::rethrow_exception(exception);
+        }
+
+        // Runs fn(chunkBegin, chunkEnd) over [begin, end) split into chunks of at least grainSize.
+        // Chunks are claimed from a counter owned by this call, so the calling thread only ever
+        // runs chunks of its own loop and never picks up unrelated queued jobs. The helper jobs
+        // go ahead of ordinary jobs, a per-frame loop does not queue behind a level load.
+        template<typename F>
+        void parallelFor(size_t begin, size_t end, size_t grainSize, F&& fn) {
+            if (begin >= end) return;
+            const size_t count = end - begin;
+            const size_t maxChunkCount = std::max<size_t>(1, std::min(count / std::max<size_t>(1, grainSize), getThreadCount() * 4));
+            const size_t chunkSize = (count + maxChunkCount - 1) / maxChunkCount;
+            const size_t chunkCount = (count + chunkSize - 1) / chunkSize;
+            if (chunkCount == 1) {
+                fn(begin, end);
+                return;
+            }
+
+            //helpers that start after every chunk was claimed return without touching fn
+            auto loop = std::make_shared<LoopState>(chunkCount);
+            auto runChunks = [loop, &fn, begin, end, chunkSize]() {
+                for (;;) {
+                    const size_t chunk = loop->nextChunk.fetch_add(1);
+                    if (chunk >= loop->chunkCount) return;
+
+                    const size_t chunkBegin = begin + chunk * chunkSize;
+                    std::exception_ptr exception;
+                    try {
+                        fn(chunkBegin, std::min(end, chunkBegin + chunkSize));
+                    } catch (...) {
+                        exception = std::current_exception();
+                    }
+
+                    std::lock_guard<std::mutex> lock(loop->mutex);
+                    if (exception && !loop->exception) loop->exception = exception;
+                    if (++loop->finishedCount == loop->chunkCount) loop->condition.notify_all();
+                }
+            };
+
+            const size_t helperCount = std::min(chunkCount - 1, getThreadCount());
+            for (size_t i = 0; i < helperCount; ++i) {
+                enqueue(runChunks, true);
+            }
+            runChunks();
+
+            //the chunks still running reference fn, so they must finish first
+            std::unique_lock<std::mutex> lock(loop->mutex);
+            loop->condition.wait(lock, [&loop]() { return loop->finishedCount == loop->chunkCount; });
+            if (loop->exception) std::rethrow_exception(loop->exception);
+        }
+
+        [[nodiscard]] size_t getThreadCount() const { return this->threads.size(); }
+
+        static size_t defaultThreadCount();
+
+    private:
+        struct LoopState {
+            explicit LoopState(size_t chunkCount) : chunkCount(chunkCount) { }
+
+            const size_t chunkCount;
+            std::atomic<size_t> nextChunk { 0 };
+            size_t finishedCount = 0;
+            std::exception_ptr exception;
+            std::mutex mutex;
+            std::condition_variable condition;
+        };
+
+        void enqueue(JobType job, bool isLoopJob = false);
+        bool tryRunJob();
+        bool popJob(JobType& job);
+        void run();
+
+        std::vector<std::thread> threads;
+        std::deque<JobType> jobs;
+        std::deque<JobType> loopJobs;
+        std::mutex mutex;
+        std::condition_variable condition;
+        bool isStopping = false;
+
+        WorkerPool(const WorkerPool&) = delete;
+        WorkerPool& operator=(const WorkerPool&) = delete;
+    };
+
+    // Waits on the futures it was handed when it goes out of scope. Jobs that reference the
+    // caller's locals then cannot outlive them when the caller unwinds from an exception.
+    // Declare it after everything those jobs touch. Futures already waited on are skipped, and
+    // job exceptions are dropped here, since the caller either saw them or is already unwinding.
+    struct FutureGuard {
+        explicit FutureGuard(WorkerPool& pool) : pool(pool) { }
+        ~FutureGuard() {
+            for (auto itr = this->waits.rbegin(); itr != this->waits.rend(); ++itr) {
+                (*itr)();
+            }
+        }
+
+        template<typename T>
+        void add(std::future<T>& future) {
+            this->waits.emplace_back([this, &future]() { finish(future); });
+        }
+
+        template<typename T>
+        void add(std::vector<std::future<T>>& futures) {
+            this->waits.emplace_back([this, &futures]() {
+                for (std::future<T>& future : futures) {
+                    finish(future);
+                }
+            });
+        }
+
+    private:
+        WorkerPool& pool;
+        std::vector<std::function<void()>> waits;
+
+        template<typename T>
+        void finish(std::future<T>& future) {
+            if (!future.valid()) return;
+            try {
+                this->pool.wait(future);
+            } catch (...) {
+            }
+        }
+
+        FutureGuard(const FutureGuard&) = delete;
+        FutureGuard& operator=(const FutureGuard&) = delete;
+    };
+
+    extern WorkerPool workers;
+}
+
+#endif //QUAKE_WORKERPOOL_HPP
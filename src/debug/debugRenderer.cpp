@@ -33,9 +33,9 @@ namespace Debug::Renderer {
         const boost::shared_ptr<Device::GPU::Shaders::Programs::BasicShader> gpuProgram = Device::GPU::Shaders::shaders.get<Device::GPU::Shaders::Programs::BasicShader>();
         Device::GPU::gpu.programs.push(gpuProgram);
 
-        Device::GPU::gpu.setUniform("world_matrix", world_matrix);
-        Device::GPU::gpu.setUniform("view_projection_matrix", view_projection_matrix);
-        Device::GPU::gpu.setUniform("color", glm::vec4(1));
+        gpuProgram->worldMatrix.set(world_matrix);
+        gpuProgram->viewProjectionMatrix.set(view_projection_matrix);
+        gpuProgram->color.set(glm::vec4(1));
 
         boost::shared_ptr<Resources::Texture> texture = Resources::resources.get<Resources::Texture>("white.png");
         Device::GPU::gpu.textures.bind(0, texture);
@@ -47,4 +47,21 @@ namespace Debug::Renderer {
         Device::GPU::gpu.buffers.pop(Device::GPU::Gpu::BufferTarget::ELEMENT_ARRAY);
         Device::GPU::gpu.buffers.pop(Device::GPU::Gpu::BufferTarget::ARRAY);
     }
+
+    void RectanglePacket::execute(const RectanglePacket& packet) {
+        Device::GPU::Gpu::Depth::State depthState = Device::GPU::gpu.depth.getState();
+        depthState.shouldTest = false;
+        Device::GPU::gpu.depth.pushState(depthState);
+        renderRectangle(packet.worldMatrix, packet.viewProjectionMatrix, Scenes::Structure::Rectangle<float>(0.0f, 0.0f, 1.0f, 1.0f), packet.color);
+        Device::GPU::gpu.depth.popState();
+    }
+
+    Rendering::Commands::CommandBuffer& getCommandBuffer() {
+        thread_local Rendering::Commands::CommandBuffer commandBuffer;
+        return commandBuffer;
+    }
+
+    void submit() {
+        Rendering::Commands::renderQueue.submit(getCommandBuffer());
+    }
 }
\ No newline at end of file
@@ -3,6 +3,8 @@
 #ifndef QUAKE_DEBUGRENDERER_HPP
 #define QUAKE_DEBUGRENDERER_HPP
 
+#include <glm/gtc/matrix_transform.hpp>
+
 #include "../device/gpu/buffers/vertexBuffer.hpp"
 #include "../device/gpu/buffers/indexBuffer.hpp"
 #include "../device/gpu/shaders/shaderManager.hpp"
@@ -13,6 +15,7 @@
 #include "../resources/texture.hpp"
 #include "../resources/resourceManager.hpp"
 #include "../device/gpu/buffers/gpuBufferManager.hpp"
+#include "../rendering/commands/renderQueue.hpp"
 
 namespace Debug::Renderer {
     inline void renderLineLoop(const glm::mat4& world_matrix, const glm::mat4& view_projection_matrix, const std::vector<glm::vec3>& points, const glm::vec4& color) {
@@ -62,10 +65,10 @@ namespace Debug::Renderer {
         boost::shared_ptr<Resources::Texture> texture = Resources::resources.get<Resources::Texture>("white.png");
         Device::GPU::gpu.textures.bind(0, texture);
 
-        Device::GPU::gpu.setUniform("world_matrix", world_matrix);
-        Device::GPU::gpu.setUniform("view_projection_matrix", view_projection_matrix);
-        Device::GPU::gpu.setUniform("color", color);
-        Device::GPU::gpu.setUniform("diffuse_texture", 0);
+        gpuProgram->worldMatrix.set(world_matrix);
+        gpuProgram->viewProjectionMatrix.set(view_projection_matrix);
+        gpuProgram->color.set(color);
+        gpuProgram->diffuseTexture.set(0);
 
         Device::GPU::gpu.drawElements(Device::GPU::Gpu::PrimitiveType::LINE_STRIP, points.size(), IndexBufferType::DATA_TYPE, 0);
         Device::GPU::gpu.textures.unbind(0);
@@ -108,9 +111,9 @@ namespace Debug::Renderer {
         auto texture = Resources::resources.get<Resources::Texture>("white.png");
         Device::GPU::gpu.textures.bind(0, texture);
 
-        Device::GPU::gpu.setUniform("world_matrix", world_matrix * glm::translate(vec3(rectangle.x, rectangle.y, T(0))) * glm::scale(vec3(rectangle.width, rectangle.height, T(0))));
-        Device::GPU::gpu.setUniform("view_projection_matrix", view_projection_matrix);
-        Device::GPU::gpu.setUniform("color", color);
+        gpuProgram->worldMatrix.set(world_matrix * glm::translate(glm::mat4(1.0f), glm::vec3(rectangle.x, rectangle.y, 0.0f)) * glm::scale(glm::mat4(1.0f), glm::vec3(rectangle.width, rectangle.height, 0.0f)));
+        gpuProgram->viewProjectionMatrix.set(view_projection_matrix);
+        gpuProgram->color.set(color);
 
         Device::GPU::gpu.drawElements(is_filled ? Device::GPU::Gpu::PrimitiveType::TRIANGLE_FAN : Device::GPU::Gpu::PrimitiveType::LINE_LOOP, 4, IndexBufferType::DATA_TYPE, 0);
         Device::GPU::gpu.textures.unbind(0);
@@ -120,6 +123,32 @@ namespace Debug::Renderer {
         Device::GPU::gpu.buffers.pop(Device::GPU::Gpu::BufferTarget::ARRAY);
     }
 
+    // Rectangle outline recorded for the RenderQueue. worldMatrix already maps the unit square onto
+    // the rectangle. It draws at the next flush, over the frame's immediate draws and without
+    // depth testing.
+    struct RectanglePacket {
+        glm::mat4 worldMatrix;
+        glm::mat4 viewProjectionMatrix;
+        glm::vec4 color;
+
+        static void execute(const RectanglePacket& packet);
+    };
+
+    // This thread's debug draws, handed to the RenderQueue by submit.
+    Rendering::Commands::CommandBuffer& getCommandBuffer();
+    void submit();
+
+    template<typename T>
+    void queueRectangle(const glm::mat4& world_matrix, const glm::mat4& view_projection_matrix, const Scenes::Structure::Rectangle<T>& rectangle, const glm::vec4& color) {
+        RectanglePacket packet;
+        packet.worldMatrix = world_matrix * glm::translate(glm::mat4(1.0f), glm::vec3(rectangle.x, rectangle.y, 0.0f)) * glm::scale(glm::mat4(1.0f), glm::vec3(rectangle.width, rectangle.height, 0.0f));
+        packet.viewProjectionMatrix = view_projection_matrix;
+        packet.color = color;
+
+        //equal keys keep the recording order, so outlines overlap like immediate draws would
+        getCommandBuffer().record(Rendering::Commands::RenderKey::make(Rendering::Commands::RenderKey::Layer::DEBUG, 0, 0, 0.0f), packet);
+    }
+
     void renderAxes(const glm::mat4& world_matrix, const glm::mat4& view_projection_matrix);
 
     template<typename T>
@@ -156,9 +185,9 @@ namespace Debug::Renderer {
         const boost::shared_ptr<Device::GPU::Shaders::Programs::BasicShader> gpuProgram = Device::GPU::Shaders::shaders.get<Device::GPU::Shaders::Programs::BasicShader>();
         Device::GPU::gpu.programs.push(gpuProgram);
 
-        Device::GPU::gpu.setUniform("world_matrix", world_matrix * glm::translate(aabb.min) * glm::scale(aabb.size()));
-        Device::GPU::gpu.setUniform("view_projection_matrix", view_projection_matrix);
-        Device::GPU::gpu.setUniform("color", color);
+        gpuProgram->worldMatrix.set(world_matrix * glm::translate(aabb.min) * glm::scale(aabb.size()));
+        gpuProgram->viewProjectionMatrix.set(view_projection_matrix);
+        gpuProgram->color.set(color);
 
         boost::shared_ptr<Resources::Texture> texture = Resources::resources.get<Resources::Texture>("white.png");
         Device::GPU::gpu.textures.bind(0, texture);
@@ -221,9 +250,9 @@ namespace Debug::Renderer {
         const boost::shared_ptr<Device::GPU::Shaders::Programs::BasicShader> gpuProgram = Device::GPU::Shaders::shaders.get<Device::GPU::Shaders::Programs::BasicShader>();
         Device::GPU::gpu.programs.push(gpuProgram);
 
-        Device::GPU::gpu.setUniform("world_matrix", world_matrix * glm::translate(sphere.origin) * glm::scale(vec3(sphere.radius)));
-        Device::GPU::gpu.setUniform("view_projection_matrix", view_projection_matrix);
-        Device::GPU::gpu.setUniform("color", color);
+        gpuProgram->worldMatrix.set(world_matrix * glm::translate(sphere.origin) * glm::scale(vec3(sphere.radius)));
+        gpuProgram->viewProjectionMatrix.set(view_projection_matrix);
+        gpuProgram->color.set(color);
 
         boost::shared_ptr<Resources::Texture> texture = Resources::resources.get<Resources::Texture>("white.png");
         Device::GPU::gpu.textures.bind(0, texture);
@@ -0,0 +1,79 @@
+#include "occlusionBenchmark.hpp"
+
+#include <chrono>
+#include <random>
+#include <vector>
+#include <glm/ext.hpp>
+#include <spdlog/spdlog.h>
+
+#include "../rendering/scene/bsp/bsp.hpp"
+#include "../platform/game/components/cameraParams.hpp"
+
+namespace Debug::OcclusionBenchmark {
+    Result run(Rendering::Scene::BSP& bsp, size_t viewCount, uint32_t seed) {
+        typedef Rendering::Scene::BSP BSP;
+        typedef std::chrono::steady_clock Clock;
+        static const float FOV = 90.0f;
+        static const float ASPECT = 16.0f / 9.0f;
+        static const float NEAR = 4.0f;
+        static const float FAR = 8192.0f;
+        static const size_t MAX_ATTEMPT_COUNT = 64;
+
+        const ::Scenes::Structure::AABB3<float> bounds = bsp.getWorldBounds();
+        std::mt19937 random(seed);
+        std::uniform_real_distribution<float> x(bounds.min.x, bounds.max.x);
+        std::uniform_real_distribution<float> y(bounds.min.y, bounds.max.y);
+        std::uniform_real_distribution<float> z(bounds.min.z, bounds.max.z);
+        std::uniform_real_distribution<float> yaw(0.0f, glm::two_pi<float>());
+
+        //cameras only go where a player could stand, random points mostly land in solid
+        std::vector<Platform::Game::Components::CameraParameters> views;
+        views.reserve(viewCount);
+        for (size_t i = 0; i < viewCount * MAX_ATTEMPT_COUNT && views.size() < viewCount; ++i) {
+            const glm::vec3 location(x(random), y(random), z(random));
+            const BSP::ContentType contents = bsp.getContents(location);
+            if (contents == BSP::ContentType::SOLID || contents == BSP::ContentType::SKY) continue;
+
+            const float angle = yaw(random);
+            const glm::vec3 forward(glm::sin(angle), 0.0f, glm::cos(angle));
+            const glm::vec3 up(0.0f, 1.0f, 0.0f);
+            const glm::vec3 left = glm::normalize(glm::cross(up, forward));
+
+            Platform::Game::Components::CameraParameters view;
+            view.location = location;
+            view.projectionMatrix = glm::perspective(glm::radians(FOV), ASPECT, NEAR, FAR);
+            view.viewMatrix = glm::lookAt(location, location + forward, up);
+            view.frustum.set(location, left, up, forward, FOV, NEAR, FAR, ASPECT);
+            views.push_back(view);
+        }
+
+        Result result;
+        result.viewCount = views.size();
+        const bool wasOcclusionCulling = bsp.renderSettings.useOcclusionCulling;
+
+        bsp.renderSettings.useOcclusionCulling = false;
+        const Clock::time_point pvsStart = Clock::now();
+        for (const Platform::Game::Components::CameraParameters& view : views) {
+            result.pvsLeafCount += bsp.collectVisibleLeaves(view).size();
+        }
+        result.pvsSeconds = std::chrono::duration<double>(Clock::now() - pvsStart).count();
+
+        bsp.renderSettings.useOcclusionCulling = true;
+        const Clock::time_point occlusionStart = Clock::now();
+        for (const Platform::Game::Components::CameraParameters& view : views) {
+            //render stats add up until the next render, only the change belongs to this view
+            const unsigned int occluderCount = bsp.geRenderStats().occluderCount;
+            result.visibleLeafCount += bsp.collectVisibleLeaves(view).size();
+            result.occluderCount += bsp.geRenderStats().occluderCount - occluderCount;
+        }
+        result.occlusionSeconds = std::chrono::duration<double>(Clock::now() - occlusionStart).count();
+        bsp.renderSettings.useOcclusionCulling = wasOcclusionCulling;
+
+        spdlog::info("Occlusion over {} views: {} of {} leaves hidden ({:.1f}%) by {:.1f} occluders a view, {:.3f} ms a view without, {:.3f} ms with",
+                     result.viewCount, result.pvsLeafCount - result.visibleLeafCount, result.pvsLeafCount, result.getOccludedRatio() * 100.0,
+                     result.viewCount > 0 ? static_cast<double>(result.occluderCount) / result.viewCount : 0.0,
+                     result.viewCount > 0 ? result.pvsSeconds * 1000.0 / result.viewCount : 0.0,
+                     result.viewCount > 0 ? result.occlusionSeconds * 1000.0 / result.viewCount : 0.0);
+        return result;
+    }
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#ifndef QUAKE_OCCLUSIONBENCHMARK_HPP
+#define QUAKE_OCCLUSIONBENCHMARK_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Rendering::Scene { class BSP; }
+
+namespace Debug::OcclusionBenchmark {
+    struct Result {
+        size_t viewCount = 0;
+        size_t pvsLeafCount = 0;        //leaves left by the PVS and frustum, summed over every view
+        size_t visibleLeafCount = 0;    //leaves left once occluded ones are dropped
+        size_t occluderCount = 0;
+        double pvsSeconds = 0.0;
+        double occlusionSeconds = 0.0;
+
+        [[nodiscard]] double getOccludedRatio() const { return pvsLeafCount > 0 ? 1.0 - (static_cast<double>(visibleLeafCount) / pvsLeafCount) : 0.0; }
+    };
+
+    // Collects the visible leaves from viewCount random camera placements inside the level, once
+    // with occlusion culling off and once with it on, and logs how many leaves it removed and what
+    // it cost. Runs without a GPU, so the level can be loaded with shouldUpload off.
+    Result run(Rendering::Scene::BSP& bsp, size_t viewCount, uint32_t seed = 0);
+}
+
+#endif //QUAKE_OCCLUSIONBENCHMARK_HPP
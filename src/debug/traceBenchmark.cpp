@@ -0,0 +1,59 @@
+#include "traceBenchmark.hpp"
+
+#include <chrono>
+#include <random>
+#include <vector>
+#include <spdlog/spdlog.h>
+
+#include "../rendering/scene/bsp/bsp.hpp"
+
+namespace Debug::TraceBenchmark {
+    Result run(const Rendering::Scene::BSP& bsp, size_t rayCount, uint32_t seed) {
+        typedef Rendering::Scene::BSP BSP;
+        typedef std::chrono::steady_clock Clock;
+        static const float SPREAD = 64.0f;
+        static const float LENGTH = 1024.0f;
+
+        const ::Scenes::Structure::AABB3<float> bounds = bsp.getWorldBounds();
+        std::mt19937 random(seed);
+        std::uniform_real_distribution<float> x(bounds.min.x, bounds.max.x);
+        std::uniform_real_distribution<float> y(bounds.min.y, bounds.max.y);
+        std::uniform_real_distribution<float> z(bounds.min.z, bounds.max.z);
+        std::uniform_real_distribution<float> spread(-SPREAD, SPREAD);
+        std::normal_distribution<float> direction(0.0f, 1.0f);
+
+        std::vector<BSP::TraceArgs> args(rayCount);
+        glm::vec3 shooter;
+        glm::vec3 aim;
+        for (size_t i = 0; i < rayCount; ++i) {
+            if (i % BSP::TRACE_PACKET_SIZE == 0) {
+                shooter = glm::vec3(x(random), y(random), z(random));
+                aim = glm::normalize(glm::vec3(direction(random), direction(random), direction(random)) + glm::vec3(0.0f, 0.0f, 1e-6f));
+            }
+            args[i].line.start = shooter;
+            args[i].line.end = shooter + (aim * LENGTH) + glm::vec3(spread(random), spread(random), spread(random));
+        }
+
+        Result result;
+        result.rayCount = rayCount;
+        std::vector<BSP::TraceResult> results(rayCount);
+
+        const Clock::time_point singleStart = Clock::now();
+        for (size_t i = 0; i < rayCount; ++i) {
+            results[i] = bsp.trace(args[i]);
+        }
+        result.singleSeconds = std::chrono::duration<double>(Clock::now() - singleStart).count();
+
+        const Clock::time_point batchStart = Clock::now();
+        bsp.trace(args, results);
+        result.batchSeconds = std::chrono::duration<double>(Clock::now() - batchStart).count();
+
+        for (const BSP::TraceResult& traceResult : results) {
+            if (traceResult.didHit) ++result.hitCount;
+        }
+
+        spdlog::info("Traced {} rays ({} hits): {:.0f} rays/s single, {:.0f} rays/s batched",
+                     result.rayCount, result.hitCount, result.getSingleRaysPerSecond(), result.getBatchRaysPerSecond());
+        return result;
+    }
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#ifndef QUAKE_TRACEBENCHMARK_HPP
+#define QUAKE_TRACEBENCHMARK_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Rendering::Scene { class BSP; }
+
+namespace Debug::TraceBenchmark {
+    struct Result {
+        size_t rayCount = 0;
+        size_t hitCount = 0;
+        double singleSeconds = 0.0;
+        double batchSeconds = 0.0;
+
+        [[nodiscard]] double getSingleRaysPerSecond() const { return singleSeconds > 0.0 ? rayCount / singleSeconds : 0.0; }
+        [[nodiscard]] double getBatchRaysPerSecond() const { return batchSeconds > 0.0 ? rayCount / batchSeconds : 0.0; }
+    };
+
+    // Fires rayCount random point-hull segments through the world model, once one at a time and
+    // once through the batched API, and logs both throughputs. Segments are short and clustered
+    // per packet, like pellets or line of sight probes from a handful of shooters.
+    Result run(const Rendering::Scene::BSP& bsp, size_t rayCount, uint32_t seed = 0);
+}
+
+#endif //QUAKE_TRACEBENCHMARK_HPP
@@ -20,6 +20,35 @@
 namespace Device::GPU {
     Gpu gpu;
 
+    //makes the GL calls for the values GpuStateCache lets through
+    struct GlStateDriver {
+        void setBlendEnabled(bool isEnabled) { setEnabled(GL_BLEND, isEnabled); }
+        void setBlendFunction(const std::array<unsigned int, 2>& function) { glBlendFunc(function[0], function[1]); glCheckError(); }
+        void setBlendEquation(unsigned int equation) { glBlendEquation(equation); glCheckError(); }
+        void setDepthTestEnabled(bool isEnabled) { setEnabled(GL_DEPTH_TEST, isEnabled); }
+        void setDepthWriteMask(bool mask) { glDepthMask(mask ? GL_TRUE : GL_FALSE); glCheckError(); }
+        void setDepthFunction(unsigned int function) { glDepthFunc(function); glCheckError(); }
+        void setCullingEnabled(bool isEnabled) { setEnabled(GL_CULL_FACE, isEnabled); }
+        void setFrontFace(unsigned int frontFace) { glFrontFace(frontFace); glCheckError(); }
+        void setCullFace(unsigned int cullFace) { glCullFace(cullFace); glCheckError(); }
+        void setStencilEnabled(bool isEnabled) { setEnabled(GL_STENCIL_TEST, isEnabled); }
+        void setStencilFunction(const std::array<unsigned int, 3>& function) { glStencilFunc(function[0], static_cast<GLint>(function[1]), function[2]); glCheckError(); }
+        void setStencilOperations(const std::array<unsigned int, 3>& operations) { glStencilOp(operations[0], operations[1], operations[2]); glCheckError(); }
+        void setStencilMask(unsigned int mask) { glStencilMask(mask); glCheckError(); }
+        void setColorMask(const std::array<bool, 4>& mask) {
+            glColorMask(mask[0] ? GL_TRUE : GL_FALSE, mask[1] ? GL_TRUE : GL_FALSE, mask[2] ? GL_TRUE : GL_FALSE, mask[3] ? GL_TRUE : GL_FALSE); glCheckError();
+        }
+
+    private:
+        static void setEnabled(GLenum capability, bool isEnabled) {
+            if (isEnabled) {
+                glEnable(capability); glCheckError();
+            } else {
+                glDisable(capability); glCheckError();
+            }
+        }
+    };
+
     inline GLenum getBufferTarget(Gpu::BufferTarget buffer_target) {
         switch (buffer_target) {
             case Gpu::BufferTarget::ARRAY:
@@ -253,6 +282,8 @@ namespace Device::GPU {
                 return GL_INT;
             case GpuDataTypes::UNSIGNED_INT:
                 return GL_UNSIGNED_INT;
+            case GpuDataTypes::HALF_FLOAT:
+                return GL_HALF_FLOAT;
             case GpuDataTypes::FLOAT:
                 return GL_FLOAT;
             case GpuDataTypes::DOUBLE:
@@ -394,22 +425,53 @@ namespace Device::GPU {
         glDeleteFramebuffers(1, &id);
     }
 
-    GpuId Gpu::createTexture(ColorType color_type, glm::uvec2 size, const void* data) {
+    GpuId Gpu::createTexture(ColorType color_type, glm::uvec2 size, const void* data, unsigned int levelCount) {
         size = glm::max(glm::uvec2(1), size);
+        levelCount = glm::max(levelCount, 1u);
 
         GpuId id;
         glGenTextures(1, &id); glCheckError();
         glBindTexture(GL_TEXTURE_2D, id); glCheckError();
 
-        GLint unpackAlignment;
-        glGetIntegerv(GL_UNPACK_ALIGNMENT, &unpackAlignment); glCheckError();
-        glPixelStorei(GL_UNPACK_ALIGNMENT, 1); glCheckError();
+        setUnpackAlignment(1);
 
         Resources::Texture::FormatType internalFormat, format;
         Resources::Texture::TypeType type;
         getTextureFormats(color_type, internalFormat, format, type);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR); glCheckError();
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, levelCount > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR); glCheckError();
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR); glCheckError();
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(levelCount - 1)); glCheckError();
+
+        //levels are packed back to back in data, largest first
+        const auto* levelData = static_cast<const unsigned char*>(data);
+        for (unsigned int level = 0; level < levelCount; ++level) {
+            const glm::uvec2 levelSize = glm::max(glm::uvec2(1), size >> level);
+            glTexImage2D(
+                    GL_TEXTURE_2D,
+                    static_cast<GLint>(level),
+                    internalFormat,
+                    levelSize.x,
+                    levelSize.y,
+                    0,
+                    format,
+                    type,
+                    levelData
+            ); glCheckError();
+            if (levelData != nullptr) {
+                levelData += static_cast<size_t>(levelSize.x) * levelSize.y * getBytesPerPixel(color_type);
+            }
+        }
+        glBindTexture(GL_TEXTURE_2D, 0); glCheckError();
+
+        return id;
+    }
+
+    void Gpu::resizeTexture(const boost::shared_ptr<Resources::Texture>& texture, glm::uvec2 size) {
+        Resources::Texture::FormatType internalFormat, format;
+        Resources::Texture::TypeType type;
+        size = glm::max(glm::uvec2(1), size);
+        getTextureFormats(texture->getColorType(), internalFormat, format, type);
+        glBindTexture(GL_TEXTURE_2D, texture->get_id()); glCheckError();
         glTexImage2D(
                 GL_TEXTURE_2D,
                 0,
@@ -419,34 +481,41 @@ namespace Device::GPU {
                 0,
                 format,
                 type,
-                data
+                nullptr
         ); glCheckError();
-        glPixelStorei(GL_UNPACK_ALIGNMENT, unpackAlignment); glCheckError();
         glBindTexture(GL_TEXTURE_2D, 0); glCheckError();
-
-        return id;
     }
 
-    void Gpu::resizeTexture(const boost::shared_ptr<Resources::Texture>& texture, glm::uvec2 size) {
+    void Gpu::updateTexture(const boost::shared_ptr<Resources::Texture>& texture, glm::uvec2 offset, glm::uvec2 size, const void* data) {
+        if (size.x == 0 || size.y == 0) return;
+
         Resources::Texture::FormatType internalFormat, format;
         Resources::Texture::TypeType type;
-        size = glm::max(glm::uvec2(1), size);
         getTextureFormats(texture->getColorType(), internalFormat, format, type);
         glBindTexture(GL_TEXTURE_2D, texture->get_id()); glCheckError();
-        glTexImage2D(
+
+        setUnpackAlignment(1);
+
+        glTexSubImage2D(
                 GL_TEXTURE_2D,
                 0,
-                internalFormat,
+                offset.x,
+                offset.y,
                 size.x,
                 size.y,
-                0,
                 format,
                 type,
-                nullptr
+                data
         ); glCheckError();
         glBindTexture(GL_TEXTURE_2D, 0); glCheckError();
     }
 
+    void Gpu::setUnpackAlignment(int alignment) {
+        if (this->stateCache.update(this->stateCache.unpackAlignment, alignment)) {
+            glPixelStorei(GL_UNPACK_ALIGNMENT, alignment); glCheckError();
+        }
+    }
+
     void Gpu::destroyTexture(GpuId id) {
         glDeleteTextures(1, &id); glCheckError();
     }
@@ -456,6 +525,24 @@ namespace Device::GPU {
         return uniformLocation;
     }
 
+    std::vector<std::string> Gpu::getActiveUniformNames(GpuId program_id) const {
+        GLint uniformCount = 0;
+        GLint maxNameLength = 0;
+        glGetProgramiv(program_id, GL_ACTIVE_UNIFORMS, &uniformCount); glCheckError();
+        glGetProgramiv(program_id, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength); glCheckError();
+
+        std::vector<std::string> names;
+        std::vector<GLchar> name(std::max(maxNameLength, 1));
+        for (GLint i = 0; i < uniformCount; ++i) {
+            GLsizei nameLength = 0;
+            GLint size = 0;
+            GLenum type = 0;
+            glGetActiveUniform(program_id, static_cast<GLuint>(i), static_cast<GLsizei>(name.size()), &nameLength, &size, &type, name.data()); glCheckError();
+            names.emplace_back(name.data(), nameLength);
+        }
+        return names;
+    }
+
     GpuLocation Gpu::getAttributeLocation(GpuId program_id, const char* name) const {
         int attributeLocation = glGetAttribLocation(program_id, name); glCheckError();
         return attributeLocation;
@@ -483,43 +570,83 @@ namespace Device::GPU {
         glVertexAttribIPointer(location, size, getDataType(dataType), stride, pointer); glCheckError();
     }
 
+    //the bound program's handle for name, values it already holds are skipped
+    template<typename T>
+    static void setProgramUniform(const Gpu::ProgramManager& programs, const char* name, const T& value) {
+        programs.top()->lock()->getUniform<T>(Utils::fnv1a(name)).set(value);
+    }
+
     void Gpu::setUniform(const char* name, const glm::mat3& value, bool shouldTranpose) const {
-        glUniformMatrix3fv(getUniformLocation(this->programs.top()->lock()->getId(), name), 1, shouldTranpose, glm::value_ptr(value)); glCheckError();
+        setProgramUniform(this->programs, name, shouldTranpose ? glm::transpose(value) : value);
     }
 
     void Gpu::setUniform(const char* name, const glm::mat4& value, bool shouldTranpose) const {
-        glUniformMatrix4fv(getUniformLocation(this->programs.top()->lock()->getId(), name), 1, shouldTranpose, glm::value_ptr(value)); glCheckError();
+        setProgramUniform(this->programs, name, shouldTranpose ? glm::transpose(value) : value);
     }
 
     void Gpu::setUniform(const char* name, int value) const {
-        glUniform1i(getUniformLocation(this->programs.top()->lock()->getId(), name), value); glCheckError();
+        setProgramUniform(this->programs, name, value);
     }
 
     void Gpu::setUniform(const char* name, unsigned int value) const {
-        glUniform1i(getUniformLocation(this->programs.top()->lock()->getId(), name), value); glCheckError();
+        setProgramUniform(this->programs, name, value);
     }
 
     void Gpu::setUniform(const char* name, float value) const {
-        glUniform1f(getUniformLocation(this->programs.top()->lock()->getId(), name), value); glCheckError();
+        setProgramUniform(this->programs, name, value);
     }
 
     void Gpu::setUniform(const char* name, const glm::vec2& value) const {
-        glUniform2fv(getUniformLocation(this->programs.top()->lock()->getId(), name), 1, glm::value_ptr(value)); glCheckError();
+        setProgramUniform(this->programs, name, value);
     }
 
     void Gpu::setUniform(const char* name, const glm::vec3& value) const {
-        glUniform3fv(getUniformLocation(this->programs.top()->lock()->getId(), name), 1, glm::value_ptr(value)); glCheckError();
+        setProgramUniform(this->programs, name, value);
     }
 
     void Gpu::setUniform(const char* name, const glm::vec4& value) const {
-        glUniform4fv(getUniformLocation(this->programs.top()->lock()->getId(), name), 1, glm::value_ptr(value)); glCheckError();
+        setProgramUniform(this->programs, name, value);
     }
 
     void Gpu::setUniform(const char* name, const std::vector<glm::mat4>& value, bool shouldTranspose) const {
-        const GLfloat* f = reinterpret_cast<const GLfloat*>(value.data());
-        float d = f[17];
-        ValueWrapper<int, -1> loc = getUniformLocation(this->programs.top()->lock()->getId(), name);
-        glUniformMatrix4fv(loc, static_cast<GLsizei>(value.size()), shouldTranspose ? GL_TRUE : GL_FALSE, f); glCheckError();
+        const boost::shared_ptr<Shaders::Shader> shader = this->programs.top()->lock();
+        const Shaders::Shader::UniformNameHash nameHash = Utils::fnv1a(name);
+        //arrays are written by location, so a cached single value must not skip the next set
+        shader->invalidateUniform(nameHash);
+        const GpuLocation location = shader->getUniformLocation(nameHash);
+        glUniformMatrix4fv(location, static_cast<GLsizei>(value.size()), shouldTranspose ? GL_TRUE : GL_FALSE, reinterpret_cast<const GLfloat*>(value.data())); glCheckError();
+    }
+
+    void Gpu::setUniform(GpuLocation location, const glm::mat3& value) const {
+        glUniformMatrix3fv(location, 1, GL_FALSE, glm::value_ptr(value)); glCheckError();
+    }
+
+    void Gpu::setUniform(GpuLocation location, const glm::mat4& value) const {
+        glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(value)); glCheckError();
+    }
+
+    void Gpu::setUniform(GpuLocation location, int value) const {
+        glUniform1i(location, value); glCheckError();
+    }
+
+    void Gpu::setUniform(GpuLocation location, unsigned int value) const {
+        glUniform1i(location, value); glCheckError();
+    }
+
+    void Gpu::setUniform(GpuLocation location, float value) const {
+        glUniform1f(location, value); glCheckError();
+    }
+
+    void Gpu::setUniform(GpuLocation location, const glm::vec2& value) const {
+        glUniform2fv(location, 1, glm::value_ptr(value)); glCheckError();
+    }
+
+    void Gpu::setUniform(GpuLocation location, const glm::vec3& value) const {
+        glUniform3fv(location, 1, glm::value_ptr(value)); glCheckError();
+    }
+
+    void Gpu::setUniform(GpuLocation location, const glm::vec4& value) const {
+        glUniform4fv(location, 1, glm::value_ptr(value)); glCheckError();
     }
 
     void Gpu::setUniformSubroutine(ShaderType shaderType, GpuIndex index) {
@@ -604,8 +731,10 @@ namespace Device::GPU {
         frameBuffers.pop();
         if (frameBuffers.empty()) {
             glBindFramebuffer(GL_FRAMEBUFFER, 0); glCheckError();
-            glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE); glCheckError();
-            glDepthMask(GL_TRUE); glCheckError();
+
+            //the masks go through the shadow state, or a later push of the same masks would be dropped
+            GlStateDriver driver;
+            gpu.stateCache.applyDefaultMasks(driver);
             //TODO: stencil mask
             return {};
         } else {
@@ -623,7 +752,8 @@ namespace Device::GPU {
     }
 
     Gpu::TextureManager::WeakType Gpu::TextureManager::bind(IndexType index, const SharedType& texture) {
-        const boost::shared_ptr<Resources::Texture>& previousTexture = textures[index];
+        //a copy, the slot is overwritten below
+        const SharedType previousTexture = textures[index];
         if (previousTexture == texture) return previousTexture;
 
         glActiveTexture(GL_TEXTURE0 + index); glCheckError();
@@ -633,7 +763,7 @@ namespace Device::GPU {
     }
 
     Gpu::TextureManager::WeakType Gpu::TextureManager::unbind(IndexType index) {
-        const boost::shared_ptr<Resources::Texture>& previousTexture = textures[index];
+        const SharedType previousTexture = textures[index];
         if (previousTexture == nullptr) return previousTexture;
         glActiveTexture(GL_TEXTURE0 + index); glCheckError();
         glBindTexture(GL_TEXTURE_2D, 0); glCheckError();
@@ -736,6 +866,17 @@ namespace Device::GPU {
         ); glCheckError();
     }
 
+    void Gpu::multiDrawElements(PrimitiveType primitiveType, const int* counts, GpuDataTypes indexDataType, const void* const* offsets, size_t drawCount) const {
+        if (drawCount == 0) return;
+        glMultiDrawElements(
+                getPrimitiveType(primitiveType),
+                static_cast<const GLsizei*>(counts),
+                getDataType(indexDataType),
+                offsets,
+                static_cast<GLsizei>(drawCount)
+        ); glCheckError();
+    }
+
     GpuId Gpu::createProgram(const std::string& vertexShaderSource, const std::string& fragmentShaderSource) const {
         auto createShader = [&](GLenum type, const std::string& source) -> GLint {
             //create shaders
@@ -867,13 +1008,8 @@ namespace Device::GPU {
     }
 
     void Gpu::BlendStateManager::applyState(const Gpu::BlendStateManager::BlendState& state) {
-        if (state.isEnabled) {
-            glEnable(GL_BLEND); glCheckError();
-        } else {
-            glDisable(GL_BLEND); glCheckError();
-        }
-        glBlendFunc(get_blend_factor(state.srcFactor), get_blend_factor(state.dstFactor)); glCheckError();
-        glBlendEquation(get_blend_equation(state.equation)); glCheckError();
+        GlStateDriver driver;
+        gpu.stateCache.applyBlend(driver, state.isEnabled, { get_blend_factor(state.srcFactor), get_blend_factor(state.dstFactor) }, get_blend_equation(state.equation));
     }
 
     //Depth
@@ -895,13 +1031,8 @@ namespace Device::GPU {
     }
 
     void Gpu::Depth::apply_state(const State& state) {
-        if (state.shouldTest) {
-            glEnable(GL_DEPTH_TEST); glCheckError();
-        } else {
-            glDisable(GL_DEPTH_TEST); glCheckError();
-        }
-        glDepthMask(state.shouldWriteMask ? GL_TRUE : GL_FALSE); glCheckError();
-        glDepthFunc(get_depth_function(state.function)); glCheckError();
+        GlStateDriver driver;
+        gpu.stateCache.applyDepth(driver, state.shouldTest, state.shouldWriteMask, get_depth_function(state.function));
     }
 
     //culling
@@ -923,32 +1054,31 @@ namespace Device::GPU {
     }
 
     void Gpu::CullingStateManager::applyState(const CullingState& state) {
-        if (state.isEnabled) {
-            glEnable(GL_CULL_FACE); glCheckError();
-        } else {
-            glDisable(GL_CULL_FACE); glCheckError();
-        }
-
+        unsigned int frontFace = GL_CCW;
         switch (state.frontFace) {
             case CullingFrontFace::CCW:
-                glFrontFace(GL_CCW); glCheckError();
+                frontFace = GL_CCW;
                 break;
             case CullingFrontFace::CW:
-                glFrontFace(GL_CW); glCheckError();
+                frontFace = GL_CW;
                 break;
         }
-        
+
+        unsigned int cullFace = GL_BACK;
         switch (state.mode) {
             case CullingMode::BACK:
-                glCullFace(GL_BACK); glCheckError();
+                cullFace = GL_BACK;
                 break;
             case CullingMode::FRONT:
-                glCullFace(GL_FRONT); glCheckError();
+                cullFace = GL_FRONT;
                 break;
             case CullingMode::FRONT_AND_BACK:
-                glCullFace(GL_FRONT_AND_BACK); glCheckError();
+                cullFace = GL_FRONT_AND_BACK;
                 break;
         }
+
+        GlStateDriver driver;
+        gpu.stateCache.applyCulling(driver, state.isEnabled, frontFace, cullFace);
     }
 
     //stencil
@@ -970,15 +1100,16 @@ namespace Device::GPU {
     }
 
     void Gpu::StencilStateManager::applyState(const StencilState& state) {
-        if (state.isEnabled) {
-            glEnable(GL_STENCIL_TEST); glCheckError();
-        } else {
-            glDisable(GL_STENCIL_TEST); glCheckError();
-        }
+        const std::array<unsigned int, 3> stencilFunction = { static_cast<unsigned int>(get_stencil_function(state.function.func)), static_cast<unsigned int>(state.function.ref), state.function.mask };
+
+        const std::array<unsigned int, 3> stencilOperations = {
+                static_cast<unsigned int>(get_stencil_operation(state.operations.fail)),
+                static_cast<unsigned int>(get_stencil_operation(state.operations.zfail)),
+                static_cast<unsigned int>(get_stencil_operation(state.operations.zpass))
+        };
 
-        glStencilFunc(get_stencil_function(state.function.func), state.function.ref, state.function.mask); glCheckError();
-        glStencilOp(get_stencil_operation(state.operations.fail), get_stencil_operation(state.operations.zfail), get_stencil_operation(state.operations.zpass)); glCheckError();
-        glStencilMask(state.mask); glCheckError();
+        GlStateDriver driver;
+        gpu.stateCache.applyStencil(driver, state.isEnabled, stencilFunction, stencilOperations, state.mask);
     }
 
     //color
@@ -1000,12 +1131,8 @@ namespace Device::GPU {
     }
 
     void Gpu::ColorStateManager::applyState(const ColorState& state) {
-        glColorMask(
-                state.mask.r ? GL_TRUE : GL_FALSE,
-                state.mask.g ? GL_TRUE : GL_FALSE,
-                state.mask.b ? GL_TRUE : GL_FALSE,
-                state.mask.a ? GL_TRUE : GL_FALSE
-        ); glCheckError();
+        GlStateDriver driver;
+        gpu.stateCache.applyColorMask(driver, { state.mask.r, state.mask.g, state.mask.b, state.mask.a });
     }
 
     const std::string& Gpu::getVendor() const {
@@ -13,6 +13,7 @@
 #include "../../scene/structure/rectangle.hpp"
 #include "indexType.hpp"
 #include "gpuDefs.hpp"
+#include "gpuStateCache.hpp"
 #include "colorTypes.hpp"
 #include "../../resources/texture.hpp"
 #include "buffers/frameBuffer.hpp"
@@ -216,6 +217,9 @@ namespace Device::GPU {
 			std::set<BufferType> buffers;
         } buffers;
 
+        // What the state managers last sent to the driver, redundant changes are dropped.
+        GpuStateCache stateCache;
+
         //blend
         struct BlendStateManager {
             struct BlendState {
@@ -313,6 +317,7 @@ namespace Device::GPU {
 
         void clear(GpuClearFlagType clearFlag) const;
         void drawElements(PrimitiveType primitiveType, size_t count, GpuDataTypes indexDataType, size_t offset) const;
+        void multiDrawElements(PrimitiveType primitiveType, const int* counts, GpuDataTypes indexDataType, const void* const* offsets, size_t drawCount) const;
 
         [[nodiscard]] GpuId createProgram(const std::string& vertexShaderSource, const std::string& fragmentShaderSource) const;
 		void destroyProgram(GpuId id);
@@ -323,11 +328,18 @@ namespace Device::GPU {
 		GpuId createFrameBuffer(GpuFrameBufferType type, const GpuFrameBufferSizeType& size, boost::shared_ptr<Resources::Texture>& colorTexture, boost::shared_ptr<Resources::Texture>& depthStencilTexture, boost::shared_ptr<Resources::Texture>& depthTexture);
 		void destroyFrameBuffer(GpuId id);
 
-		GpuId createTexture(ColorType color_type, glm::uvec2 size, const void* data);
+		GpuId createTexture(ColorType color_type, glm::uvec2 size, const void* data, unsigned int levelCount = 1);
 		void resizeTexture(const boost::shared_ptr<Resources::Texture>& texture, glm::uvec2 size);
+		// Replaces a sub-rectangle of a texture's base level with tightly packed texels.
+		void updateTexture(const boost::shared_ptr<Resources::Texture>& texture, glm::uvec2 offset, glm::uvec2 size, const void* data);
 		void destroyTexture(GpuId id);
+		// Row alignment of pixel uploads. Every upload goes through here, so it is shadowed
+		// instead of queried and restored around each one.
+		void setUnpackAlignment(int alignment);
 
 		GpuLocation getUniformLocation(GpuId program_id, const char* name) const;
+		// Names of the program's active uniforms, arrays as name[0]. Used once at link time.
+		std::vector<std::string> getActiveUniformNames(GpuId program_id) const;
 		GpuLocation getAttributeLocation(GpuId program_id, const char* name) const;
 
 		void getUniform(const char* name, std::vector<glm::mat4>& params, size_t count);
@@ -336,6 +348,8 @@ namespace Device::GPU {
 		void disableVertexAttributeArray(GpuLocation location);
 		void setVertexAttribPointer(GpuLocation location, int size, GpuDataTypes dataType, bool isNormalized, int stride, const void* pointer);
 		void setVertexAttribPointer(GpuLocation location, int size, GpuDataTypes dataType, int stride, const void* pointer);
+        // By name on the bound program, resolved through the table the shader reflected at link
+        // time. Prefer Shaders::Uniform handles in per-frame code, they skip the lookup.
         void setUniform(const char* name, const glm::mat3& value, bool shouldTranpose = false) const;
         void setUniform(const char* name, const glm::mat4& value, bool shouldTranpose = false) const;
         void setUniform(const char* name, int value) const;
@@ -345,6 +359,15 @@ namespace Device::GPU {
         void setUniform(const char* name, const glm::vec3& value) const;
         void setUniform(const char* name, const glm::vec4& value) const;
         void setUniform(const char* name, const std::vector<glm::mat4>& value, bool shouldTranspose = false) const;
+        // By location on the bound program.
+        void setUniform(GpuLocation location, const glm::mat3& value) const;
+        void setUniform(GpuLocation location, const glm::mat4& value) const;
+        void setUniform(GpuLocation location, int value) const;
+        void setUniform(GpuLocation location, unsigned int value) const;
+        void setUniform(GpuLocation location, float value) const;
+        void setUniform(GpuLocation location, const glm::vec2& value) const;
+        void setUniform(GpuLocation location, const glm::vec3& value) const;
+        void setUniform(GpuLocation location, const glm::vec4& value) const;
         void setUniformSubroutine(ShaderType shaderType, GpuIndex index);
 
         void setClearColor(glm::vec4& _color);
@@ -57,6 +57,7 @@ namespace Device::GPU {
         UNSIGNED_SHORT,
         INT,
         UNSIGNED_INT,
+        HALF_FLOAT,
         FLOAT,
         DOUBLE
     };
@@ -0,0 +1,138 @@
+#pragma once
+
+#ifndef QUAKE_GPUSTATECACHE_HPP
+#define QUAKE_GPUSTATECACHE_HPP
+
+#include <array>
+#include <cstddef>
+#include <boost/optional.hpp>
+
+namespace Device::GPU {
+    // CPU shadow of the fixed function GL state the Gpu state managers set. Every field holds the
+    // value last sent to the driver, and a change only goes through when it differs. Fields
+    // start out unknown, so the first set of each always goes through. Values are plain GL enums
+    // and numbers and no GL call is made here, so it works (and counts) without a context.
+    struct GpuStateCache {
+        struct Stats {
+            size_t appliedCount = 0;
+            size_t skippedCount = 0;
+        };
+
+        template<typename T>
+        struct Value {
+            // Records value and returns true if it has to be sent to the driver.
+            bool update(const T& value, Stats& stats) {
+                if (this->value && *this->value == value) {
+                    ++stats.skippedCount;
+                    return false;
+                }
+                this->value = value;
+                ++stats.appliedCount;
+                return true;
+            }
+            [[nodiscard]] const boost::optional<T>& get() const { return this->value; }
+            void invalidate() { this->value = boost::none; }
+
+        private:
+            boost::optional<T> value;
+        };
+
+        Value<bool> blendEnabled;
+        Value<std::array<unsigned int, 2>> blendFunction;       //src, dst
+        Value<unsigned int> blendEquation;
+        Value<bool> depthTestEnabled;
+        Value<bool> depthWriteMask;
+        Value<unsigned int> depthFunction;
+        Value<bool> cullingEnabled;
+        Value<unsigned int> frontFace;
+        Value<unsigned int> cullFace;
+        Value<bool> stencilEnabled;
+        Value<std::array<unsigned int, 3>> stencilFunction;     //function, reference, mask
+        Value<std::array<unsigned int, 3>> stencilOperations;   //fail, depth fail, depth pass
+        Value<unsigned int> stencilMask;
+        Value<std::array<bool, 4>> colorMask;
+        Value<int> unpackAlignment;
+
+        // Records value in field and returns true if it has to be sent to the driver.
+        template<typename T>
+        bool update(Value<T>& field, const T& value) { return field.update(value, this->stats); }
+
+        // The update-then-call sequences of the Gpu state managers. driver gets the setter named
+        // after a field (setDepthWriteMask, ...) for every value that has to reach the driver. Gpu
+        // passes one that makes the GL calls, the tests one that records them.
+        template<typename Driver>
+        void applyBlend(Driver& driver, bool isEnabled, const std::array<unsigned int, 2>& function, unsigned int equation) {
+            if (update(this->blendEnabled, isEnabled)) driver.setBlendEnabled(isEnabled);
+            if (update(this->blendFunction, function)) driver.setBlendFunction(function);
+            if (update(this->blendEquation, equation)) driver.setBlendEquation(equation);
+        }
+
+        template<typename Driver>
+        void applyDepth(Driver& driver, bool isTestEnabled, bool writeMask, unsigned int function) {
+            if (update(this->depthTestEnabled, isTestEnabled)) driver.setDepthTestEnabled(isTestEnabled);
+            if (update(this->depthWriteMask, writeMask)) driver.setDepthWriteMask(writeMask);
+            if (update(this->depthFunction, function)) driver.setDepthFunction(function);
+        }
+
+        template<typename Driver>
+        void applyCulling(Driver& driver, bool isEnabled, unsigned int frontFace, unsigned int cullFace) {
+            if (update(this->cullingEnabled, isEnabled)) driver.setCullingEnabled(isEnabled);
+            if (update(this->frontFace, frontFace)) driver.setFrontFace(frontFace);
+            if (update(this->cullFace, cullFace)) driver.setCullFace(cullFace);
+        }
+
+        template<typename Driver>
+        void applyStencil(Driver& driver, bool isEnabled, const std::array<unsigned int, 3>& function, const std::array<unsigned int, 3>& operations, unsigned int mask) {
+            if (update(this->stencilEnabled, isEnabled)) driver.setStencilEnabled(isEnabled);
+            if (update(this->stencilFunction, function)) driver.setStencilFunction(function);
+            if (update(this->stencilOperations, operations)) driver.setStencilOperations(operations);
+            if (update(this->stencilMask, mask)) driver.setStencilMask(mask);
+        }
+
+        template<typename Driver>
+        void applyColorMask(Driver& driver, const std::array<bool, 4>& mask) {
+            if (update(this->colorMask, mask)) driver.setColorMask(mask);
+        }
+
+        // The write masks GL expects on the default frame buffer, restored when the last frame buffer is popped.
+        template<typename Driver>
+        void applyDefaultMasks(Driver& driver) {
+            applyColorMask(driver, { true, true, true, true });
+            if (update(this->depthWriteMask, true)) driver.setDepthWriteMask(true);
+        }
+
+        // Starts counting a new frame, the finished frame's counts move to getLastFrameStats.
+        void beginFrame() {
+            this->lastFrameStats = this->stats;
+            this->stats = {};
+        }
+
+        // Forgets every value, for when GL state was changed behind the managers' back.
+        void invalidate() {
+            blendEnabled.invalidate();
+            blendFunction.invalidate();
+            blendEquation.invalidate();
+            depthTestEnabled.invalidate();
+            depthWriteMask.invalidate();
+            depthFunction.invalidate();
+            cullingEnabled.invalidate();
+            frontFace.invalidate();
+            cullFace.invalidate();
+            stencilEnabled.invalidate();
+            stencilFunction.invalidate();
+            stencilOperations.invalidate();
+            stencilMask.invalidate();
+            colorMask.invalidate();
+            unpackAlignment.invalidate();
+        }
+
+        [[nodiscard]] const Stats& getStats() const { return this->stats; }
+        [[nodiscard]] const Stats& getLastFrameStats() const { return this->lastFrameStats; }
+
+    private:
+        Stats stats;
+        Stats lastFrameStats;
+    };
+}
+
+#endif //QUAKE_GPUSTATECACHE_HPP
@@ -29,6 +29,11 @@ namespace Device::GPU::Shaders::Programs {
         ) {
             this->locationLocation = gpu.getAttributeLocation(getId(), "location");
             this->colorLocation = gpu.getAttributeLocation(getId(), "color");
+
+            this->worldMatrix = getUniform<glm::mat4>(Utils::fnv1a("world_matrix"));
+            this->viewProjectionMatrix = getUniform<glm::mat4>(Utils::fnv1a("view_projection_matrix"));
+            this->color = getUniform<glm::vec4>(Utils::fnv1a("color"));
+            this->diffuseTexture = getUniform<int>(Utils::fnv1a("diffuse_texture"));
         }
 
         void onBind() override {
@@ -43,6 +48,11 @@ namespace Device::GPU::Shaders::Programs {
             gpu.disableVertexAttributeArray(this->colorLocation);
         }
 
+        Uniform<glm::mat4> worldMatrix;
+        Uniform<glm::mat4> viewProjectionMatrix;
+        Uniform<glm::vec4> color;
+        Uniform<int> diffuseTexture;
+
 
     private:
         GpuLocation locationLocation;
@@ -29,6 +29,11 @@ namespace Device::GPU::Shaders::Programs {
         ) {
             locationLocation = gpu.getAttributeLocation(getId(), "location");
             texcoordLocation = gpu.getAttributeLocation(getId(), "texcoord");
+
+            worldMatrix = getUniform<glm::mat4>(Utils::fnv1a("world_matrix"));
+            viewProjectionMatrix = getUniform<glm::mat4>(Utils::fnv1a("view_projection_matrix"));
+            diffuseTexture = getUniform<int>(Utils::fnv1a("diffuse_texture"));
+            time = getUniform<float>(Utils::fnv1a("t"));
         }
 
         void onBind() override {
@@ -43,6 +48,11 @@ namespace Device::GPU::Shaders::Programs {
             gpu.disableVertexAttributeArray(texcoordLocation);
         }
 
+        Uniform<glm::mat4> worldMatrix;
+        Uniform<glm::mat4> viewProjectionMatrix;
+        Uniform<int> diffuseTexture;
+        Uniform<float> time;
+
     private:
         GpuLocation locationLocation;
         GpuLocation texcoordLocation;
@@ -1,8 +1,18 @@
 #pragma once
 
 #include "../shader.hpp"
+#include <array>
+#include <cstdint>
+#include <type_traits>
 #include <glm/glm.hpp>
 
+// Build with QUAKE_BSP_QUANTIZED_VERTICES=1 to upload level geometry as 16 byte vertices: int16
+// positions scaled by the location_offset/location_scale uniforms, half float diffuse texcoords
+// and unorm16 lightmap texcoords.
+#ifndef QUAKE_BSP_QUANTIZED_VERTICES
+#define QUAKE_BSP_QUANTIZED_VERTICES 0
+#endif
+
 namespace Device::GPU::Shaders::Programs {
     struct BSPShader : Device::GPU::Shaders::Shader {
         struct Vertex {
@@ -18,7 +28,17 @@ namespace Device::GPU::Shaders::Programs {
             glm::vec2 lightmapTexcoord;
         };
 
+        struct QuantizedVertex {
+            std::array<int16_t, 4> location;            //w is padding
+            std::array<uint16_t, 2> diffuseTexcoord;    //half floats
+            std::array<uint16_t, 2> lightmapTexcoord;   //unorm16
+        };
+
+#if QUAKE_BSP_QUANTIZED_VERTICES
+        typedef QuantizedVertex VertexType;
+#else
         typedef Vertex VertexType;
+#endif
 
         BSPShader() : Shader(
             Resources::IO::readFile("shaders/bsp/bsp.vert"),
@@ -27,12 +47,41 @@ namespace Device::GPU::Shaders::Programs {
             locationLocation = Device::GPU::gpu.getAttributeLocation(getId(), "location");
             diffuseTexcoordLocation = Device::GPU::gpu.getAttributeLocation(getId(), "diffuse_texcoord");
             lightmapTexcoordLocation = Device::GPU::gpu.getAttributeLocation(getId(), "lightmap_texcoord");
+
+            worldMatrix = getUniform<glm::mat4>(Utils::fnv1a("world_matrix"));
+            viewProjectionMatrix = getUniform<glm::mat4>(Utils::fnv1a("view_projection_matrix"));
+            locationOffset = getUniform<glm::vec3>(Utils::fnv1a("location_offset"));
+            locationScale = getUniform<glm::vec3>(Utils::fnv1a("location_scale"));
+            diffuseTexture = getUniform<int>(Utils::fnv1a("diffuse_texture"));
+            lightmapTexture = getUniform<int>(Utils::fnv1a("lightmap_texture"));
+            lightmapGamma = getUniform<float>(Utils::fnv1a("lightmap_gamma"));
+            alpha = getUniform<float>(Utils::fnv1a("alpha"));
+            shouldTestAlpha = getUniform<int>(Utils::fnv1a("should_test_alpha"));
         }
 
         void onBind() override {
             Device::GPU::gpu.enableVertexAttributeArray(locationLocation);
             Device::GPU::gpu.enableVertexAttributeArray(diffuseTexcoordLocation);
             Device::GPU::gpu.enableVertexAttributeArray(lightmapTexcoordLocation);
+            if constexpr (std::is_same_v<VertexType, QuantizedVertex>) {
+                Device::GPU::gpu.setVertexAttribPointer(
+                    locationLocation, 3,
+                    Device::GPU::GpuDataType<short>::VALUE, false, sizeof(VertexType),
+                    reinterpret_cast<void *>(offsetof(VertexType, location))
+                );
+                Device::GPU::gpu.setVertexAttribPointer(
+                    diffuseTexcoordLocation, 2,
+                    Device::GPU::GpuDataTypes::HALF_FLOAT, false, sizeof(VertexType),
+                    reinterpret_cast<void *>(offsetof(VertexType, diffuseTexcoord))
+                );
+                Device::GPU::gpu.setVertexAttribPointer(
+                    lightmapTexcoordLocation, 2,
+                    Device::GPU::GpuDataType<unsigned short>::VALUE, true, sizeof(VertexType),
+                    reinterpret_cast<void *>(offsetof(VertexType, lightmapTexcoord))
+                );
+                return;
+            }
+
             Device::GPU::gpu.setVertexAttribPointer(
                 locationLocation, sizeof(glm::vec3) / sizeof(glm::vec3::value_type),
                 Device::GPU::GpuDataType<glm::vec3::value_type>::VALUE, false, sizeof(VertexType),
@@ -52,6 +101,16 @@ namespace Device::GPU::Shaders::Programs {
             );
         }
 
+        Uniform<glm::mat4> worldMatrix;
+        Uniform<glm::mat4> viewProjectionMatrix;
+        Uniform<glm::vec3> locationOffset;
+        Uniform<glm::vec3> locationScale;
+        Uniform<int> diffuseTexture;
+        Uniform<int> lightmapTexture;
+        Uniform<float> lightmapGamma;
+        Uniform<float> alpha;
+        Uniform<int> shouldTestAlpha;
+
         void onUnbind() override {
             Device::GPU::gpu.disableVertexAttributeArray(locationLocation);
             Device::GPU::gpu.disableVertexAttributeArray(diffuseTexcoordLocation);
@@ -64,4 +123,4 @@ namespace Device::GPU::Shaders::Programs {
         Device::GPU::GpuLocation diffuseTexcoordLocation;
         Device::GPU::GpuLocation lightmapTexcoordLocation;
     };
-}
\ No newline at end of file
+}
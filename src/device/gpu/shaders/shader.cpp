@@ -1,12 +1,54 @@
 #include "shader.hpp"
 #include "../gpu.hpp"
 
+#include <algorithm>
+#include <stdexcept>
+
 namespace Device::GPU::Shaders {
 	Shader::Shader(const std::string& vertex_shader_source, const std::string& fragment_shader_source) {
         id = gpu.createProgram(vertex_shader_source, fragment_shader_source);
+        reflectUniforms();
     }
 
 	Shader::~Shader() {
         gpu.destroyProgram(id);
     }
+
+    void Shader::reflectUniforms() {
+        this->uniforms.clear();
+        for (std::string name : gpu.getActiveUniformNames(this->id)) {
+            const GpuLocation location = gpu.getUniformLocation(this->id, name.c_str());
+
+            //arrays are reported by their first element
+            if (name.ends_with("[0]")) name.resize(name.size() - 3);
+
+            UniformRecord record;
+            record.nameHash = Utils::fnv1a(name);
+            record.location = location;
+            this->uniforms.push_back(record);
+        }
+
+        std::sort(this->uniforms.begin(), this->uniforms.end(), [](const UniformRecord& a, const UniformRecord& b) { return a.nameHash < b.nameHash; });
+        const auto collision = std::adjacent_find(this->uniforms.begin(), this->uniforms.end(), [](const UniformRecord& a, const UniformRecord& b) { return a.nameHash == b.nameHash; });
+        if (collision != this->uniforms.end()) {
+            throw std::runtime_error("Uniform name hash collision in program " + std::to_string(static_cast<unsigned int>(this->id)));
+        }
+    }
+
+    const Shader::UniformRecord* Shader::findUniform(UniformNameHash nameHash) const {
+        const auto itr = std::lower_bound(this->uniforms.begin(), this->uniforms.end(), nameHash, [](const UniformRecord& record, UniformNameHash hash) { return record.nameHash < hash; });
+        if (itr == this->uniforms.end() || itr->nameHash != nameHash) return nullptr;
+        return &(*itr);
+    }
+
+    GpuLocation Shader::getUniformLocation(UniformNameHash nameHash) const {
+        const UniformRecord* record = findUniform(nameHash);
+        return record ? record->location : GpuLocation(-1);
+    }
+
+    void Shader::invalidateUniform(UniformNameHash nameHash) {
+        const UniformRecord* record = findUniform(nameHash);
+        if (!record) return;
+        this->uniforms[record - this->uniforms.data()].hasValue = false;
+    }
 }
@@ -2,11 +2,45 @@
 
 #include <boost/enable_shared_from_this.hpp>
 #include <concepts>
+#include <array>
+#include <vector>
+#include <cstring>
+#include <cstdint>
+#include <glm/glm.hpp>
 
 #include "../gpu.hpp"
+#include "../../../utils/FNV.hpp"
 
 namespace Device::GPU::Shaders {
+    struct Shader;
+
+    template<typename T>
+    concept IsUniformValue = std::same_as<T, int> || std::same_as<T, unsigned int> || std::same_as<T, float> ||
+            std::same_as<T, glm::vec2> || std::same_as<T, glm::vec3> || std::same_as<T, glm::vec4> ||
+            std::same_as<T, glm::mat3> || std::same_as<T, glm::mat4>;
+
+    // Typed handle to one of a shader's active uniforms. Setting it goes straight to the cached
+    // location, and a value equal to the last one set is not sent again. The shader has to be
+    // bound, as with Gpu::setUniform. A default or unknown handle ignores every set.
+    template<typename T> requires IsUniformValue<T>
+    struct Uniform {
+        Uniform() = default;
+
+        void set(const T& value) const;
+        [[nodiscard]] bool isValid() const { return this->shader != nullptr; }
+
+    private:
+        friend struct Shader;
+
+        Uniform(Shader* shader, uint32_t index) : shader(shader), index(index) { }
+
+        Shader* shader = nullptr;
+        uint32_t index = 0;
+    };
+
     struct Shader : boost::enable_shared_from_this<Shader> {
+        typedef unsigned int UniformNameHash;
+
         virtual ~Shader();
 
         virtual void onBind() = 0;
@@ -14,16 +48,60 @@ namespace Device::GPU::Shaders {
 
         GpuId getId() const { return id; }
 
+        // Handle for the uniform whose name hashes to nameHash, e.g. Utils::fnv1a("world_matrix").
+        // Invalid if the program has no such active uniform.
+        template<typename T> requires IsUniformValue<T>
+        [[nodiscard]] Uniform<T> getUniform(UniformNameHash nameHash) {
+            const UniformRecord* record = findUniform(nameHash);
+            if (!record) return { };
+            return { this, static_cast<uint32_t>(record - this->uniforms.data()) };
+        }
+        // Location reflected at link time, -1 if the program has no such active uniform.
+        [[nodiscard]] GpuLocation getUniformLocation(UniformNameHash nameHash) const;
+        // Forgets the last value set through handles, for writes that went around them.
+        void invalidateUniform(UniformNameHash nameHash);
+
     protected:
         Shader(const std::string& vertex_shader_source, const std::string& fragment_shader_source);
 
     private:
+        template<typename T> requires IsUniformValue<T>
+        friend struct Uniform;
+
+        // Active uniform, sorted by name hash, with the last value set through a handle.
+        struct UniformRecord {
+            UniformNameHash nameHash = 0;
+            GpuLocation location;
+            bool hasValue = false;
+            std::array<unsigned char, sizeof(glm::mat4)> value;
+        };
+
         GpuId id;
+        std::vector<UniformRecord> uniforms;
 
         Shader(const Shader&) = delete;
         Shader& operator=(const Shader&) = delete;
+
+        void reflectUniforms();
+        [[nodiscard]] const UniformRecord* findUniform(UniformNameHash nameHash) const;
+
+        // Stores value and returns true if it differs from the last one set.
+        template<typename T>
+        bool updateUniformValue(uint32_t index, const T& value) {
+            UniformRecord& record = this->uniforms[index];
+            if (record.hasValue && std::memcmp(record.value.data(), &value, sizeof(T)) == 0) return false;
+            std::memcpy(record.value.data(), &value, sizeof(T));
+            record.hasValue = true;
+            return true;
+        }
     };
 
+    template<typename T> requires IsUniformValue<T>
+    void Uniform<T>::set(const T& value) const {
+        if (!this->shader || !this->shader->updateUniformValue(this->index, value)) return;
+        gpu.setUniform(this->shader->uniforms[this->index].location, value);
+    }
+
     template<typename T>
     concept IsShader = std::derived_from<T, Shader>;
-}
\ No newline at end of file
+}
@@ -57,10 +57,10 @@ namespace GUI {
         gpuWorldMatrix *= glm::translate(glm::mat4(), glm::vec3(getBounds().min.x, getBounds().min.y, 0.0f));
         gpuWorldMatrix *= glm::scale(glm::mat4(), glm::vec3(getSize().x, getSize().y, 1.0f));   //TODO: verify correctness
 
-        Device::GPU::gpu.setUniform("world_matrix", gpuWorldMatrix);
-        Device::GPU::gpu.setUniform("view_projection_matrix", view_projection_matrix);
-        Device::GPU::gpu.setUniform("diffuse_texture", DIFFUSE_TEXTURE_INDEX);
-        Device::GPU::gpu.setUniform("t", Core::Application::app.getUptimeSeconds());
+        shader->worldMatrix.set(gpuWorldMatrix);
+        shader->viewProjectionMatrix.set(view_projection_matrix);
+        shader->diffuseTexture.set(DIFFUSE_TEXTURE_INDEX);
+        shader->time.set(Core::Application::app.getUptimeSeconds());
 
         Device::GPU::gpu.textures.bind(DIFFUSE_TEXTURE_INDEX, frameBuffer->getColorTexture());
         Device::GPU::gpu.drawElements(Device::GPU::Gpu::PrimitiveType::TRIANGLE_FAN, 4, IndexBufferType::DATA_TYPE, 0);
@@ -329,7 +329,7 @@ namespace GUI {
 
         //TODO: configure this to be enable-able in-game
 #if defined(DEBUG)
-        Debug::Renderer::renderRectangle(world_matrix, view_projection_matrix, Scenes::Structure::Rectangle<float>(bounds), glm::vec4(1.0f, 0.0f, 0.0f, 1.0f));
+        Debug::Renderer::queueRectangle(world_matrix, view_projection_matrix, Scenes::Structure::Rectangle<float>(bounds), glm::vec4(1.0f, 0.0f, 0.0f, 1.0f));
 #endif
 
         onRenderBegin(world_matrix, view_projection_matrix);
@@ -229,6 +229,39 @@ namespace Physics {
         return IntersectType::INTERSECT;
     }
 
+    static const unsigned int FRUSTUM_PLANE_MASK_ALL = (1u << Rendering::View::FRUSTUM_PLANE_COUNT) - 1;
+
+    // Hierarchical variant: only the planes set in planeMask are tested, and planes the box lies
+    // fully inside are cleared from it so children of a box never test them again. A mask of 0
+    // means the box is contained by the frustum.
+    template<typename FrustumScalar, typename AABBScalar>
+    IntersectType intersects(const Rendering::View::Frustum<FrustumScalar>& frustum,
+                             const Scenes::Structure::AABB3<AABBScalar>& aabb,
+                             unsigned int& planeMask) {
+        if (planeMask == 0) return IntersectType::CONTAIN;
+
+        const glm::tvec3<FrustumScalar> center = static_cast<glm::tvec3<FrustumScalar>>(aabb.min + aabb.max) / FrustumScalar(2);
+        const glm::tvec3<FrustumScalar> extents = static_cast<glm::tvec3<FrustumScalar>>(aabb.max - aabb.min) / FrustumScalar(2);
+        const auto& planes = frustum.get_planes();
+
+        for (size_t i = 0; i < Rendering::View::FRUSTUM_PLANE_COUNT; ++i) {
+            if (!(planeMask & (1u << i))) continue;
+
+            //distance of the box centre against its projected radius on the plane normal
+            const FrustumScalar distance = distanceToPlane(planes[i], center);
+            const FrustumScalar radius = glm::dot(glm::abs(planes[i].normal), extents);
+
+            if (distance + radius < 0) {
+                return IntersectType::DISJOINT;
+            }
+            if (distance - radius >= 0) {
+                planeMask &= ~(1u << i);
+            }
+        }
+
+        return planeMask == 0 ? IntersectType::CONTAIN : IntersectType::INTERSECT;
+    }
+
     template<typename Scalar> requires std::floating_point<Scalar>
     IntersectType intersects(const Scenes::Structure::AABB3<Scalar> aabb0,
                              const glm::tvec3<Scalar>& d0,
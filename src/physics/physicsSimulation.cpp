@@ -1,5 +1,8 @@
 #include "physicsSimulation.hpp"
 #include "components/rigidBodyComponent.hpp"
+#include "../core/threading/workerPool.hpp"
+
+#include <stdexcept>
 
 #include <bullet/btBulletDynamicsCommon.h>
 #include <bullet/BulletDynamics/Featherstone/btMultiBodyDynamicsWorld.h>
@@ -73,4 +76,17 @@ namespace Physics {
 
         return trace_result;
     }
-}
\ No newline at end of file
+
+    //bullet has no packet ray query, each line is its own rayTest with its own closest-hit callback.
+    //rayTest only reads the world, so between steps large batches are split over the worker pool
+    void PhysicsSimulation::trace(std::span<const Scenes::Structure::Line3<float>> lines, std::span<Rendering::Query::TraceResult> results) const {
+        static const size_t LINES_PER_JOB = 64;
+        if (results.size() < lines.size()) throw std::runtime_error("Trace results are smaller than the trace lines");
+
+        Core::Threading::workers.parallelFor(0, lines.size(), LINES_PER_JOB, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                results[i] = trace(lines[i].start, lines[i].end);
+            }
+        });
+    }
+}
@@ -3,10 +3,12 @@
 #ifndef QUAKE_PHYSICSSIMULATION_HPP
 #define QUAKE_PHYSICSSIMULATION_HPP
 
+#include <span>
 #include <glm/glm.hpp>
 #include <boost/shared_ptr.hpp>
 
 #include "../rendering/query/traceResult.hpp"
+#include "../scene/structure/line.hpp"
 
 class btMultiBodyDynamicsWorld;
 class btDbvtBroadphase;
@@ -31,6 +33,9 @@ namespace Physics {
         void removeRigidBody(const boost::shared_ptr<Components::RigidBodyComponent>& rigid_body);
 
         [[nodiscard]] Rendering::Query::TraceResult trace(const glm::vec3& start, const glm::vec3& end) const;
+        // Traces every line into the result at the same index. Batches of more than a job's worth
+        // of lines run on the worker pool, so this must not overlap a step.
+        void trace(std::span<const Scenes::Structure::Line3<float>> lines, std::span<Rendering::Query::TraceResult> results) const;
 
     private:
         btDbvtBroadphase* broadphaseInterface;
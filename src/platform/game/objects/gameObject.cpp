@@ -1,6 +1,7 @@
 #include "gameObject.hpp"
 
 #include <algorithm>
+#include <limits>
 #include <boost/range/adaptor/map.hpp>
 
 #include "../components/gameComponent.hpp"
@@ -11,6 +12,20 @@ namespace Platform::Game::Objects {
         this->id = nextId++;
     }
 
+    boost::optional<Scenes::Structure::AABB3<float>> GameObject::getWorldBounds() const {
+        if (!this->bounds) return boost::none;
+
+        const glm::mat4 matrix = this->pose.to_matrix();
+        glm::vec3 min(std::numeric_limits<float>::max());
+        glm::vec3 max(std::numeric_limits<float>::lowest());
+        for (const glm::vec3& corner : this->bounds->getCorners()) {
+            const glm::vec3 location = glm::vec3(matrix * glm::vec4(corner, 1.0f));
+            min = glm::min(min, location);
+            max = glm::max(max, location);
+        }
+        return Scenes::Structure::AABB3<float>(min, max);
+    }
+
     void GameObject::render(Components::CameraParameters& cameraParameters) {
         for (boost::shared_ptr<Components::GameComponent> const &component : this->components | boost::adaptors::map_values) {
             component->onRender(cameraParameters);
@@ -10,9 +10,11 @@
 #include <boost/shared_ptr.hpp>
 #include <boost/make_shared.hpp>
 #include <boost/enable_shared_from_this.hpp>
+#include <boost/optional.hpp>
 #include <type_traits>
 
 #include "../models/pose.hpp"
+#include "../../../scene/structure/aabb.hpp"
 #include "../components/cameraParams.hpp"
 #include "../components/gameComponent.hpp"
 
@@ -24,6 +26,16 @@ namespace Platform::Game::Objects {
         GameObject();
 
         Models::Pose3<float> pose;
+        // Local space bounds of whatever the object draws, used to link it into the BSP leaves.
+        // Objects without bounds are drawn every frame.
+        boost::optional<Scenes::Structure::AABB3<float>> bounds;
+        // BSP leaf holding pose.location and its contents (a BSP::ContentType), refreshed by the
+        // scene every tick. Leaf 0 and EMPTY when the scene has no level.
+        int leafIndex = 0;
+        int leafContents = -1;
+
+        // bounds moved by the pose, none when the object has no bounds.
+        [[nodiscard]] boost::optional<Scenes::Structure::AABB3<float>> getWorldBounds() const;
 
         virtual void onCreate() { }
         virtual void onDestroy() { }
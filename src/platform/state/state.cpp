@@ -7,6 +7,7 @@
 #include "../platform.hpp"
 #include "../../device/gpu/gpu.hpp"
 #include "../../gui/guiLayout.hpp"
+#include "../../debug/debugRenderer.hpp"
 
 
 namespace Platform::States {
@@ -46,6 +47,10 @@ namespace Platform::States {
         Device::GPU::gpu.depth.pushState(depthState);
         this->layout->render(glm::mat4(), view_projection_matrix);
         Device::GPU::gpu.depth.popState();
+#if defined(DEBUG)
+        //the layout outlines go out with the next render queue flush, over the GUI
+        Debug::Renderer::submit();
+#endif
     }
 
     bool State::onInputEvent(Input::InputEvent &input_event) {
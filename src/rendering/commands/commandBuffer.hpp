@@ -0,0 +1,90 @@
+#pragma once
+
+#ifndef QUAKE_COMMANDBUFFER_HPP
+#define QUAKE_COMMANDBUFFER_HPP
+
+#include <bit>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <type_traits>
+
+namespace Rendering::Commands {
+    // 64 bit draw order: layer | program | texture | depth, most significant first. Sorting by it
+    // groups draws by layer, then by program and texture to cut state changes, then by depth.
+    struct RenderKey {
+        static const int DEPTH_BITS = 32;
+        static const int TEXTURE_BITS = 16;
+        static const int PROGRAM_BITS = 12;
+        static const int LAYER_BITS = 4;
+
+        enum class Layer: unsigned int {
+            WORLD,
+            ENTITIES,
+            TRANSLUCENT,
+            DEBUG,
+            GUI
+        };
+
+        // Program and texture ids are masked to their fields. depth is the view space distance,
+        // opaque layers go front to back and isBackToFront reverses it for blending.
+        static uint64_t make(Layer layer, unsigned int programId, unsigned int textureId, float depth, bool isBackToFront = false) {
+            uint32_t depthBits = std::bit_cast<uint32_t>(std::max(depth, 0.0f));   //positive floats order like their bits
+            if (isBackToFront) depthBits = ~depthBits;
+
+            return (static_cast<uint64_t>(static_cast<unsigned int>(layer) & getMask(LAYER_BITS)) << (PROGRAM_BITS + TEXTURE_BITS + DEPTH_BITS)) |
+                   (static_cast<uint64_t>(programId & getMask(PROGRAM_BITS)) << (TEXTURE_BITS + DEPTH_BITS)) |
+                   (static_cast<uint64_t>(textureId & getMask(TEXTURE_BITS)) << DEPTH_BITS) |
+                   depthBits;
+        }
+
+        static Layer getLayer(uint64_t key) { return static_cast<Layer>(key >> (PROGRAM_BITS + TEXTURE_BITS + DEPTH_BITS)); }
+
+    private:
+        static constexpr unsigned int getMask(int bitCount) { return (1u << bitCount) - 1; }
+    };
+
+    // Draw packets recorded by one thread. A packet is any trivially copyable struct with a static
+    // execute(const T&) that makes the GL calls; it is copied into the buffer's storage and run
+    // later on the GL thread by RenderQueue. A buffer is not shared between threads.
+    struct CommandBuffer {
+        typedef void (*ExecuteFunction)(const void* packet);
+
+        struct Command {
+            uint64_t key = 0;
+            uint32_t packetOffset = 0;
+            ExecuteFunction execute = nullptr;
+        };
+
+        template<typename T> requires std::is_trivially_copyable_v<T> && requires(const T& packet) { T::execute(packet); }
+        void record(uint64_t key, const T& packet) {
+            //the storage comes from operator new, aligned for anything up to max_align_t
+            static_assert(alignof(T) <= alignof(std::max_align_t));
+            const size_t packetOffset = (this->packetData.size() + alignof(T) - 1) & ~(alignof(T) - 1);
+            this->packetData.resize(packetOffset + sizeof(T));
+            std::memcpy(this->packetData.data() + packetOffset, &packet, sizeof(T));
+
+            Command& command = this->commands.emplace_back();
+            command.key = key;
+            command.packetOffset = static_cast<uint32_t>(packetOffset);
+            command.execute = [](const void* data) { T::execute(*static_cast<const T*>(data)); };
+        }
+
+        void clear() {
+            this->commands.clear();
+            this->packetData.clear();
+        }
+
+        [[nodiscard]] bool empty() const { return this->commands.empty(); }
+        [[nodiscard]] const std::vector<Command>& getCommands() const { return this->commands; }
+        [[nodiscard]] const void* getPacket(const Command& command) const { return this->packetData.data() + command.packetOffset; }
+
+    private:
+        std::vector<Command> commands;
+        std::vector<unsigned char> packetData;
+    };
+}
+
+#endif //QUAKE_COMMANDBUFFER_HPP
@@ -0,0 +1,83 @@
+#include "renderQueue.hpp"
+
+#include <array>
+#include <utility>
+
+namespace Rendering::Commands {
+    RenderQueue renderQueue;
+
+    void RenderQueue::submit(CommandBuffer& buffer) {
+        if (buffer.empty()) return;
+
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->submittedBuffers.push_back(std::move(buffer));
+        if (this->freeBuffers.empty()) {
+            buffer = CommandBuffer();
+        } else {
+            buffer = std::move(this->freeBuffers.back());
+            this->freeBuffers.pop_back();
+        }
+    }
+
+    void RenderQueue::flush() {
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            std::swap(this->flushBuffers, this->submittedBuffers);
+        }
+
+        this->entries.clear();
+        for (size_t bufferIndex = 0; bufferIndex < this->flushBuffers.size(); ++bufferIndex) {
+            const std::vector<CommandBuffer::Command>& commands = this->flushBuffers[bufferIndex].getCommands();
+            for (size_t commandIndex = 0; commandIndex < commands.size(); ++commandIndex) {
+                this->entries.push_back({ commands[commandIndex].key, static_cast<uint32_t>(bufferIndex), static_cast<uint32_t>(commandIndex) });
+            }
+        }
+
+        sortEntries();
+
+        for (const SortEntry& entry : this->entries) {
+            const CommandBuffer& buffer = this->flushBuffers[entry.bufferIndex];
+            const CommandBuffer::Command& command = buffer.getCommands()[entry.commandIndex];
+            command.execute(buffer.getPacket(command));
+        }
+
+        this->lastFlushStats.bufferCount = this->flushBuffers.size();
+        this->lastFlushStats.commandCount = this->entries.size();
+
+        std::lock_guard<std::mutex> lock(this->mutex);
+        for (CommandBuffer& buffer : this->flushBuffers) {
+            buffer.clear();
+            this->freeBuffers.push_back(std::move(buffer));
+        }
+        this->flushBuffers.clear();
+    }
+
+    //least significant digit first, a byte per pass. Each pass is stable, so equal keys keep the
+    //submission order, and passes where every key shares the byte are skipped
+    void RenderQueue::sortEntries() {
+        static const int RADIX_BITS = 8;
+        static const size_t BUCKET_COUNT = size_t(1) << RADIX_BITS;
+        static const int PASS_COUNT = 64 / RADIX_BITS;
+
+        this->scratchEntries.resize(this->entries.size());
+        for (int pass = 0; pass < PASS_COUNT; ++pass) {
+            const int shift = pass * RADIX_BITS;
+            std::array<size_t, BUCKET_COUNT> offsets = { };
+            for (const SortEntry& entry : this->entries) {
+                ++offsets[(entry.key >> shift) & (BUCKET_COUNT - 1)];
+            }
+            if (this->entries.empty() || offsets[(this->entries.front().key >> shift) & (BUCKET_COUNT - 1)] == this->entries.size()) continue;
+
+            size_t offset = 0;
+            for (size_t& bucketOffset : offsets) {
+                const size_t count = bucketOffset;
+                bucketOffset = offset;
+                offset += count;
+            }
+            for (const SortEntry& entry : this->entries) {
+                this->scratchEntries[offsets[(entry.key >> shift) & (BUCKET_COUNT - 1)]++] = entry;
+            }
+            std::swap(this->entries, this->scratchEntries);
+        }
+    }
+}
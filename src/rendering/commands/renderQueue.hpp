@@ -0,0 +1,50 @@
+#pragma once
+
+#ifndef QUAKE_RENDERQUEUE_HPP
+#define QUAKE_RENDERQUEUE_HPP
+
+#include <mutex>
+#include <vector>
+#include <cstdint>
+
+#include "commandBuffer.hpp"
+
+namespace Rendering::Commands {
+    // Collects command buffers recorded on any thread and replays them on the GL thread. At
+    // flush every submitted command is merged into one list, radix sorted by key and executed.
+    // Commands with equal keys run in the order they were submitted.
+    struct RenderQueue {
+        struct Stats {
+            size_t bufferCount = 0;
+            size_t commandCount = 0;
+        };
+
+        // Thread safe. Takes the buffer's commands and hands it back empty (with storage to reuse).
+        void submit(CommandBuffer& buffer);
+        // GL thread only. Sorts and executes everything submitted since the last flush.
+        void flush();
+
+        [[nodiscard]] const Stats& getLastFlushStats() const { return this->lastFlushStats; }
+
+    private:
+        struct SortEntry {
+            uint64_t key = 0;
+            uint32_t bufferIndex = 0;
+            uint32_t commandIndex = 0;
+        };
+
+        std::mutex mutex;
+        std::vector<CommandBuffer> submittedBuffers;
+        std::vector<CommandBuffer> freeBuffers;
+        std::vector<CommandBuffer> flushBuffers;
+        std::vector<SortEntry> entries;
+        std::vector<SortEntry> scratchEntries;
+        Stats lastFlushStats;
+
+        void sortEntries();
+    };
+
+    extern RenderQueue renderQueue;
+}
+
+#endif //QUAKE_RENDERQUEUE_HPP
@@ -1,404 +1,608 @@
 #include <iostream>
+#include <iterator>
+#include <algorithm>
+#include <functional>
+#include <cstring>
+#include <future>
+#include <limits>
+#include <bit>
+#include <chrono>
+#include <charconv>
+#include <boost/crc.hpp>
 #include <glm/ext.hpp>
-#include <boost/algorithm/string.hpp>
 #include <exception>
 #include <spdlog/spdlog.h>
 
 #include "bsp.hpp"
+#include "bspLumps.hpp"
+#include "lightmapAtlas.hpp"
+#include "mipTextureDecoder.hpp"
+#include "visibleSurfaceList.hpp"
+#include "compiledLevel.hpp"
 #include "../../../platform/game/components/cameraParams.hpp"
 #include "../../../device/gpu/shaders/programs/bspShader.hpp"
 #include "../../../resources/resourceManager.hpp"
 #include "../../../device/gpu/shaders/shaderManager.hpp"
 #include "../../../device/gpu/buffers/gpuBufferManager.hpp"
+#include "../../../device/gpu/buffers/frameBuffer.hpp"
 #include "../../../resources/io/io.hpp"
+#include "../../../core/threading/workerPool.hpp"
+#include "../../../physics/collision.hpp"
+#include "../../../utils/simd.hpp"
 
 
 namespace Rendering::Scene {
-    struct BSPChunk {
-        enum class Type: unsigned char {
-            ENTITIES,
-            PLANES,
-            TEXTURES,
-            VERTICES,
-            VISIBLIITY,
-            NODES,
-            TEXTURE_INFO,
-            FACES,
-            LIGHTING,
-            CLIP_NODES,
-            LEAVES,
-            MARK_SURFACES,
-            EDGES,
-            SURFACE_EDGES,
-            MODELS,
-            COUNT
+    static_assert(sizeof(BSP::Edge) == 4, "Edge must match the on-disk layout");
+    static_assert(sizeof(BSP::Face) == 20, "Face must match the on-disk layout");
+    static_assert(sizeof(BSP::ClipNode) == 8, "ClipNode must match the on-disk layout");
+
+    //anything that changes the in-memory layout of compiled level sections has to change this
+    static uint32_t getCompiledLevelLayoutChecksum() {
+        const std::array<uint32_t, 13> layout = {
+                sizeof(BSP::VertexType),
+                sizeof(BSP::IndexType),
+                sizeof(VisibleSurfaceList::IndexRange),
+                sizeof(CompiledLevel::Metadata),
+                static_cast<uint32_t>(LightmapAtlas::CHANNEL_COUNT),
+                sizeof(BSP::BSPPlane),
+                sizeof(BSP::Node),
+                sizeof(BSP::Leaf),
+                sizeof(BSP::Model),
+                sizeof(BSP::TextureInfo),
+                sizeof(BSPTraversal::AABBType),
+                sizeof(BSPTraversal::ChildIndicesType),
+                sizeof(CompiledLevel::Occluder)
         };
+        boost::crc_32_type crc32;
+        crc32.process_bytes(layout.data(), sizeof(layout));
+        return crc32.checksum();
+    }
+
+    struct BSP::StagedLevel {
+        // A texture waiting for its GPU object, either a decoded image or an embedded RGBA8 mip chain.
+        struct Texture {
+            unsigned int textureIndex = 0;
+            std::string name;
+            boost::shared_ptr<Resources::Image> image;
+            std::vector<unsigned char> texels;
+            glm::uvec2 size;
+        };
+
+        std::vector<Texture> textures;
+        //geometry points into either the compiled level mapping or the freshly built arrays
+        boost::optional<CompiledLevel> compiledLevel;
+        std::vector<VertexType> vertices;
+        std::vector<IndexType> indices;
+        LightmapAtlas lightmapAtlas;
+        LevelGeometry geometry;
+        //uploads go textures first, then lightmap pages, then the vertex and index buffers
+        size_t uploadIndex = 0;
 
-        unsigned int offset = 0;
-        unsigned int length = 0;
+        [[nodiscard]] size_t getUploadCount() const { return this->textures.size() + this->geometry.lightmapPages.size() + 2; }
     };
 
-    BSP::BSP(std::istream& istream) {
-        if (!istream.good()) throw std::runtime_error("Stream handle was not good");
-
-        //version
-        int version;
-        Resources::IO::read(istream, version);
-        static const auto BSP_VERSION = 30;
-        if (version != BSP_VERSION) throw std::runtime_error("Bad BSP version: " + std::to_string(version));
-
-        //chunks
-        std::vector<BSPChunk> chunks;
-        chunks.resize(static_cast<size_t>(BSPChunk::Type::COUNT));
-        for (BSPChunk& chunk : chunks) {
-            Resources::IO::read(istream, chunk.offset);
-            Resources::IO::read(istream, chunk.length);
-        }
-
-        //planes
-        const BSPChunk& planeChunk = chunks[static_cast<size_t>(BSPChunk::Type::PLANES)];
-        istream.seekg(planeChunk.offset, std::ios_base::beg);
-
-        unsigned long planeCount = planeChunk.length / sizeof(BSPPlane);
-        this->planes.resize(planeCount);
-
-        for (BSPPlane& plane : this->planes) {
-            Resources::IO::read(istream, plane.plane.normal.x);
-            Resources::IO::read(istream, plane.plane.normal.z);
-            Resources::IO::read(istream, plane.plane.normal.y);
-            Resources::IO::read(istream, plane.plane.distance);
-            Resources::IO::read(istream, plane.type);
-            plane.plane.normal.z = -plane.plane.normal.z;
-        }
-
-        //vertexLocations
-        const BSPChunk& verticesChunk = chunks[static_cast<size_t>(BSPChunk::Type::VERTICES)];
-        istream.seekg(verticesChunk.offset, std::ios_base::beg);
-
-        std::vector<glm::vec3> vertexLocations;
-        unsigned long vertexLocationCount = verticesChunk.length / sizeof(glm::vec3);
-        vertexLocations.resize(vertexLocationCount);
-
-        for (glm::vec<3, float>& vertexLocation : vertexLocations) {
-            Resources::IO::read(istream, vertexLocation.x);
-            Resources::IO::read(istream, vertexLocation.z);
-            Resources::IO::read(istream, vertexLocation.y);
-            vertexLocation.z = -vertexLocation.z;
-        }
-
-        //edges
-        const BSPChunk& edgesChunk = chunks[static_cast<size_t>(BSPChunk::Type::EDGES)];
-        istream.seekg(edgesChunk.offset, std::ios_base::beg);
-        unsigned long edgeCount = edgesChunk.length / sizeof(Edge);
-        this->edges.resize(edgeCount);
-
-        for (Edge& edge : this->edges) {
-            Resources::IO::read(istream, edge.vertexIndices[0]);
-            Resources::IO::read(istream, edge.vertexIndices[1]);
-        }
-
-        //surfaceEdges
-        const BSPChunk& surfaceEdgesChunk = chunks[static_cast<size_t>(BSPChunk::Type::SURFACE_EDGES)];
-        istream.seekg(surfaceEdgesChunk.offset, std::ios_base::beg);
-        unsigned long surfaceEdgeCount = surfaceEdgesChunk.length / sizeof(int);
-        this->surfaceEdges.resize(surfaceEdgeCount);
-
-        for (int& surfaceEdge : this->surfaceEdges) {
-            Resources::IO::read(istream, surfaceEdge);
-        }
-
-        //faces
-        const BSPChunk& facesChunk = chunks[static_cast<size_t>(BSPChunk::Type::FACES)];
-        istream.seekg(facesChunk.offset, std::ios_base::beg);
-        unsigned long faceCount = facesChunk.length / sizeof(Face);
-        this->faces.resize(faceCount);
-
-        for (Face& face : this->faces) {
-            Resources::IO::read(istream, face.planeIndex);
-            Resources::IO::read(istream, face.planeSide);
-            Resources::IO::read(istream, face.surfaceEdgeStartIndex);
-            Resources::IO::read(istream, face.surfaceEdgeCount);
-            Resources::IO::read(istream, face.textureInfoIndex);
-            Resources::IO::read(istream, face.lightingStyles[0]);
-            Resources::IO::read(istream, face.lightingStyles[1]);
-            Resources::IO::read(istream, face.lightingStyles[2]);
-            Resources::IO::read(istream, face.lightingStyles[3]);
-            Resources::IO::read(istream, face.lightmapOffset);
-        }
-
-        //nodes
-        const BSPChunk& nodesChunk = chunks[static_cast<size_t>(BSPChunk::Type::NODES)];
-        istream.seekg(nodesChunk.offset, std::ios_base::beg);
-        unsigned long nodeCount = nodesChunk.length / sizeof(Node);
-        this->nodes.resize(nodeCount);
-
-        for (Node& node : this->nodes) {
-            Resources::IO::read(istream, node.planeIndex);
-            Resources::IO::read(istream, node.childIndices[0]);
-            Resources::IO::read(istream, node.childIndices[1]);
-            Resources::IO::read(istream, node.aabb.min.x);
-            Resources::IO::read(istream, node.aabb.min.z);
-            Resources::IO::read(istream, node.aabb.min.y);
-            Resources::IO::read(istream, node.aabb.max.x);
-            Resources::IO::read(istream, node.aabb.max.z);
-            Resources::IO::read(istream, node.aabb.max.y);
-            Resources::IO::read(istream, node.faceStartIndex);
-            Resources::IO::read(istream, node.faceCount);
-            node.aabb.min.z = -node.aabb.min.z;
-            node.aabb.max.z = -node.aabb.max.z;
-        }
-
-        //leaves
-        const BSPChunk& leavesChunk = chunks[static_cast<size_t>(BSPChunk::Type::LEAVES)];
-        istream.seekg(leavesChunk.offset, std::ios_base::beg);
-        unsigned long leafCount = leavesChunk.length / sizeof(Leaf);
-        this->leaves.resize(leafCount);
-
-        for (Leaf& leaf : this->leaves) {
-            Resources::IO::read(istream, leaf.contentType);
-            Resources::IO::read(istream, leaf.visibilityOffset);
-            Resources::IO::read(istream, leaf.aabb.min.x);
-            Resources::IO::read(istream, leaf.aabb.min.z);
-            Resources::IO::read(istream, leaf.aabb.min.y);
-            Resources::IO::read(istream, leaf.aabb.max.x);
-            Resources::IO::read(istream, leaf.aabb.max.z);
-            Resources::IO::read(istream, leaf.aabb.max.y);
-            Resources::IO::read(istream, leaf.markSurfaceStartIndex);
-            Resources::IO::read(istream, leaf.markSurfaceCount);
-            Resources::IO::read(istream, leaf.ambientSoundLevels[0]);
-            Resources::IO::read(istream, leaf.ambientSoundLevels[1]);
-            Resources::IO::read(istream, leaf.ambientSoundLevels[2]);
-            Resources::IO::read(istream, leaf.ambientSoundLevels[3]);
-
-            leaf.aabb.min.z = -leaf.aabb.min.z;
-            leaf.aabb.max.z = -leaf.aabb.max.z;
-        }
-
-        //markSurfaces
-        const BSPChunk& markSurfacesChunk = chunks[static_cast<size_t>(BSPChunk::Type::MARK_SURFACES)];
-        istream.seekg(markSurfacesChunk.offset, std::ios_base::beg);
-        unsigned long markSurfaceCount = markSurfacesChunk.length / sizeof(unsigned short);
-        this->markSurfaces.resize(markSurfaceCount);
-
-        for (unsigned short& markSurface : this->markSurfaces) {
-            Resources::IO::read(istream, markSurface);
-        }
-
-        //clipNodes
-        const BSPChunk& clipNodesChunk = chunks[static_cast<size_t>(BSPChunk::Type::CLIP_NODES)];
-        istream.seekg(clipNodesChunk.offset, std::ios_base::beg);
-        unsigned long clipNodeCount = clipNodesChunk.length / sizeof(ClipNode);
-        this->clipNodes.resize(clipNodeCount);
-
-        for (ClipNode& clipNode : this->clipNodes) {
-            Resources::IO::read(istream, clipNode.planeIndex);
-            Resources::IO::read(istream, clipNode.childIndices[0]);
-            Resources::IO::read(istream, clipNode.childIndices[1]);
-        }
-
-        //models
-        const BSPChunk& modelsChunk = chunks[static_cast<size_t>(BSPChunk::Type::MODELS)];
-        istream.seekg(modelsChunk.offset, std::ios_base::beg);
-        unsigned long modelCount = modelsChunk.length / sizeof(Model);
-        this->models.resize(modelCount);
-
-        for (Model& model : this->models) {
-            Resources::IO::read(istream, model.aabb.min.x);
-            Resources::IO::read(istream, model.aabb.min.z);
-            Resources::IO::read(istream, model.aabb.min.y);
-            Resources::IO::read(istream, model.aabb.max.x);
-            Resources::IO::read(istream, model.aabb.max.z);
-            Resources::IO::read(istream, model.aabb.max.y);
-            Resources::IO::read(istream, model.origin.x);
-            Resources::IO::read(istream, model.origin.z);
-            Resources::IO::read(istream, model.origin.y);
-            Resources::IO::read(istream, model.headNodeIndices[0]);
-            Resources::IO::read(istream, model.headNodeIndices[1]);
-            Resources::IO::read(istream, model.headNodeIndices[2]);
-            Resources::IO::read(istream, model.headNodeIndices[3]);
-            Resources::IO::read(istream, model.visLeafs);
-            Resources::IO::read(istream, model.faceStartIndex);
-            Resources::IO::read(istream, model.faceCount);
-            model.aabb.min.z = -model.aabb.min.z;
-            model.aabb.max.z = -model.aabb.max.z;
-            model.origin.z = -model.origin.z;
-        }
-
-        //visibility
-        const BSPChunk& visibilityChunk = chunks[static_cast<size_t>(BSPChunk::Type::VISIBLIITY)];
-        istream.seekg(visibilityChunk.offset, std::ios_base::beg);
-
-        if (visibilityChunk.length > 0) {
-            std::function<void(int)> countVisLeaves = [&](int node_index) {
-                if (node_index < 0) {
-                    if (node_index == -1 || this->leaves[~node_index].contentType == ContentType::SOLID) {
-                        return;
-                    }
-                    ++this->visLeafCount;
-                    return;
-                }
-                countVisLeaves(this->nodes[node_index].childIndices[0]);
-                countVisLeaves(this->nodes[node_index].childIndices[1]);
-            };
+    BSP::BSP(std::istream& istream, const BSPLoadOptions& options) :
+            BSP([&istream]() {
+                if (!istream.good()) throw std::runtime_error("Stream handle was not good");
+                return std::vector<char>(std::istreambuf_iterator<char>(istream), std::istreambuf_iterator<char>());
+            }(), options) {}
+
+    BSP::BSP(const std::vector<char>& buffer, const BSPLoadOptions& options) :
+            BSP(Resources::IO::MappedFile(buffer.data(), buffer.size()), options) {}
+
+    BSP::BSP(const Resources::IO::MappedFile& file, const BSPLoadOptions& options) :
+            stagedLevel(std::make_unique<StagedLevel>()) {
+        const BSPLumpReader reader(file.span());
+        Core::Threading::WorkerPool& workers = Core::Threading::workers;
+        StagedLevel& staged = *this->stagedLevel;
+
+        //the compiled level cache is keyed by the source bytes
+        std::future<uint32_t> checksumTask = workers.submit([&file]() {
+            boost::crc_32_type crc32;
+            crc32.process_bytes(file.data(), file.size());
+            return static_cast<uint32_t>(crc32.checksum());
+        });
+        //jobs read the file and the locals above them, each batch is guarded so a throw waits for them first
+        Core::Threading::FutureGuard checksumGuard(workers);
+        checksumGuard.add(checksumTask);
+
+        //texture headers are tiny, read them here so the image decodes can start straight away
+        const std::span<const char> texturesData = reader.getBytes(BSPChunk::Type::TEXTURES);
+        const auto textureCount = BSPLumpReader::readAt<unsigned int>(texturesData, 0);
+        std::vector<BSPTexture> bspTextures;
+        std::vector<std::string> textureNames;
+        std::vector<unsigned int> textureOffsets;
+        bspTextures.reserve(textureCount);
+        textureNames.reserve(textureCount);
+        textureOffsets.reserve(textureCount);
+
+        for (unsigned int i = 0; i < textureCount; ++i) {
+            const auto textureOffset = BSPLumpReader::readAt<unsigned int>(texturesData, sizeof(unsigned int) * (i + 1));
+            const auto mipTexture = BSPLumpReader::readAt<Lumps::MipTexture>(texturesData, textureOffset);
 
-            countVisLeaves(0);
-            std::vector<unsigned char> visibilityData;
-            Resources::IO::read(istream, visibilityData, visibilityChunk.length);
+            BSPTexture bspTexture{};
+            bspTexture.width = mipTexture.width;
+            bspTexture.height = mipTexture.height;
+            std::copy(std::begin(mipTexture.mipmapOffsets), std::end(mipTexture.mipmapOffsets), std::begin(bspTexture.mipmapOffsets));
+            bspTextures.push_back(bspTexture);
+            textureOffsets.push_back(textureOffset);
 
-            for (size_t i = 0; i < this->visLeafCount; ++i) {
-                const Leaf& leaf = this->leaves[i + 1];
-                if (leaf.visibilityOffset < 0) {
-                    continue;
-                }
+            std::string textureName(mipTexture.name, strnlen(mipTexture.name, Lumps::MipTexture::NAME_LENGTH));
+            textureName.append(".png");
+            textureNames.push_back(std::move(textureName));
+        }
 
-                boost::dynamic_bitset<> leafPvs = boost::dynamic_bitset<>(leafCount - 1);
-                leafPvs.reset();
-                size_t leafPvsIndex = 0;
-                std::__wrap_iter<unsigned char*> visibilityDataItr = visibilityData.begin() + leaf.visibilityOffset;
+        //textures: decode images on the workers, textures already in the cache are reused
+        this->textures.resize(textureCount);
+        std::vector<std::future<boost::shared_ptr<Resources::Image>>> textureImageTasks(textureCount);
+        std::vector<std::future<std::vector<unsigned char>>> embeddedTextureTasks(textureCount);
+        std::vector<glm::uvec2> embeddedTextureSizes(textureCount);
+        Core::Threading::FutureGuard textureGuard(workers);
+        textureGuard.add(textureImageTasks);
+        textureGuard.add(embeddedTextureTasks);
 
-                while (leafPvsIndex < this->visLeafCount) {
-                    if (*visibilityDataItr == 0) {
-                        ++visibilityDataItr;
-                        leafPvsIndex += 8 * (*visibilityDataItr);
-                    } else {
-                        for (unsigned char mask = 1; mask != 0; ++leafPvsIndex, mask <<= 1) {
-                            if ((*visibilityDataItr & mask) && (leafPvsIndex < this->visLeafCount)) {
-                                leafPvs[leafPvsIndex] = true;
-                            }
-                        }
-                    }
-                    ++visibilityDataItr;
-                }
-                this->leafPvsMap.insert(std::make_pair(i, std::move(leafPvs)));
+        for (unsigned int i = 0; i < textureCount; ++i) {
+            //embedded textures belong to this map, so they stay out of the resource cache
+            if (options.useEmbeddedTextures && bspTextures[i].mipmapOffsets[0] != 0) {
+                embeddedTextureTasks[i] = workers.submit([textureData = texturesData.subspan(textureOffsets[i]), &size = embeddedTextureSizes[i]]() {
+                    return MipTextureDecoder::decode(textureData, size);
+                });
+                continue;
             }
-        }
 
-        //textures
-        const BSPChunk& texturesChunk = chunks[static_cast<size_t>(BSPChunk::Type::TEXTURES)];
-        istream.seekg(texturesChunk.offset, std::ios_base::beg);
-        unsigned int textureCount;
-        Resources::IO::read(istream, textureCount);
-        std::vector<unsigned int> textureOffsets;
-        textureOffsets.resize(textureCount);
+            this->textures[i] = Resources::resources.find<Resources::Texture>(textureNames[i]);
+            if (this->textures[i]) continue;
 
-        for (unsigned int& textureOffset : textureOffsets) {
-            Resources::IO::read(istream, textureOffset);
+            textureImageTasks[i] = workers.submit([textureName = textureNames[i]]() {
+                const boost::shared_ptr<std::istream> istream = Resources::resources.open(textureName);
+                return boost::make_shared<Resources::Image>(*istream);
+            });
         }
 
-        std::vector<BSPTexture> bspTextures;
+        //edges, surfaceEdges, faces, markSurfaces and clipNodes need no conversion
+        reader.read(BSPChunk::Type::EDGES, this->edges);
+        reader.read(BSPChunk::Type::SURFACE_EDGES, this->surfaceEdges);
+        reader.read(BSPChunk::Type::FACES, this->faces);
+        reader.read(BSPChunk::Type::MARK_SURFACES, this->markSurfaces);
+        reader.read(BSPChunk::Type::CLIP_NODES, this->clipNodes);
+
+        //a compiled level built from exactly these bytes replaces the lump decode and the whole build below
+        const uint32_t sourceChecksum = workers.wait(checksumTask);
+        const std::string compiledLevelName = CompiledLevel::getCacheName(sourceChecksum);
+        boost::optional<CompiledLevel>& compiledLevel = staged.compiledLevel;
+        compiledLevel = CompiledLevel::load(compiledLevelName, sourceChecksum, getCompiledLevelLayoutChecksum());
+
+        //the staged level owns whatever the geometry ends up pointing into
+        LevelGeometry& geometry = staged.geometry;
+        std::vector<VertexType>& vertices = staged.vertices;
+        std::vector<IndexType>& indices = staged.indices;
+        LightmapAtlas& lightmapAtlas = staged.lightmapAtlas;
+
+        if (compiledLevel && !loadCompiledLevel(*compiledLevel, reader, geometry)) {
+            spdlog::warn("Compiled level {} is unusable, rebuilding", compiledLevelName);
+            compiledLevel = boost::none;
+        }
 
-        for (unsigned int i = 0; i < textureCount; ++i) {
-            istream.seekg(texturesChunk.offset + textureOffsets[i], std::ios_base::beg);
+        if (!compiledLevel) {
+            std::vector<glm::vec3> vertexLocations;
+            decodeLumps(reader, vertexLocations);
+            buildTraversal();
+            buildPointHull();
+            buildOccluders(vertexLocations, textureNames);
+
+            std::future<void> visibilityTask = workers.submit([&]() { decodeVisibility(reader); });
+            Core::Threading::FutureGuard visibilityGuard(workers);
+            visibilityGuard.add(visibilityTask);
+
+            buildGeometry(reader, vertexLocations, bspTextures, vertices, indices, geometry.locationTransform, lightmapAtlas);
+            workers.wait(visibilityTask);
+            this->hearability.assignHearable(this->visibility);
+
+            geometry.vertices = vertices;
+            geometry.indices = indices;
+            geometry.lightmapPageSize = glm::uvec2(lightmapAtlas.getPageSize());
+            for (const LightmapAtlas::Page& page : lightmapAtlas.getPages()) {
+                geometry.lightmapPages.emplace_back(page.data);
+            }
+            lightmapAtlas.logOccupancy();
 
-            char textureNameBytes[16];
-            Resources::IO::read(istream, textureNameBytes);
-            std::string textureName = textureNameBytes;
-            BSPTexture bspTexture{};
+            try {
+                writeCompiledLevel(compiledLevelName, sourceChecksum, geometry);
+            } catch (const std::exception& e) {
+                spdlog::warn("Could not write compiled level {}: {}", compiledLevelName, e.what());
+            }
+        }
 
-            Resources::IO::read(istream, bspTexture.width);
-            Resources::IO::read(istream, bspTexture.height);
-            Resources::IO::read(istream, bspTexture.mipmapOffsets);
+        this->locationTransform = geometry.locationTransform;
+        decodeEntities(reader);
+        buildBrushEntityRecords();
 
-            bspTextures.push_back(bspTexture);
-            textureName.append(".png");
-            boost::shared_ptr<Resources::Texture> texture;
+        //textures: wait for the decodes here so the staged level is plain data
+        for (unsigned int i = 0; i < textureCount; ++i) {
+            if (this->textures[i]) continue;
 
             try {
-                texture = Resources::resources.get<Resources::Texture>(textureName);
+                StagedLevel::Texture texture;
+                texture.textureIndex = i;
+                texture.name = textureNames[i];
+                if (embeddedTextureTasks[i].valid()) {
+                    texture.texels = workers.wait(embeddedTextureTasks[i]);
+                    texture.size = embeddedTextureSizes[i];
+                } else {
+                    texture.image = workers.wait(textureImageTasks[i]);
+                }
+                staged.textures.push_back(std::move(texture));
             } catch (...) {
-                spdlog::error("Could not load texture: {}", textureName);
+                spdlog::error("Could not load texture: {}", textureNames[i]);
             }
-            this->textures.push_back(texture);
         }
 
-        //texture_info
-        const BSPChunk& textureInfoChunk = chunks[static_cast<size_t>(BSPChunk::Type::TEXTURE_INFO)];
-        istream.seekg(textureInfoChunk.offset, std::ios_base::beg);
-        unsigned long textureInfoCount = textureInfoChunk.length / sizeof(TextureInfo);
-        this->textureInfos.resize(textureInfoCount);
+        this->visibleSurfaces.setIndexSize(sizeof(IndexType));
 
-        for (TextureInfo& textureInfo : this->textureInfos) {
-            Resources::IO::read(istream, textureInfo.s.axis.x);
-            Resources::IO::read(istream, textureInfo.s.axis.z);
-            Resources::IO::read(istream, textureInfo.s.axis.y);
-            Resources::IO::read(istream, textureInfo.s.offset);
-            Resources::IO::read(istream, textureInfo.t.axis.x);
-            Resources::IO::read(istream, textureInfo.t.axis.z);
-            Resources::IO::read(istream, textureInfo.t.axis.y);
-            Resources::IO::read(istream, textureInfo.t.offset);
-            Resources::IO::read(istream, textureInfo.textureIndex);
-            Resources::IO::read(istream, textureInfo.flags);
-            textureInfo.s.axis.z = -textureInfo.s.axis.z;
-            textureInfo.t.axis.z = -textureInfo.t.axis.z;
+        if (options.shouldUpload) {
+            upload();
         }
+    }
 
-        std::vector<IndexType> indices;
-        std::vector<VertexType> vertices;
+    BSP::~BSP() = default;
 
-        for (Face& face : this->faces) {
-            auto normal = this->planes[face.planeIndex].plane.normal;
-            if (face.planeSide != 0) {
-                normal = -normal;
+    bool BSP::upload(std::chrono::microseconds budget) {
+        typedef std::chrono::steady_clock Clock;
+        if (!this->stagedLevel) return true;
+
+        //everything below talks to the GPU and has to stay on the GL thread
+        StagedLevel& staged = *this->stagedLevel;
+        const LevelGeometry& geometry = staged.geometry;
+        const size_t texturesEnd = staged.textures.size();
+        const size_t lightmapPagesEnd = texturesEnd + geometry.lightmapPages.size();
+        const Clock::time_point start = Clock::now();
+
+        //elapsed time is compared in microseconds, in the clock's nanoseconds a max() budget overflows
+        do {
+            const size_t uploadIndex = staged.uploadIndex++;
+
+            if (uploadIndex < texturesEnd) {
+                StagedLevel::Texture& texture = staged.textures[uploadIndex];
+                try {
+                    if (texture.image) {
+                        this->textures[texture.textureIndex] = Resources::resources.put(texture.name, boost::make_shared<Resources::Texture>(texture.image));
+                    } else {
+                        this->textures[texture.textureIndex] = boost::make_shared<Resources::Texture>(Device::GPU::ColorType::RGBA, glm::vec2(texture.size), texture.texels.data(), MipTextureDecoder::LEVEL_COUNT);
+                    }
+                } catch (...) {
+                    spdlog::error("Could not load texture: {}", texture.name);
+                }
+                //the CPU copy is dead weight from here on
+                texture.image.reset();
+                std::vector<unsigned char>().swap(texture.texels);
+            } else if (uploadIndex < lightmapPagesEnd) {
+                const std::span<const unsigned char>& page = geometry.lightmapPages[uploadIndex - texturesEnd];
+                this->lightmapPageTextures.push_back(boost::make_shared<Resources::Texture>(Device::GPU::ColorType::RGB, glm::vec2(geometry.lightmapPageSize), page.data()));
+            } else if (uploadIndex == lightmapPagesEnd) {
+                this->vertexBuffer = Device::GPU::Buffers::gpuBuffers.make<VertexBufferType>().lock();
+                this->vertexBuffer->data(geometry.vertices.data(), geometry.vertices.size(), Device::GPU::Gpu::BufferUsage::STATIC_DRAW);
+            } else {
+                this->indexBuffer = Device::GPU::Buffers::gpuBuffers.make<IndexBufferType>().lock();
+                this->indexBuffer->data(geometry.indices.data(), geometry.indices.size(), Device::GPU::Gpu::BufferUsage::STATIC_DRAW);
+            }
+        } while (staged.uploadIndex < staged.getUploadCount() && std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start) < budget);
+
+        if (staged.uploadIndex < staged.getUploadCount()) return false;
+
+        this->stagedLevel.reset();
+        return true;
+    }
+
+    void BSP::decodeLumps(const BSPLumpReader& reader, std::vector<glm::vec3>& vertexLocations) {
+        Core::Threading::WorkerPool& workers = Core::Threading::workers;
+        std::vector<std::future<void>> lumpTasks;
+        Core::Threading::FutureGuard lumpGuard(workers);
+        lumpGuard.add(lumpTasks);
+
+        lumpTasks.push_back(workers.submit([&]() {
+            std::vector<Lumps::Plane> lumpPlanes;
+            reader.read(BSPChunk::Type::PLANES, lumpPlanes);
+            this->planes.resize(lumpPlanes.size());
+
+            for (size_t i = 0; i < lumpPlanes.size(); ++i) {
+                const Lumps::Plane& lumpPlane = lumpPlanes[i];
+                BSPPlane& plane = this->planes[i];
+                plane.plane.normal = Lumps::swizzle(lumpPlane.normal);
+                plane.plane.distance = lumpPlane.distance;
+                plane.type = static_cast<BSPPlane::Type>(lumpPlane.type);
+            }
+        }));
+
+        lumpTasks.push_back(workers.submit([&]() {
+            reader.read(BSPChunk::Type::VERTICES, vertexLocations);
+            Lumps::swizzleLocations(reinterpret_cast<float*>(vertexLocations.data()), vertexLocations.size());
+        }));
+
+        lumpTasks.push_back(workers.submit([&]() {
+            std::vector<Lumps::Node> lumpNodes;
+            reader.read(BSPChunk::Type::NODES, lumpNodes);
+            this->nodes.resize(lumpNodes.size());
+
+            for (size_t i = 0; i < lumpNodes.size(); ++i) {
+                const Lumps::Node& lumpNode = lumpNodes[i];
+                Node& node = this->nodes[i];
+                node.planeIndex = lumpNode.planeIndex;
+                node.childIndices[0] = lumpNode.childIndices[0];
+                node.childIndices[1] = lumpNode.childIndices[1];
+                node.aabb.min = Lumps::swizzle(lumpNode.min);
+                node.aabb.max = Lumps::swizzle(lumpNode.max);
+                node.faceStartIndex = lumpNode.faceStartIndex;
+                node.faceCount = lumpNode.faceCount;
+            }
+        }));
+
+        lumpTasks.push_back(workers.submit([&]() {
+            std::vector<Lumps::Leaf> lumpLeaves;
+            reader.read(BSPChunk::Type::LEAVES, lumpLeaves);
+            this->leaves.resize(lumpLeaves.size());
+
+            for (size_t i = 0; i < lumpLeaves.size(); ++i) {
+                const Lumps::Leaf& lumpLeaf = lumpLeaves[i];
+                Leaf& leaf = this->leaves[i];
+                leaf.contentType = static_cast<ContentType>(lumpLeaf.contentType);
+                leaf.visibilityOffset = lumpLeaf.visibilityOffset;
+                leaf.aabb.min = Lumps::swizzle(lumpLeaf.min);
+                leaf.aabb.max = Lumps::swizzle(lumpLeaf.max);
+                leaf.markSurfaceStartIndex = lumpLeaf.markSurfaceStartIndex;
+                leaf.markSurfaceCount = lumpLeaf.markSurfaceCount;
+                std::copy(std::begin(lumpLeaf.ambientSoundLevels), std::end(lumpLeaf.ambientSoundLevels), leaf.ambientSoundLevels.begin());
+            }
+        }));
+
+        lumpTasks.push_back(workers.submit([&]() {
+            std::vector<Lumps::Model> lumpModels;
+            reader.read(BSPChunk::Type::MODELS, lumpModels);
+            this->models.resize(lumpModels.size());
+
+            for (size_t i = 0; i < lumpModels.size(); ++i) {
+                const Lumps::Model& lumpModel = lumpModels[i];
+                Model& model = this->models[i];
+                model.aabb.min = Lumps::swizzle(lumpModel.min);
+                model.aabb.max = Lumps::swizzle(lumpModel.max);
+                model.origin = Lumps::swizzle(lumpModel.origin);
+                std::copy(std::begin(lumpModel.headNodeIndices), std::end(lumpModel.headNodeIndices), model.headNodeIndices.begin());
+                model.visLeafs = lumpModel.visLeafs;
+                model.faceStartIndex = lumpModel.faceStartIndex;
+                model.faceCount = lumpModel.faceCount;
+            }
+        }));
+
+        lumpTasks.push_back(workers.submit([&]() {
+            std::vector<Lumps::TextureInfo> lumpTextureInfos;
+            reader.read(BSPChunk::Type::TEXTURE_INFO, lumpTextureInfos);
+            this->textureInfos.resize(lumpTextureInfos.size());
+
+            for (size_t i = 0; i < lumpTextureInfos.size(); ++i) {
+                const Lumps::TextureInfo& lumpTextureInfo = lumpTextureInfos[i];
+                TextureInfo& textureInfo = this->textureInfos[i];
+                textureInfo.s.axis = glm::vec3(lumpTextureInfo.s[0], lumpTextureInfo.s[2], -lumpTextureInfo.s[1]);
+                textureInfo.s.offset = lumpTextureInfo.s[3];
+                textureInfo.t.axis = glm::vec3(lumpTextureInfo.t[0], lumpTextureInfo.t[2], -lumpTextureInfo.t[1]);
+                textureInfo.t.offset = lumpTextureInfo.t[3];
+                textureInfo.textureIndex = lumpTextureInfo.textureIndex;
+                textureInfo.flags = lumpTextureInfo.flags;
+            }
+        }));
+
+        workers.wait(lumpTasks);
+    }
+
+    void BSP::decodeVisibility(const BSPLumpReader& reader) {
+        const size_t leafCount = this->leaves.size();
+        this->visibility.resize(0, leafCount);
+
+        const std::span<const char> visibilityData = reader.getBytes(BSPChunk::Type::VISIBLIITY);
+        if (visibilityData.empty()) return;
+
+        size_t visLeafCount = 0;
+        std::function<void(int)> countVisLeaves = [&](int node_index) {
+            if (node_index < 0) {
+                if (node_index == -1 || this->leaves[~node_index].contentType == ContentType::SOLID) {
+                    return;
+                }
+                ++visLeafCount;
+                return;
+            }
+            countVisLeaves(this->nodes[node_index].childIndices[0]);
+            countVisLeaves(this->nodes[node_index].childIndices[1]);
+        };
+
+        countVisLeaves(0);
+        visLeafCount = std::min(visLeafCount, leafCount > 0 ? leafCount - 1 : 0);
+        this->visibility.resize(visLeafCount, leafCount);
+        const auto* visibilityBegin = reinterpret_cast<const unsigned char*>(visibilityData.data());
+        const auto* visibilityEnd = visibilityBegin + visibilityData.size();
+
+        //run-length decode each row straight into the matrix, rows without data stay fully visible
+        for (size_t i = 0; i < visLeafCount; ++i) {
+            const Leaf& leaf = this->leaves[i + 1];
+            if (leaf.visibilityOffset < 0) {
+                continue;
             }
 
-            this->faceStartIndices.push_back(indices.size());
-            TextureInfo& textureInfo = this->textureInfos[face.textureInfoIndex];
-            BSPTexture& bspTexture = bspTextures[textureInfo.textureIndex];
+            this->visibility.clearRow(i);
+            size_t leafPvsIndex = 0;
+            const unsigned char* visibilityDataItr = visibilityBegin + leaf.visibilityOffset;
 
-            for (auto i = 0; i < face.surfaceEdgeCount; ++i) {
-                VertexType vertex;
-                int edgeIndex = this->surfaceEdges[face.surfaceEdgeStartIndex + i];
-                if (edgeIndex > 0) {
-                    vertex.location = vertexLocations[this->edges[edgeIndex].vertexIndices[0]];
+            while (leafPvsIndex < visLeafCount && visibilityDataItr < visibilityEnd) {
+                if (*visibilityDataItr == 0) {
+                    if (++visibilityDataItr == visibilityEnd) break;
+                    leafPvsIndex += 8 * (*visibilityDataItr);
                 } else {
-                    edgeIndex = -edgeIndex;
-                    vertex.location = vertexLocations[this->edges[edgeIndex].vertexIndices[1]];
+                    for (unsigned char mask = 1; mask != 0; ++leafPvsIndex, mask <<= 1) {
+                        if ((*visibilityDataItr & mask) && (leafPvsIndex < visLeafCount)) {
+                            this->visibility.setVisible(i, leafPvsIndex);
+                        }
+                    }
                 }
+                ++visibilityDataItr;
+            }
+        }
+    }
 
-                vertex.diffuseTexcoord.x = (glm::dot(vertex.location, textureInfo.s.axis) + textureInfo.s.offset) / bspTexture.width;
-                vertex.diffuseTexcoord.y = -(glm::dot(vertex.location, textureInfo.t.axis) + textureInfo.t.offset) / bspTexture.height;
-                vertices.push_back(vertex);
-                indices.push_back(static_cast<unsigned int>(indices.size()));
+    void BSP::decodeEntities(const BSPLumpReader& reader) {
+        //the entities view into this copy of the lump, so it is filled once and never touched again
+        const std::span<const char> entitiesData = reader.getBytes(BSPChunk::Type::ENTITIES);
+        this->entityText.assign(entitiesData.begin(), entitiesData.begin() + strnlen(entitiesData.data(), entitiesData.size()));
+        this->entities.clear();
+        BSPEntity::parse(std::string_view(this->entityText.data(), this->entityText.size()), this->entities);
+    }
+
+    //opaque brush models first, then alpha tested, then blended ones
+    static int getRenderModeOrder(BSP::RenderMode renderMode) {
+        switch (renderMode) {
+            case BSP::RenderMode::SOLID:
+                return 1;
+            case BSP::RenderMode::TEXTURE:
+                return 2;
+            case BSP::RenderMode::ADDITIVE:
+                return 3;
+            default:
+                return 0;
+        }
+    }
+
+    void BSP::buildBrushEntityRecords() {
+        this->brushEntityRecords.clear();
+
+        for (size_t entityIndex = 0; entityIndex < this->entities.size(); ++entityIndex) {
+            const BSPEntity& entity = this->entities[entityIndex];
+            const boost::optional<std::string_view> modelOptional = entity.getOptional<std::string_view>("model");
+            if (!modelOptional || !modelOptional.get().starts_with('*')) continue;
+
+            BrushEntityRenderRecord record;
+            record.entityIndex = entityIndex;
+            const std::string_view modelIndexString = modelOptional.get().substr(1);
+            const std::from_chars_result modelIndexResult = std::from_chars(modelIndexString.data(), modelIndexString.data() + modelIndexString.size(), record.modelIndex);
+            if (modelIndexResult.ec != std::errc() || record.modelIndex < 0 || static_cast<size_t>(record.modelIndex) >= this->models.size()) {
+                spdlog::warn("Brush entity {} references missing model {}", entityIndex, modelOptional.get());
+                continue;
             }
+
+            //render mode
+            const boost::optional<int> renderModeOptional = entity.getOptional<int>("rendermode");
+            if (renderModeOptional) record.renderMode = static_cast<RenderMode>(renderModeOptional.get());
+
+            //alpha
+            const boost::optional<int> alphaOptional = entity.getOptional<int>("renderamt");
+            if (alphaOptional) record.alpha = static_cast<float>(glm::clamp(alphaOptional.get(), 0, 255)) / 255.0f;
+
+            //origin
+            glm::vec3 origin(0.0f);
+            const boost::optional<glm::vec3> originOptional = entity.getOptional<glm::vec3>("origin");
+            if (originOptional) {
+                origin = glm::vec3(originOptional->x, originOptional->z, -originOptional->y);
+            }
+
+            //color
+            const boost::optional<glm::vec3> colorOptional = entity.getOptional<glm::vec3>("rendercolor");
+            if (colorOptional) record.color = glm::vec4(colorOptional.get() / 255.0f, 1.0f);
+
+            const Model& model = this->models[record.modelIndex];
+            record.translation = model.origin + origin;
+            record.worldMatrix = glm::translate(glm::mat4x4(), model.origin);
+            record.worldMatrix *= glm::translate(glm::mat4x4(), origin);
+            record.bounds = ::Scenes::Structure::AABB3<float>(glm::min(model.aabb.min, model.aabb.max), glm::max(model.aabb.min, model.aabb.max)) + record.translation;
+
+            this->brushEntityRecords.push_back(record);
         }
 
-        //lighting
-        const BSPChunk& lightingChunk = chunks[static_cast<size_t>(BSPChunk::Type::LIGHTING)];
-        istream.seekg(lightingChunk.offset, std::ios_base::beg);
+        std::stable_sort(this->brushEntityRecords.begin(), this->brushEntityRecords.end(), [](const BrushEntityRenderRecord& lhs, const BrushEntityRenderRecord& rhs) {
+            return getRenderModeOrder(lhs.renderMode) < getRenderModeOrder(rhs.renderMode);
+        });
+    }
+
+    void BSP::buildGeometry(const BSPLumpReader& reader, const std::vector<glm::vec3>& vertexLocations, const std::vector<BSPTexture>& bspTextures, std::vector<VertexType>& vertices, std::vector<IndexType>& indices, GeometryCompiler::LocationTransform& locationTransform, LightmapAtlas& lightmapAtlas) {
+        Core::Threading::WorkerPool& workers = Core::Threading::workers;
 
-        std::vector<unsigned char> lightingData;
-        Resources::IO::read(istream, lightingData, lightingChunk.length);
-        this->faceLightmapTextures.resize(this->faces.size());
+        //faces: every face owns a contiguous run of vertices, so the start indices are a prefix sum
+        //and the faces can then be built independently of each other. The runs are welded at the end
+        std::vector<size_t> faceStartIndices(this->faces.size());
+        std::vector<GeometryCompiler::SourceVertexType> sourceVertices;
+        this->faceIndexRanges.resize(this->faces.size());
+        size_t vertexCount = 0;
+        size_t indexCount = 0;
 
         for (size_t faceIndex = 0; faceIndex < this->faces.size(); ++faceIndex) {
-            Face& face = this->faces[faceIndex];
-            if (face.lightingStyles[0] == 0 && static_cast<int>(face.lightmapOffset) >= -1) {
+            const unsigned short surfaceEdgeCount = this->faces[faceIndex].surfaceEdgeCount;
+            faceStartIndices[faceIndex] = vertexCount;
+            vertexCount += surfaceEdgeCount;
+
+            //faces are convex fans, pre-triangulated so that any set of faces can be drawn together
+            VisibleSurfaceList::IndexRange& indexRange = this->faceIndexRanges[faceIndex];
+            indexRange.start = static_cast<unsigned int>(indexCount);
+            indexRange.count = surfaceEdgeCount >= 3 ? (surfaceEdgeCount - 2) * 3 : 0;
+            indexCount += indexRange.count;
+        }
+
+        indices.resize(indexCount);
+        sourceVertices.resize(vertexCount);
+        std::vector<glm::uvec2> faceLightmapSizes(this->faces.size(), glm::uvec2(0));
+        std::vector<unsigned char> faceLightmapErrors(this->faces.size(), 0);
+        const std::span<const char> lightingData = reader.getBytes(BSPChunk::Type::LIGHTING);
+
+        static const size_t FACE_GRAIN_SIZE = 256;
+        workers.parallelFor(0, this->faces.size(), FACE_GRAIN_SIZE, [&](size_t faceBegin, size_t faceEnd) {
+            for (size_t faceIndex = faceBegin; faceIndex < faceEnd; ++faceIndex) {
+                const Face& face = this->faces[faceIndex];
+                const size_t faceStartIndex = faceStartIndices[faceIndex];
+                const TextureInfo& textureInfo = this->textureInfos[face.textureInfoIndex];
+                const BSPTexture& bspTexture = bspTextures[textureInfo.textureIndex];
+
                 float min_u = std::numeric_limits<float>::max();
                 float min_v = std::numeric_limits<float>::max();
                 float max_u = -std::numeric_limits<float>::max();
                 float max_v = -std::numeric_limits<float>::max();
 
-                TextureInfo& textureInfo = this->textureInfos[face.textureInfoIndex];
-
-                for (int surfaceEdgeIndex = 0; surfaceEdgeIndex < face.surfaceEdgeCount; ++surfaceEdgeIndex) {
-                    int edgeIndex = this->surfaceEdges[face.surfaceEdgeStartIndex + surfaceEdgeIndex];
-                    glm::vec3 vertexLocation;
-
-                    if (edgeIndex >= 0) {
-                        vertexLocation = vertexLocations[this->edges[edgeIndex].vertexIndices[0]];
+                glm::vec2 min_texcoord(std::numeric_limits<float>::max());
+                glm::vec2 max_texcoord(-std::numeric_limits<float>::max());
+                for (auto i = 0; i < face.surfaceEdgeCount; ++i) {
+                    GeometryCompiler::SourceVertexType& vertex = sourceVertices[faceStartIndex + i];
+                    int edgeIndex = this->surfaceEdges[face.surfaceEdgeStartIndex + i];
+                    if (edgeIndex > 0) {
+                        vertex.location = vertexLocations[this->edges[edgeIndex].vertexIndices[0]];
                     } else {
-                        vertexLocation = vertexLocations[this->edges[-edgeIndex].vertexIndices[1]];
+                        edgeIndex = -edgeIndex;
+                        vertex.location = vertexLocations[this->edges[edgeIndex].vertexIndices[1]];
                     }
 
-                    float u = glm::dot(textureInfo.s.axis, vertexLocation) + textureInfo.s.offset;
+                    float u = glm::dot(vertex.location, textureInfo.s.axis) + textureInfo.s.offset;
+                    float v = glm::dot(vertex.location, textureInfo.t.axis) + textureInfo.t.offset;
                     min_u = glm::min(u, min_u);
                     max_u = glm::max(u, max_u);
-
-                    float v = glm::dot(textureInfo.t.axis, vertexLocation) + textureInfo.t.offset;
                     min_v = glm::min(v, min_v);
                     max_v = glm::max(v, max_v);
+
+                    vertex.diffuseTexcoord.x = u / bspTexture.width;
+                    vertex.diffuseTexcoord.y = -v / bspTexture.height;
+                    min_texcoord = glm::min(min_texcoord, vertex.diffuseTexcoord);
+                    max_texcoord = glm::max(max_texcoord, vertex.diffuseTexcoord);
+                }
+
+                //textures repeat, so shifting by whole repeats centres every face on the origin, where half
+                //floats are most precise. faces spanning more than the quantizer's limit still lose precision
+                if (face.surfaceEdgeCount > 0) {
+                    const glm::vec2 texcoord_shift = glm::floor((min_texcoord + max_texcoord) * 0.5f);
+                    for (auto i = 0; i < face.surfaceEdgeCount; ++i) {
+                        sourceVertices[faceStartIndex + i].diffuseTexcoord -= texcoord_shift;
+                    }
+                }
+
+                IndexType* faceIndices = indices.data() + this->faceIndexRanges[faceIndex].start;
+                for (auto i = 2; i < face.surfaceEdgeCount; ++i) {
+                    *faceIndices++ = static_cast<IndexType>(faceStartIndex);
+                    *faceIndices++ = static_cast<IndexType>(faceStartIndex + i - 1);
+                    *faceIndices++ = static_cast<IndexType>(faceStartIndex + i);
                 }
 
+                //lighting
+                if (face.lightingStyles[0] == Face::LIGHTING_STYLE_NONE || static_cast<int>(face.lightmapOffset) < 0) continue;
+
                 float textureMin_u = glm::floor(min_u / 16);
                 float textureMin_v = glm::floor(min_v / 16);
                 float textureMax_u = glm::ceil(max_u / 16);
@@ -409,77 +613,578 @@ namespace Rendering::Scene {
                 textureSize.y = textureMax_v - textureMin_v + 1;
 
                 for (int surfaceEdgeIndex = 0; surfaceEdgeIndex < face.surfaceEdgeCount; ++surfaceEdgeIndex) {
-                    int edgeIndex = this->surfaceEdges[face.surfaceEdgeStartIndex + surfaceEdgeIndex];
-                    glm::vec3 vertexLocation;
-
-                    if (edgeIndex >= 0) {
-                        vertexLocation = vertexLocations[this->edges[edgeIndex].vertexIndices[0]];
-                    } else {
-                        vertexLocation = vertexLocations[this->edges[-edgeIndex].vertexIndices[1]];
-                    }
-
-                    float u = glm::dot(textureInfo.s.axis, vertexLocation) + textureInfo.s.offset;
-                    float v = glm::dot(textureInfo.t.axis, vertexLocation) + textureInfo.t.offset;
+                    GeometryCompiler::SourceVertexType& vertex = sourceVertices[faceStartIndex + surfaceEdgeIndex];
+                    float u = glm::dot(textureInfo.s.axis, vertex.location) + textureInfo.s.offset;
+                    float v = glm::dot(textureInfo.t.axis, vertex.location) + textureInfo.t.offset;
 
                     float lightmap_u = (textureSize.x / 2) + (u - ((min_u + max_u) / 2)) / 16;
                     float lightmap_v = (textureSize.y / 2) + (v - ((min_v + max_v) / 2)) / 16;
 
-                    glm::vec2& lightmapTexcoord = vertices[this->faceStartIndices[faceIndex] + surfaceEdgeIndex].lightmapTexcoord;
-                    lightmapTexcoord.x = lightmap_u / textureSize.x;
-                    lightmapTexcoord.y = lightmap_v / textureSize.y;
+                    //texel space for now, moved into atlas space once the face has been packed
+                    vertex.lightmapTexcoord.x = lightmap_u;
+                    vertex.lightmapTexcoord.y = lightmap_v;
                 }
 
-                int lightingDataSize = 3 * static_cast<int>(textureSize.x) * static_cast<int>(textureSize.y);
+                //one lightmap per style, back to back
+                const size_t lightingDataSize = LightmapAtlas::CHANNEL_COUNT * static_cast<size_t>(textureSize.x) * static_cast<size_t>(textureSize.y) * LightstyleCompositor::getLayerCount(face.lightingStyles);
+                if (static_cast<size_t>(face.lightmapOffset) + lightingDataSize > lightingData.size()) {
+                    faceLightmapErrors[faceIndex] = 1;
+                    continue;
+                }
 
-                boost::shared_ptr<Resources::Image> image = boost::make_shared<Resources::Image>(
-                        static_cast<Resources::Image::SizeType>(textureSize),
-                        8,
-                        Device::GPU::ColorType::RGB,
-                        lightingData.data() + face.lightmapOffset,
-                        lightingDataSize
-                );
+                faceLightmapSizes[faceIndex] = static_cast<glm::uvec2>(textureSize);
+            }
+        });
+
+        //lightmap atlas: tallest first so the shelves pack tightly, ties keep face order to stay deterministic
+        std::vector<size_t> litFaceIndices;
+        for (size_t faceIndex = 0; faceIndex < this->faces.size(); ++faceIndex) {
+            if (faceLightmapSizes[faceIndex].y > 0 && !faceLightmapErrors[faceIndex]) {
+                litFaceIndices.push_back(faceIndex);
+            }
+        }
+        std::stable_sort(litFaceIndices.begin(), litFaceIndices.end(), [&](size_t a, size_t b) {
+            return faceLightmapSizes[a].y > faceLightmapSizes[b].y;
+        });
+
+        std::vector<LightmapAtlas::Region> faceLightmapRegions(this->faces.size());
+        this->faceLightmapPageIndices.assign(this->faces.size(), LIGHTMAP_PAGE_NONE);
+
+        //the first style layer seeds the atlas, animated faces are recomposited on the first tick
+        this->lightstyleCompositor.clear();
+        for (size_t faceIndex : litFaceIndices) {
+            const unsigned char* lightmapData = reinterpret_cast<const unsigned char*>(lightingData.data()) + this->faces[faceIndex].lightmapOffset;
+            const LightmapAtlas::Region& region = faceLightmapRegions[faceIndex] = lightmapAtlas.insert(faceLightmapSizes[faceIndex], lightmapData);
+            this->faceLightmapPageIndices[faceIndex] = static_cast<int>(region.pageIndex);
+
+            if (LightstyleCompositor::isAnimated(this->faces[faceIndex].lightingStyles)) {
+                addLightstyleSurface(faceIndex, region.pageIndex, region.location, region.size, lightingData);
+            }
+        }
+
+        workers.parallelFor(0, litFaceIndices.size(), FACE_GRAIN_SIZE, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                const size_t faceIndex = litFaceIndices[i];
+                const size_t faceStartIndex = faceStartIndices[faceIndex];
+                for (int surfaceEdgeIndex = 0; surfaceEdgeIndex < this->faces[faceIndex].surfaceEdgeCount; ++surfaceEdgeIndex) {
+                    glm::vec2& lightmapTexcoord = sourceVertices[faceStartIndex + surfaceEdgeIndex].lightmapTexcoord;
+                    lightmapTexcoord = lightmapAtlas.getTexcoord(faceLightmapRegions[faceIndex], lightmapTexcoord);
+                }
+            }
+        });
+
+        for (size_t faceIndex = 0; faceIndex < this->faces.size(); ++faceIndex) {
+            if (faceLightmapErrors[faceIndex]) {
+                spdlog::error("Lightmap for face {} exceeds the lighting lump", faceIndex);
+            }
+        }
+
+        //the atlas texcoords are final, so vertices shared between unlit or same-page faces weld here
+        const size_t sourceByteCount = (sourceVertices.size() * sizeof(GeometryCompiler::SourceVertexType)) + (indices.size() * sizeof(IndexType));
+        const GeometryCompiler::Stats geometryStats = GeometryCompiler::compile(sourceVertices, indices, this->faceIndexRanges);
+        locationTransform = GeometryCompiler::pack(sourceVertices, vertices);
+
+        const size_t byteCount = (vertices.size() * sizeof(VertexType)) + (indices.size() * sizeof(IndexType));
+        spdlog::info("Level geometry: {} -> {} vertices, {} -> {} bytes, ACMR {:.2f} -> {:.2f}",
+                     geometryStats.sourceVertexCount, geometryStats.vertexCount, sourceByteCount, byteCount, geometryStats.sourceAcmr, geometryStats.acmr);
+    }
+
+    bool BSP::addLightstyleSurface(size_t faceIndex, size_t pageIndex, const glm::uvec2& location, const glm::uvec2& size, std::span<const char> lightingData) {
+        const Face& face = this->faces[faceIndex];
+        const size_t layersSize = static_cast<size_t>(size.x) * size.y * LightmapAtlas::CHANNEL_COUNT * LightstyleCompositor::getLayerCount(face.lightingStyles);
+        if (static_cast<int>(face.lightmapOffset) < 0 || static_cast<size_t>(face.lightmapOffset) + layersSize > lightingData.size()) {
+            return false;
+        }
+
+        const auto* layers = reinterpret_cast<const unsigned char*>(lightingData.data()) + face.lightmapOffset;
+        this->lightstyleCompositor.add(static_cast<uint32_t>(faceIndex), static_cast<uint32_t>(pageIndex), location, size, face.lightingStyles, { layers, layersSize });
+        return true;
+    }
+
+    bool BSP::loadCompiledLevel(const CompiledLevel& compiledLevel, const BSPLumpReader& reader, LevelGeometry& geometry) {
+        typedef CompiledLevel::Section Section;
+        try {
+            const auto metadata = compiledLevel.getValue<CompiledLevel::Metadata>(Section::METADATA);
+            const std::span<const VisibleSurfaceList::IndexRange> faceIndexRanges = compiledLevel.get<VisibleSurfaceList::IndexRange>(Section::FACE_INDEX_RANGES);
+            const std::span<const int> faceLightmapPageIndices = compiledLevel.get<int>(Section::FACE_LIGHTMAP_PAGE_INDICES);
+            const std::span<const unsigned char> lightmapPages = compiledLevel.get<unsigned char>(Section::LIGHTMAP_PAGES);
+            const std::span<const BSPVisibilityMatrix::WordType> visibility = compiledLevel.get<BSPVisibilityMatrix::WordType>(Section::VISIBILITY);
+            const std::span<const BSPVisibilityMatrix::WordType> hearability = compiledLevel.get<BSPVisibilityMatrix::WordType>(Section::HEARABILITY);
+            const std::span<const BSPPlane> planes = compiledLevel.get<BSPPlane>(Section::PLANES);
+            const std::span<const Node> nodes = compiledLevel.get<Node>(Section::NODES);
+            const std::span<const Leaf> leaves = compiledLevel.get<Leaf>(Section::LEAVES);
+            const std::span<const ClipNode> pointHullClipNodes = compiledLevel.get<ClipNode>(Section::POINT_HULL_CLIP_NODES);
+            const std::span<const CompiledLevel::Occluder> occluders = compiledLevel.get<CompiledLevel::Occluder>(Section::OCCLUDERS);
+            const std::span<const glm::vec3> occluderVertices = compiledLevel.get<glm::vec3>(Section::OCCLUDER_VERTICES);
+            const std::span<const int> faceOccluderIndices = compiledLevel.get<int>(Section::FACE_OCCLUDER_INDICES);
+            const size_t lightmapPageByteCount = static_cast<size_t>(metadata.lightmapPageSize) * metadata.lightmapPageSize * LightmapAtlas::CHANNEL_COUNT;
+
+            if (faceIndexRanges.size() != this->faces.size() ||
+                faceLightmapPageIndices.size() != this->faces.size() ||
+                lightmapPages.size() != lightmapPageByteCount * metadata.lightmapPageCount ||
+                metadata.visibilityBitCount + 1 != std::max<size_t>(leaves.size(), 1) ||
+                metadata.visLeafCount > metadata.visibilityBitCount ||
+                metadata.visibilityWordsPerRow != (metadata.visibilityBitCount + BSPVisibilityMatrix::WORD_BIT_COUNT - 1) / BSPVisibilityMatrix::WORD_BIT_COUNT ||
+                visibility.size() != static_cast<size_t>(metadata.visLeafCount) * metadata.visibilityWordsPerRow ||
+                hearability.size() != visibility.size() ||
+                pointHullClipNodes.size() != nodes.size() ||
+                faceOccluderIndices.size() != this->faces.size()) {
+                return false;
+            }
+
+            //child and plane indices are trusted like the lumps they came from, only the ranges into other sections are checked
+            for (const CompiledLevel::Occluder& occluder : occluders) {
+                if (static_cast<size_t>(occluder.vertexStartIndex) + occluder.vertexCount > occluderVertices.size()) return false;
+            }
+            for (const int occluderIndex : faceOccluderIndices) {
+                if (occluderIndex < -1 || occluderIndex >= static_cast<int>(occluders.size())) return false;
+            }
+
+            const std::span<const float> locatorNormals = compiledLevel.get<float>(Section::LOCATOR_NORMALS);
+            if (locatorNormals.size() != nodes.size() * 3) return false;
+            BSPPointLocator::Nodes locatorNodes;
+            for (size_t i = 0; i < locatorNodes.normals.size(); ++i) {
+                locatorNodes.normals[i] = locatorNormals.subspan(nodes.size() * i, nodes.size());
+            }
+            locatorNodes.distances = compiledLevel.get<float>(Section::LOCATOR_DISTANCES);
+            locatorNodes.axes = compiledLevel.get<int8_t>(Section::LOCATOR_AXES);
+            locatorNodes.frontChildIndices = compiledLevel.get<int>(Section::LOCATOR_FRONT_CHILD_INDICES);
+            locatorNodes.backChildIndices = compiledLevel.get<int>(Section::LOCATOR_BACK_CHILD_INDICES);
+            if (locatorNodes.distances.size() != nodes.size()) return false;
+
+            BSPTraversal::Tree tree;
+            tree.nodePlanes = compiledLevel.get<glm::vec4>(Section::TRAVERSAL_NODE_PLANES);
+            tree.nodeChildIndices = compiledLevel.get<BSPTraversal::ChildIndicesType>(Section::TRAVERSAL_NODE_CHILD_INDICES);
+            tree.nodeBounds = compiledLevel.get<BSPTraversal::AABBType>(Section::TRAVERSAL_NODE_BOUNDS);
+            tree.nodeParents = compiledLevel.get<int>(Section::TRAVERSAL_NODE_PARENTS);
+            tree.leafBounds = compiledLevel.get<BSPTraversal::AABBType>(Section::TRAVERSAL_LEAF_BOUNDS);
+            tree.leafParents = compiledLevel.get<int>(Section::TRAVERSAL_LEAF_PARENTS);
+            if (tree.nodePlanes.size() != nodes.size() || tree.leafBounds.size() != leaves.size()) return false;
+
+            const size_t indexCount = compiledLevel.get<IndexType>(Section::INDICES).size();
+            for (size_t faceIndex = 0; faceIndex < this->faces.size(); ++faceIndex) {
+                const VisibleSurfaceList::IndexRange& indexRange = faceIndexRanges[faceIndex];
+                const int lightmapPageIndex = faceLightmapPageIndices[faceIndex];
+                if (static_cast<size_t>(indexRange.start) + indexRange.count > indexCount ||
+                    lightmapPageIndex < LIGHTMAP_PAGE_NONE ||
+                    lightmapPageIndex >= static_cast<int>(metadata.lightmapPageCount)) {
+                    return false;
+                }
+            }
+
+            const std::span<const CompiledLevel::LightstyleSurface> lightstyleSurfaces = compiledLevel.get<CompiledLevel::LightstyleSurface>(Section::LIGHTSTYLE_SURFACES);
+            for (const CompiledLevel::LightstyleSurface& surface : lightstyleSurfaces) {
+                if (surface.faceIndex >= this->faces.size() ||
+                    surface.pageIndex >= metadata.lightmapPageCount ||
+                    surface.location[0] + surface.size[0] + LightmapAtlas::PADDING > metadata.lightmapPageSize ||
+                    surface.location[1] + surface.size[1] + LightmapAtlas::PADDING > metadata.lightmapPageSize ||
+                    surface.location[0] < LightmapAtlas::PADDING ||
+                    surface.location[1] < LightmapAtlas::PADDING) {
+                    return false;
+                }
+            }
+
+            //the style layers are not duplicated in the compiled level, they come straight from the lighting lump
+            const std::span<const char> lightingData = reader.getBytes(BSPChunk::Type::LIGHTING);
+            this->lightstyleCompositor.clear();
+            for (const CompiledLevel::LightstyleSurface& surface : lightstyleSurfaces) {
+                if (!addLightstyleSurface(surface.faceIndex, surface.pageIndex, glm::uvec2(surface.location[0], surface.location[1]), glm::uvec2(surface.size[0], surface.size[1]), lightingData)) {
+                    this->lightstyleCompositor.clear();
+                    return false;
+                }
+            }
+
+            //everything checks out, nothing below can fail
+            geometry.vertices = compiledLevel.get<VertexType>(Section::VERTICES);
+            geometry.indices = compiledLevel.get<IndexType>(Section::INDICES);
+            geometry.locationTransform.offset = glm::vec3(metadata.locationOffset[0], metadata.locationOffset[1], metadata.locationOffset[2]);
+            geometry.locationTransform.scale = glm::vec3(metadata.locationScale[0], metadata.locationScale[1], metadata.locationScale[2]);
+            geometry.lightmapPageSize = glm::uvec2(metadata.lightmapPageSize);
+            for (uint32_t i = 0; i < metadata.lightmapPageCount; ++i) {
+                geometry.lightmapPages.push_back(lightmapPages.subspan(lightmapPageByteCount * i, lightmapPageByteCount));
+            }
+
+            this->faceIndexRanges.assign(faceIndexRanges.begin(), faceIndexRanges.end());
+            this->faceLightmapPageIndices.assign(faceLightmapPageIndices.begin(), faceLightmapPageIndices.end());
+
+            //the assigns below only throw on sizes that disagree, which leaves the level for a rebuild that overwrites all of it
+            this->traversal.assign(tree, this->faces.size());
+            this->pointLocator.assign(locatorNodes);
+            this->visibility.assign(metadata.visLeafCount, leaves.size(), visibility);
+            this->hearability.assign(metadata.visLeafCount, leaves.size(), hearability);
+
+            const std::span<const Model> models = compiledLevel.get<Model>(Section::MODELS);
+            const std::span<const TextureInfo> textureInfos = compiledLevel.get<TextureInfo>(Section::TEXTURE_INFOS);
+            this->planes.assign(planes.begin(), planes.end());
+            this->nodes.assign(nodes.begin(), nodes.end());
+            this->leaves.assign(leaves.begin(), leaves.end());
+            this->models.assign(models.begin(), models.end());
+            this->textureInfos.assign(textureInfos.begin(), textureInfos.end());
+            this->pointHullClipNodes.assign(pointHullClipNodes.begin(), pointHullClipNodes.end());
+
+            this->occluders.clear();
+            for (const CompiledLevel::Occluder& compiledOccluder : occluders) {
+                Occluder& occluder = this->occluders.emplace_back();
+                occluder.vertexStartIndex = compiledOccluder.vertexStartIndex;
+                occluder.vertexCount = compiledOccluder.vertexCount;
+                occluder.center = glm::vec3(compiledOccluder.center[0], compiledOccluder.center[1], compiledOccluder.center[2]);
+                occluder.radius = compiledOccluder.radius;
+                occluder.area = compiledOccluder.area;
+            }
+            this->occluderVertices.assign(occluderVertices.begin(), occluderVertices.end());
+            this->faceOccluderIndices.assign(faceOccluderIndices.begin(), faceOccluderIndices.end());
+            this->occluderFrames.assign(this->occluders.size(), 0);
+            return true;
+        } catch (const std::exception&) {
+            return false;
+        }
+    }
+
+    void BSP::writeCompiledLevel(const std::string& cacheName, uint32_t sourceChecksum, const LevelGeometry& geometry) const {
+        typedef CompiledLevel::Section Section;
+        CompiledLevel::Writer writer;
+
+        CompiledLevel::Metadata metadata;
+        metadata.visLeafCount = static_cast<uint32_t>(this->visibility.getRowCount());
+        metadata.visibilityBitCount = static_cast<uint32_t>(this->visibility.getColumnCount());
+        metadata.visibilityWordsPerRow = static_cast<uint32_t>(this->visibility.getWordsPerRow());
+        metadata.lightmapPageCount = static_cast<uint32_t>(geometry.lightmapPages.size());
+        metadata.lightmapPageSize = geometry.lightmapPageSize.x;
+        for (int i = 0; i < 3; ++i) {
+            metadata.locationOffset[i] = geometry.locationTransform.offset[i];
+            metadata.locationScale[i] = geometry.locationTransform.scale[i];
+        }
+        writer.set(Section::METADATA, metadata);
+
+        writer.set(Section::VERTICES, geometry.vertices);
+        writer.set(Section::INDICES, geometry.indices);
+        writer.set(Section::FACE_INDEX_RANGES, this->faceIndexRanges);
+        writer.set(Section::FACE_LIGHTMAP_PAGE_INDICES, this->faceLightmapPageIndices);
+
+        std::string lightmapPages;
+        for (const std::span<const unsigned char>& page : geometry.lightmapPages) {
+            lightmapPages.append(reinterpret_cast<const char*>(page.data()), page.size());
+        }
+        writer.setBytes(Section::LIGHTMAP_PAGES, std::move(lightmapPages));
+
+        std::vector<CompiledLevel::LightstyleSurface> lightstyleSurfaces;
+        for (const LightstyleCompositor::Surface& surface : this->lightstyleCompositor.getSurfaces()) {
+            CompiledLevel::LightstyleSurface& lightstyleSurface = lightstyleSurfaces.emplace_back();
+            lightstyleSurface.faceIndex = surface.faceIndex;
+            lightstyleSurface.pageIndex = surface.pageIndex;
+            lightstyleSurface.location[0] = surface.location.x;
+            lightstyleSurface.location[1] = surface.location.y;
+            lightstyleSurface.size[0] = surface.size.x;
+            lightstyleSurface.size[1] = surface.size.y;
+        }
+        writer.set(Section::LIGHTSTYLE_SURFACES, lightstyleSurfaces);
+
+        writer.set(Section::VISIBILITY, this->visibility.getWords());
+        writer.set(Section::HEARABILITY, this->hearability.getWords());
+
+        writer.set(Section::PLANES, this->planes);
+        writer.set(Section::NODES, this->nodes);
+        writer.set(Section::LEAVES, this->leaves);
+        writer.set(Section::MODELS, this->models);
+        writer.set(Section::TEXTURE_INFOS, this->textureInfos);
+
+        const BSPTraversal::Tree tree = this->traversal.getTree();
+        writer.set(Section::TRAVERSAL_NODE_PLANES, tree.nodePlanes);
+        writer.set(Section::TRAVERSAL_NODE_CHILD_INDICES, tree.nodeChildIndices);
+        writer.set(Section::TRAVERSAL_NODE_BOUNDS, tree.nodeBounds);
+        writer.set(Section::TRAVERSAL_NODE_PARENTS, tree.nodeParents);
+        writer.set(Section::TRAVERSAL_LEAF_BOUNDS, tree.leafBounds);
+        writer.set(Section::TRAVERSAL_LEAF_PARENTS, tree.leafParents);
+
+        const BSPPointLocator::Nodes locatorNodes = this->pointLocator.getNodes();
+        std::vector<float> locatorNormals;
+        for (const std::span<const float>& normal : locatorNodes.normals) {
+            locatorNormals.insert(locatorNormals.end(), normal.begin(), normal.end());
+        }
+        writer.set(Section::LOCATOR_NORMALS, locatorNormals);
+        writer.set(Section::LOCATOR_DISTANCES, locatorNodes.distances);
+        writer.set(Section::LOCATOR_AXES, locatorNodes.axes);
+        writer.set(Section::LOCATOR_FRONT_CHILD_INDICES, locatorNodes.frontChildIndices);
+        writer.set(Section::LOCATOR_BACK_CHILD_INDICES, locatorNodes.backChildIndices);
+
+        writer.set(Section::POINT_HULL_CLIP_NODES, this->pointHullClipNodes);
+
+        std::vector<CompiledLevel::Occluder> occluders;
+        for (const Occluder& occluder : this->occluders) {
+            CompiledLevel::Occluder& compiledOccluder = occluders.emplace_back();
+            compiledOccluder.vertexStartIndex = static_cast<uint32_t>(occluder.vertexStartIndex);
+            compiledOccluder.vertexCount = static_cast<uint32_t>(occluder.vertexCount);
+            for (int i = 0; i < 3; ++i) {
+                compiledOccluder.center[i] = occluder.center[i];
+            }
+            compiledOccluder.radius = occluder.radius;
+            compiledOccluder.area = occluder.area;
+        }
+        writer.set(Section::OCCLUDERS, occluders);
+        writer.set(Section::OCCLUDER_VERTICES, this->occluderVertices);
+        writer.set(Section::FACE_OCCLUDER_INDICES, this->faceOccluderIndices);
+
+        writer.write(cacheName, sourceChecksum, getCompiledLevelLayoutChecksum());
+    }
+
+    //node and leaf bounds are swizzled from file space, so the z extents come out reversed
+    static BSPTraversal::AABBType getTraversalBounds(const ::Scenes::Structure::AABB3<short>& aabb) {
+        const glm::vec3 a = static_cast<glm::vec3>(aabb.min);
+        const glm::vec3 b = static_cast<glm::vec3>(aabb.max);
+        return { glm::min(a, b), glm::max(a, b) };
+    }
+
+    //engine axis of an axial plane, file y is engine z. Checked against the normal, since only an
+    //exact unit component makes the single coordinate test match the dot product
+    static int getPlaneAxis(const BSP::BSPPlane& plane) {
+        int axis = BSPPointLocator::AXIS_NONE;
+        switch (plane.type) {
+            case BSP::BSPPlane::Type::X: axis = 0; break;
+            case BSP::BSPPlane::Type::Y: axis = 2; break;
+            case BSP::BSPPlane::Type::Z: axis = 1; break;
+            default: break;
+        }
+        if (axis != BSPPointLocator::AXIS_NONE && glm::abs(plane.plane.normal[axis]) != 1.0f) return BSPPointLocator::AXIS_NONE;
+        return axis;
+    }
+
+    void BSP::buildTraversal() {
+        this->traversal.reset(this->nodes.size(), this->leaves.size(), this->faces.size());
+        this->pointLocator.reset(this->nodes.size());
+
+        for (size_t i = 0; i < this->nodes.size(); ++i) {
+            const Node& node = this->nodes[i];
+            const BSPPlane& plane = this->planes[node.planeIndex];
+            this->traversal.setNode(i, plane.plane.normal, plane.plane.distance, { node.childIndices[0], node.childIndices[1] }, getTraversalBounds(node.aabb));
+            this->pointLocator.setNode(i, plane.plane.normal, plane.plane.distance, getPlaneAxis(plane), node.childIndices[0], node.childIndices[1]);
+        }
+        for (size_t i = 0; i < this->leaves.size(); ++i) {
+            this->traversal.setLeaf(i, getTraversalBounds(this->leaves[i].aabb));
+        }
+
+        this->traversal.build();
+    }
+
+    void BSP::buildOccluders(const std::vector<glm::vec3>& vertexLocations, const std::vector<std::string>& textureNames) {
+        //faces smaller than this (a 64x64 square) cost more to rasterize than they hide
+        static const float MIN_OCCLUDER_AREA = 4096.0f;
+
+        this->occluders.clear();
+        this->occluderVertices.clear();
+        this->faceOccluderIndices.assign(this->faces.size(), -1);
+        if (this->models.empty()) return;
+
+        const Model& world = this->models[0];
+        std::vector<glm::vec3> polygon;
+        for (int faceIndex = world.faceStartIndex; faceIndex < world.faceStartIndex + world.faceCount; ++faceIndex) {
+            const Face& face = this->faces[faceIndex];
+            if (face.lightingStyles[0] == Face::LIGHTING_STYLE_NONE) continue;
+            if (face.surfaceEdgeCount < 3 || face.surfaceEdgeCount > OcclusionBuffer::MAX_POLYGON_VERTEX_COUNT) continue;
+
+            //alpha tested and liquid surfaces can be seen through
+            const std::string& textureName = textureNames[this->textureInfos[face.textureInfoIndex].textureIndex];
+            if (textureName.starts_with('{') || textureName.starts_with('!')) continue;
+
+            polygon.clear();
+            for (unsigned int i = 0; i < face.surfaceEdgeCount; ++i) {
+                const int edgeIndex = this->surfaceEdges[face.surfaceEdgeStartIndex + i];
+                polygon.push_back(vertexLocations[edgeIndex >= 0 ? this->edges[edgeIndex].vertexIndices[0] : this->edges[-edgeIndex].vertexIndices[1]]);
+            }
+
+            glm::vec3 normal(0.0f);
+            glm::vec3 center(0.0f);
+            for (size_t i = 0; i < polygon.size(); ++i) {
+                normal += glm::cross(polygon[i], polygon[(i + 1) % polygon.size()]);
+                center += polygon[i];
+            }
+            const float area = glm::length(normal) * 0.5f;
+            if (area < MIN_OCCLUDER_AREA) continue;
+            center /= static_cast<float>(polygon.size());
+
+            Occluder occluder;
+            occluder.vertexStartIndex = this->occluderVertices.size();
+            occluder.vertexCount = polygon.size();
+            occluder.center = center;
+            occluder.area = area;
+            for (const glm::vec3& vertex : polygon) {
+                occluder.radius = glm::max(occluder.radius, glm::distance(center, vertex));
+            }
+
+            this->faceOccluderIndices[faceIndex] = static_cast<int>(this->occluders.size());
+            this->occluders.push_back(occluder);
+            this->occluderVertices.insert(this->occluderVertices.end(), polygon.begin(), polygon.end());
+        }
+        this->occluderFrames.assign(this->occluders.size(), 0);
+    }
+
+    void BSP::rasterizeOccluders(const View::CameraParameters& cameraParameters) {
+        static const float MAX_OCCLUDER_DISTANCE = 2048.0f;
+        static const size_t MAX_OCCLUDER_COUNT = 128;
+
+        //occluders come from the faces of the visible leaves, biggest on screen first
+        ++this->occluderFrame;
+        this->occluderCandidates.clear();
+        for (const int leafIndex : this->viewLeaves) {
+            const Leaf& leaf = this->leaves[leafIndex];
+            for (int i = 0; i < leaf.markSurfaceCount; ++i) {
+                const int occluderIndex = this->faceOccluderIndices[this->markSurfaces[leaf.markSurfaceStartIndex + i]];
+                if (occluderIndex < 0 || this->occluderFrames[occluderIndex] == this->occluderFrame) continue;
+                this->occluderFrames[occluderIndex] = this->occluderFrame;
+
+                const Occluder& occluder = this->occluders[occluderIndex];
+                const float distance = glm::max(glm::distance(cameraParameters.location, occluder.center) - occluder.radius, 1.0f);
+                if (distance > MAX_OCCLUDER_DISTANCE) continue;
+                this->occluderCandidates.emplace_back(occluder.area / (distance * distance), occluderIndex);
+            }
+        }
 
-                boost::shared_ptr<Resources::Texture> lightmapTexture = boost::make_shared<Resources::Texture>(image);
-                this->faceLightmapTextures[faceIndex] = lightmapTexture;
+        if (this->occluderCandidates.size() > MAX_OCCLUDER_COUNT) {
+            std::nth_element(this->occluderCandidates.begin(), this->occluderCandidates.begin() + MAX_OCCLUDER_COUNT, this->occluderCandidates.end(), std::greater<>());
+            this->occluderCandidates.resize(MAX_OCCLUDER_COUNT);
+        }
+
+        this->occlusionBuffer.begin(cameraParameters.projectionMatrix * cameraParameters.viewMatrix);
+        for (const std::pair<float, int>& candidate : this->occluderCandidates) {
+            const Occluder& occluder = this->occluders[candidate.second];
+            if (this->occlusionBuffer.addOccluder(std::span(this->occluderVertices).subspan(occluder.vertexStartIndex, occluder.vertexCount))) {
+                ++this->renderStats.occluderCount;
             }
         }
+        this->occlusionBuffer.rasterize();
+    }
+
+    void BSP::collectViewLeaves(const View::CameraParameters& cameraParameters, BSPTraversal::Stats& stats) {
+        this->viewLeaves.clear();
+        if (this->renderSettings.visibilitySplitDepth == 0) {
+            this->traversal.traverse(0, cameraParameters.location, cameraParameters.frustum, glm::vec3(0.0f), true, stats, [this](int leafIndex) {
+                this->viewLeaves.push_back(leafIndex);
+            });
+            return;
+        }
 
-        //entities
-        const BSPChunk& entitiesChunk = chunks[static_cast<size_t>(BSPChunk::Type::ENTITIES)];
-        istream.seekg(entitiesChunk.offset, std::ios_base::beg);
-        std::vector<char> entitiesBuffer;
-        Resources::IO::read(istream, entitiesBuffer, entitiesChunk.length);
-        std::string entitiesString = entitiesBuffer.data();
-        size_t end = -1;
+        //the top of the tree is walked here, every subtree below the split depth is a job of its own
+        this->visibilitySubtrees.clear();
+        this->traversal.split(0, cameraParameters.location, cameraParameters.frustum, this->renderSettings.visibilitySplitDepth, stats, this->visibilitySubtrees);
+        if (this->visibilityJobs.size() < this->visibilitySubtrees.size()) {
+            this->visibilityJobs.resize(this->visibilitySubtrees.size());
+        }
 
-        for (;;) {
-            unsigned long begin = entitiesString.find_first_of('{', end + 1);
+        Core::Threading::workers.parallelFor(0, this->visibilitySubtrees.size(), 1, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                VisibilityJob& job = this->visibilityJobs[i];
+                job.leafIndices.clear();
+                job.stats = BSPTraversal::Stats();
+                this->traversal.traverseSubtree(this->visibilitySubtrees[i], cameraParameters.location, cameraParameters.frustum, job.stack, job.stats, [&job](int leafIndex) {
+                    job.leafIndices.push_back(leafIndex);
+                });
+            }
+        });
+
+        //split emits subtrees in the order the walk pops them (near child first), and every job walks
+        //its subtree the same way, so appending the jobs in order gives the serial front to back order
+        for (size_t i = 0; i < this->visibilitySubtrees.size(); ++i) {
+            const VisibilityJob& job = this->visibilityJobs[i];
+            this->viewLeaves.insert(this->viewLeaves.end(), job.leafIndices.begin(), job.leafIndices.end());
+            stats += job.stats;
+        }
+    }
 
-            if (begin == -1) break;
+    void BSP::collectVisibleSurfaces(std::span<const int> leafIndices) {
+        static const size_t LEAF_GRAIN_SIZE = 64;
 
-            end = entitiesString.find_first_of('}', begin + 1);
-            std::string entityString = entitiesString.substr(begin + 1, end - begin - 1);
-            BSPEntity entity(entityString);
-            boost::optional<std::string> modelOptional = entity.getOptional<std::string>("model");
-            if (modelOptional) {
-                std::string model = modelOptional.get();
-                if (boost::algorithm::starts_with(model, "*")) {
-                    this->brushEntityIndices.push_back(this->entities.size());
+        auto addFace = [this](unsigned int faceIndex) {
+            const Face& face = this->faces[faceIndex];
+            const unsigned int textureIndex = this->textureInfos[face.textureInfoIndex].textureIndex;
+            this->visibleSurfaces.add(textureIndex, this->faceLightmapPageIndices[faceIndex], faceIndex);
+            ++this->renderStats.faceCount;
+        };
+        this->renderStats.leafCount += static_cast<unsigned int>(leafIndices.size());
+
+        if (this->renderSettings.visibilitySplitDepth == 0 || leafIndices.size() < LEAF_GRAIN_SIZE * 2) {
+            for (const int leafIndex : leafIndices) {
+                const Leaf& leaf = this->leaves[leafIndex];
+                for (int i = 0; i < leaf.markSurfaceCount; ++i) {
+                    const unsigned short faceIndex = this->markSurfaces[leaf.markSurfaceStartIndex + i];
+                    if (this->faces[faceIndex].lightingStyles[0] == Face::LIGHTING_STYLE_NONE) continue;
+                    if (!this->traversal.markFace(faceIndex)) continue;
+                    addFace(faceIndex);
                 }
             }
-            this->entities.emplace_back(std::move(entity));
+            return;
+        }
+
+        //runs of leaves go to jobs, a face shared between runs is claimed by whichever gets there first.
+        //Leaf order does not matter past this point, the surface list sorts its keys
+        const size_t jobCount = (leafIndices.size() + LEAF_GRAIN_SIZE - 1) / LEAF_GRAIN_SIZE;
+        if (this->visibilityJobs.size() < jobCount) {
+            this->visibilityJobs.resize(jobCount);
         }
 
-        this->vertexBuffer = Device::GPU::Buffers::gpuBuffers.make<VertexBufferType>().lock();
-        this->vertexBuffer->data(vertices, Device::GPU::Gpu::BufferUsage::STATIC_DRAW);
-        this->indexBuffer = Device::GPU::Buffers::gpuBuffers.make<IndexBufferType>().lock();
-        this->indexBuffer->data(indices, Device::GPU::Gpu::BufferUsage::STATIC_DRAW);
+        Core::Threading::workers.parallelFor(0, jobCount, 1, [&](size_t begin, size_t end) {
+            for (size_t jobIndex = begin; jobIndex < end; ++jobIndex) {
+                VisibilityJob& job = this->visibilityJobs[jobIndex];
+                job.faceIndices.clear();
+                const size_t leafEnd = std::min(leafIndices.size(), (jobIndex + 1) * LEAF_GRAIN_SIZE);
+                for (size_t i = jobIndex * LEAF_GRAIN_SIZE; i < leafEnd; ++i) {
+                    const Leaf& leaf = this->leaves[leafIndices[i]];
+                    for (int j = 0; j < leaf.markSurfaceCount; ++j) {
+                        const unsigned short faceIndex = this->markSurfaces[leaf.markSurfaceStartIndex + j];
+                        if (this->faces[faceIndex].lightingStyles[0] == Face::LIGHTING_STYLE_NONE) continue;
+                        if (!this->traversal.markFaceShared(faceIndex)) continue;
+                        job.faceIndices.push_back(faceIndex);
+                    }
+                }
+            }
+        });
+
+        for (size_t jobIndex = 0; jobIndex < jobCount; ++jobIndex) {
+            for (const unsigned int faceIndex : this->visibilityJobs[jobIndex].faceIndices) {
+                addFace(faceIndex);
+            }
+        }
+    }
+
+    const std::vector<int>& BSP::collectVisibleLeaves(const View::CameraParameters& cameraParameters) {
+        //padding keeps a leaf from being hidden by the faces on its own boundary
+        static const glm::vec3 LEAF_PADDING(1.0f);
+
+        BSPTraversal::Stats traversalStats;
+        this->traversal.beginFrame(getLeafIndexFromLocation(cameraParameters.location), this->visibility);
+        collectViewLeaves(cameraParameters, traversalStats);
+        this->renderStats.culledNodeCount += traversalStats.culledNodeCount;
+        this->renderStats.culledLeafCount += traversalStats.culledLeafCount;
+
+        if (!this->renderSettings.useOcclusionCulling || this->occluders.empty()) return this->viewLeaves;
+
+        rasterizeOccluders(cameraParameters);
+        const size_t viewLeafCount = this->viewLeaves.size();
+        std::erase_if(this->viewLeaves, [this](int leafIndex) {
+            const BSPTraversal::AABBType& bounds = this->traversal.getLeafBounds(leafIndex);
+            return !this->occlusionBuffer.isVisible(BSPTraversal::AABBType(bounds.min - LEAF_PADDING, bounds.max + LEAF_PADDING));
+        });
+        this->renderStats.occludedLeafCount += static_cast<unsigned int>(viewLeafCount - this->viewLeaves.size());
+        return this->viewLeaves;
     }
 
     void BSP::render(const View::CameraParameters& cameraParameters) {
-        boost::dynamic_bitset<> facesRendered = boost::dynamic_bitset<>(this->faces.size());
-        facesRendered.reset();
-        int cameraLeafIndex = getLeafIndexFromLocation(cameraParameters.location);
+        View::RenderView view;
+        view.cameraParameters = cameraParameters;
+        render(std::span<const View::RenderView>(&view, 1));
+    }
+
+    void BSP::render(std::span<const View::RenderView> views) {
+        if (!isUploaded() || views.empty()) return;
+
+        this->renderStats.reset();
+
+        //views in the same leaf go back to back, so the traversal marks the PVS once for all of them
+        this->viewOrder.clear();
+        for (size_t i = 0; i < views.size(); ++i) {
+            this->viewOrder.emplace_back(getLeafIndexFromLocation(views[i].cameraParameters.location), i);
+        }
+        std::stable_sort(this->viewOrder.begin(), this->viewOrder.end(), [](const std::pair<int, size_t>& a, const std::pair<int, size_t>& b) {
+            return a.first < b.first;
+        });
 
         //culling
         Device::GPU::Gpu::CullingStateManager::CullingState cullingState = Device::GPU::gpu.culling.getState();
@@ -503,36 +1208,52 @@ namespace Rendering::Scene {
         const boost::shared_ptr<BSPShader> gpuShader = Device::GPU::Shaders::shaders.get<BSPShader>();
         Device::GPU::gpu.programs.push(gpuShader);
 
-        Device::GPU::gpu.setUniform("world_matrix", glm::mat4());
-        Device::GPU::gpu.setUniform(
-                "view_projection_matrix",
-                cameraParameters.projectionMatrix * cameraParameters.viewMatrix
-        );
-        Device::GPU::gpu.setUniform("diffuse_texture", DIFFUSE_TEXTURE_INDEX);
-        Device::GPU::gpu.setUniform("lightmap_texture", LIGHTMAP_TEXTURE_INDEX);
-        Device::GPU::gpu.setUniform("lightmap_gamma", renderSettings.lightmap_gamma);
+        //state shared by every view is set once, through handles reflected at link time
+        gpuShader->locationOffset.set(this->locationTransform.offset);
+        gpuShader->locationScale.set(this->locationTransform.scale);
+        gpuShader->diffuseTexture.set(DIFFUSE_TEXTURE_INDEX);
+        gpuShader->lightmapTexture.set(LIGHTMAP_TEXTURE_INDEX);
+        gpuShader->lightmapGamma.set(renderSettings.lightmap_gamma);
 
         auto renderFace = [&](int face_index) {
-            if (facesRendered[face_index]) return;
             const Face& face = this->faces[face_index];
             if (face.lightingStyles[0] == Face::LIGHTING_STYLE_NONE) return;
+            if (!this->traversal.markFace(face_index)) return;
 
-            const boost::shared_ptr<Resources::Texture>& diffuseTexture = this->textures[this->textureInfos[face.textureInfoIndex].textureIndex];
-            const boost::shared_ptr<Resources::Texture>& lightmapTexture = this->faceLightmapTextures[face_index];
-            Device::GPU::gpu.textures.bind(DIFFUSE_TEXTURE_INDEX, diffuseTexture);
-            Device::GPU::gpu.textures.bind(LIGHTMAP_TEXTURE_INDEX, lightmapTexture);
+            const unsigned int textureIndex = this->textureInfos[face.textureInfoIndex].textureIndex;
+            this->visibleSurfaces.add(textureIndex, this->faceLightmapPageIndices[face_index], face_index);
 
-            Device::GPU::gpu.drawElements(
-                    Device::GPU::Gpu::PrimitiveType::TRIANGLE_FAN,
-                    face.surfaceEdgeCount,
-                    IndexBufferType::DATA_TYPE,
-                    this->faceStartIndices[face_index] * sizeof(IndexType)
-            );
-
-            facesRendered[face_index] = true;
             ++this->renderStats.faceCount;
         };
 
+        //submits the collected surfaces, one multi-draw per texture and lightmap page
+        auto flushSurfaces = [&]() {
+            this->visibleSurfaces.build([this](unsigned int face_index) { return this->faceIndexRanges[face_index]; });
+
+            for (const VisibleSurfaceList::Batch& batch : this->visibleSurfaces.getBatches()) {
+                const boost::shared_ptr<Resources::Texture>& diffuseTexture = this->textures[batch.textureIndex];
+                const boost::shared_ptr<Resources::Texture> lightmapTexture = batch.lightmapPageIndex != LIGHTMAP_PAGE_NONE ? this->lightmapPageTextures[batch.lightmapPageIndex] : nullptr;
+
+                if (Device::GPU::gpu.textures.bind(DIFFUSE_TEXTURE_INDEX, diffuseTexture).lock() != diffuseTexture) {
+                    ++this->renderStats.stateChangeCount;
+                }
+                if (Device::GPU::gpu.textures.bind(LIGHTMAP_TEXTURE_INDEX, lightmapTexture).lock() != lightmapTexture) {
+                    ++this->renderStats.stateChangeCount;
+                }
+
+                Device::GPU::gpu.multiDrawElements(
+                        Device::GPU::Gpu::PrimitiveType::TRIANGLES,
+                        this->visibleSurfaces.getCounts(batch),
+                        IndexBufferType::DATA_TYPE,
+                        this->visibleSurfaces.getOffsets(batch),
+                        batch.drawCount
+                );
+                ++this->renderStats.drawCallCount;
+            }
+
+            this->visibleSurfaces.clear();
+        };
+
         auto renderLeaf = [&](NodeIndexType leaf_index) {
             const Leaf& leaf = this->leaves[leaf_index];
             for (int i = 0; i < leaf.markSurfaceCount; ++i) {
@@ -541,111 +1262,40 @@ namespace Rendering::Scene {
             ++this->renderStats.leafCount;
         };
 
-        std::function<void(NodeIndexType, NodeIndexType)> renderNode = [&](NodeIndexType node_index, NodeIndexType camera_leaf_index) {
-            if (node_index < 0) {
-                if (node_index == -1) return;
-                auto leafPvsMapItr = this->leafPvsMap.find(camera_leaf_index - 1);
-                if (camera_leaf_index > 0 &&
-                    leafPvsMapItr != this->leafPvsMap.end() &&
-                    !this->leafPvsMap[camera_leaf_index - 1][~node_index - 1]) return;
-
-                renderLeaf(~node_index);
-                return;
-            }
-
-            const Node& node = this->nodes[node_index];
-            const BSPPlane& plane = this->planes[node.planeIndex];
-            float distance = 0;
-
-            switch (plane.type) {
-                case BSPPlane::Type::X:
-                    distance = cameraParameters.location.x - plane.plane.distance;
-                    break;
-                case BSPPlane::Type::Y:
-                    distance = cameraParameters.location.y - plane.plane.distance;
-                    break;
-                case BSPPlane::Type::Z:
-                    distance = cameraParameters.location.z - plane.plane.distance;
-                    break;
-                default:
-                    distance = glm::dot(plane.plane.normal, cameraParameters.location) - plane.plane.distance;
-            }
-
-            if (distance > 0) {
-                renderNode(node.childIndices[1], camera_leaf_index);
-                renderNode(node.childIndices[0], camera_leaf_index);
-            } else {
-                renderNode(node.childIndices[0], camera_leaf_index);
-                renderNode(node.childIndices[1], camera_leaf_index);
-            }
+        BSPTraversal::Stats traversalStats;
+        const View::CameraParameters* camera_parameters = nullptr;
+        auto renderNode = [&](NodeIndexType head_node_index, const glm::vec3& offset, bool use_pvs) {
+            this->traversal.traverse(head_node_index, camera_parameters->location, camera_parameters->frustum, offset, use_pvs, traversalStats, renderLeaf);
         };
 
-        auto renderBrushEntity = [&](size_t entity_index) {
-//            return;
-
-            const BSPEntity& entity = this->entities[entity_index];
-            const int modelIndex = boost::lexical_cast<int>(entity.get("model").substr(1));
-            const Model& model = this->models[modelIndex];
-
-            //render mode
-            boost::optional<int> renderModeOptional = entity.getOptional<int>("rendermode");
-            RenderMode renderMode = RenderMode::NORMAL;
-            if (renderModeOptional) renderMode = static_cast<RenderMode>(renderModeOptional.get());
-
-            //alpha
-            float alpha = 1.0f;
-            boost::optional<unsigned char> alphaOptional = entity.getOptional<unsigned char>("renderamt");
-            if (alphaOptional) alpha = static_cast<float>(alphaOptional.get()) / 255.0f;
-
-            //origin
-            glm::vec3 origin;
-            boost::optional<std::string> originOptional = entity.getOptional("origin");
-            if (originOptional) {
-                boost::is_any_of(" ");
-                std::vector<std::string> tokens;
-
-#if defined(_MSC_VER) && _MSC_VER >= 1400
-                #pragma warning(push)
-#pragma warning(disable:4996)
-#endif
-                boost::algorithm::split(tokens, originOptional.get(), boost::is_any_of(" "), boost::algorithm::token_compress_on);
-#if defined(_MSC_VER) && _MSC_VER >= 1400
-#pragma warning(pop)
-#endif
-                origin.x = boost::lexical_cast<float>(tokens[0]);
-                origin.y = boost::lexical_cast<float>(tokens[2]);
-                origin.z = -boost::lexical_cast<float>(tokens[1]);
+        auto renderBrushEntity = [&](const BrushEntityRenderRecord& record) {
+            unsigned int planeMask = Physics::FRUSTUM_PLANE_MASK_ALL;
+            if (Physics::intersects(camera_parameters->frustum, record.bounds, planeMask) == Physics::IntersectType::DISJOINT) {
+                ++this->renderStats.culledBrushEntityCount;
+                return;
             }
-
-            //color
-            glm::vec4 color(1.0f);
-            boost::optional<std::string> colorOptional = entity.getOptional("rendercolor");
-            if (colorOptional) {
-                std::vector<std::string> tokens;
-                boost::algorithm::split(tokens, colorOptional.get(), boost::is_any_of(" "), boost::algorithm::token_compress_on);
-
-                color.r = boost::lexical_cast<float>(tokens[0]) / 255.0f;
-                color.g = boost::lexical_cast<float>(tokens[1]) / 255.0f;
-                color.b = boost::lexical_cast<float>(tokens[2]) / 255.0f;
+            if (this->renderSettings.useOcclusionCulling && !this->occluders.empty() && !this->occlusionBuffer.isVisible(record.bounds)) {
+                ++this->renderStats.occludedBrushEntityCount;
+                return;
             }
 
+            const Model& model = this->models[record.modelIndex];
             Device::GPU::Gpu::BlendStateManager::BlendState _blendState = Device::GPU::gpu.blend.getState();
             Device::GPU::Gpu::Depth::State depthState = Device::GPU::gpu.depth.getState();
             depthState.shouldTest = true;
-            const boost::shared_ptr<BSPShader> _gpuShader = Device::GPU::Shaders::shaders.get<BSPShader>();
 
-            switch (renderMode) {
+            switch (record.renderMode) {
                 case RenderMode::TEXTURE:
-                    Device::GPU::gpu.setUniform("alpha", 0.0f);
+                    gpuShader->alpha.set(0.0f);
                     _blendState.isEnabled = true;
                     _blendState.srcFactor = Device::GPU::Gpu::BlendFactor::SRC_ALPHA;
                     _blendState.dstFactor = Device::GPU::Gpu::BlendFactor::ONE;
                     break;
                 case RenderMode::SOLID:
-                    Device::GPU::gpu.setUniform("should_test_alpha", 1);
+                    gpuShader->shouldTestAlpha.set(1);
                     break;
                 case RenderMode::ADDITIVE:
-                    Device::GPU::gpu.setUniform("alpha", alpha);
+                    gpuShader->alpha.set(record.alpha);
                     _blendState.isEnabled = true;
                     _blendState.srcFactor = Device::GPU::Gpu::BlendFactor::ONE;
                     _blendState.dstFactor = Device::GPU::Gpu::BlendFactor::ONE;
@@ -660,18 +1310,17 @@ namespace Rendering::Scene {
             Device::GPU::gpu.blend.pushState(_blendState);
             Device::GPU::gpu.depth.pushState(depthState);
 
-            glm::mat4 world_matrix = glm::translate(glm::mat4x4(), model.origin);
-            world_matrix *= glm::translate(glm::mat4x4(), origin);
-            Device::GPU::gpu.setUniform("world_matrix", world_matrix);
-            renderNode(model.headNodeIndices[0], -1);
+            gpuShader->worldMatrix.set(record.worldMatrix);
+            renderNode(model.headNodeIndices[0], record.translation, false);
+            flushSurfaces();
 
-            switch (renderMode) {
+            switch (record.renderMode) {
                 case RenderMode::TEXTURE:
                 case RenderMode::ADDITIVE:
-                    Device::GPU::gpu.setUniform("alpha", 1.0f);
+                    gpuShader->alpha.set(1.0f);
                     break;
                 case RenderMode::SOLID:
-                    Device::GPU::gpu.setUniform("should_test_alpha", 0);
+                    gpuShader->shouldTestAlpha.set(0);
                     break;
                 default:
                     break;
@@ -681,19 +1330,36 @@ namespace Rendering::Scene {
             Device::GPU::gpu.blend.popState();
         };
 
-        this->renderStats.reset();
+        for (const std::pair<int, size_t>& view_entry : this->viewOrder) {
+            const View::RenderView& view = views[view_entry.second];
+            camera_parameters = &view.cameraParameters;
 
-        //Depth
-        Device::GPU::Gpu::Depth::State depthState = Device::GPU::gpu.depth.getState();
-        depthState.shouldTest = true;
-        Device::GPU::gpu.depth.pushState(depthState);
-        renderNode(0, cameraLeafIndex);
-        Device::GPU::gpu.depth.popState();
+            if (view.frameBuffer) Device::GPU::gpu.frameBufferManager.push(view.frameBuffer);
+            if (view.viewport) Device::GPU::gpu.viewports.push(*view.viewport);
 
-        for (unsigned long brushEntityIndex : this->brushEntityIndices) {
-            renderBrushEntity(brushEntityIndex);
+            gpuShader->worldMatrix.set(glm::mat4());
+            gpuShader->viewProjectionMatrix.set(camera_parameters->projectionMatrix * camera_parameters->viewMatrix);
+
+            //Depth
+            const std::vector<int>& view_leaves = collectVisibleLeaves(*camera_parameters);
+            Device::GPU::Gpu::Depth::State depthState = Device::GPU::gpu.depth.getState();
+            depthState.shouldTest = true;
+            Device::GPU::gpu.depth.pushState(depthState);
+            collectVisibleSurfaces(view_leaves);
+            flushSurfaces();
+            Device::GPU::gpu.depth.popState();
+
+            for (const BrushEntityRenderRecord& record : this->brushEntityRecords) {
+                renderBrushEntity(record);
+            }
+
+            if (view.viewport) Device::GPU::gpu.viewports.pop();
+            if (view.frameBuffer) Device::GPU::gpu.frameBufferManager.pop();
         }
 
+        this->renderStats.culledNodeCount += traversalStats.culledNodeCount;
+        this->renderStats.culledLeafCount += traversalStats.culledLeafCount;
+
         Device::GPU::gpu.programs.pop();
         Device::GPU::gpu.buffers.pop(Device::GPU::Gpu::BufferTarget::ELEMENT_ARRAY);
         Device::GPU::gpu.buffers.pop(Device::GPU::Gpu::BufferTarget::ARRAY);
@@ -701,20 +1367,333 @@ namespace Rendering::Scene {
         Device::GPU::gpu.blend.popState();
     }
 
-    int BSP::getLeafIndexFromLocation(const glm::vec3& location) const {
-        NodeIndexType nodeIndex = 0;
+    void BSP::tick(float dt) {
+        this->lightstyleTime += dt;
+        //the styles stay dirty until the lightmap pages exist to take them
+        if (!isUploaded()) return;
+
+        const uint64_t dirtyStyles = this->lightstyles.update(this->lightstyleTime);
+        if (dirtyStyles == 0 || this->lightstyleCompositor.isEmpty()) return;
+
+        this->lightstyleCompositor.composite(dirtyStyles, this->lightstyles, [this](size_t pageIndex, const glm::uvec2& location, const glm::uvec2& size, const unsigned char* data) {
+            Device::GPU::gpu.updateTexture(this->lightmapPageTextures[pageIndex], location, size, data);
+        });
+    }
+
+    //an empty tree locates to leaf 0 even when there are no leaves, treat anything missing as solid
+    BSP::ContentType BSP::getLeafContentType(int leafIndex) const {
+        if (leafIndex < 0 || static_cast<size_t>(leafIndex) >= this->leaves.size()) return ContentType::SOLID;
+        return this->leaves[leafIndex].contentType;
+    }
+
+    BSP::LeafLocation BSP::locate(const glm::vec3& location) const {
+        LeafLocation leafLocation;
+        leafLocation.leafIndex = this->pointLocator.locate(location);
+        leafLocation.contentType = getLeafContentType(leafLocation.leafIndex);
+        return leafLocation;
+    }
+
+    void BSP::locate(std::span<const glm::vec3> locations, std::span<LeafLocation> results) const {
+        static const size_t LOCATIONS_PER_JOB = 1024;
+        static const size_t CHUNK_SIZE = 64;
+        if (results.size() < locations.size()) throw std::runtime_error("Locate results are smaller than the locations");
+
+        auto locateRange = [&](size_t begin, size_t end) {
+            std::array<int, CHUNK_SIZE> leafIndices;
+            for (size_t chunkBegin = begin; chunkBegin < end; chunkBegin += CHUNK_SIZE) {
+                const size_t count = std::min(CHUNK_SIZE, end - chunkBegin);
+                this->pointLocator.locate(locations.subspan(chunkBegin, count), std::span<int>(leafIndices.data(), count));
+                for (size_t i = 0; i < count; ++i) {
+                    LeafLocation& result = results[chunkBegin + i];
+                    result.leafIndex = leafIndices[i];
+                    result.contentType = getLeafContentType(leafIndices[i]);
+                }
+            }
+        };
+
+        if (locations.size() > LOCATIONS_PER_JOB) {
+            Core::Threading::workers.parallelFor(0, locations.size(), LOCATIONS_PER_JOB, locateRange);
+        } else {
+            locateRange(0, locations.size());
+        }
+    }
+
+    bool BSP::isLeafVisibleFrom(const glm::vec3& from, const glm::vec3& to) const {
+        return isLeafVisibleFrom(getLeafIndexFromLocation(from), getLeafIndexFromLocation(to));
+    }
+
+    bool BSP::isLeafHearableFrom(const glm::vec3& from, const glm::vec3& to) const {
+        return isLeafHearableFrom(getLeafIndexFromLocation(from), getLeafIndexFromLocation(to));
+    }
+
+    void BSP::getLeavesInBounds(const ::Scenes::Structure::AABB3<float>& bounds, std::vector<int>& leafIndices) const {
+        if (this->nodes.empty()) return;
+        findTouchedLeaves(0, bounds.center(), bounds.extents(), leafIndices);
+    }
 
+    void BSP::findTouchedLeaves(int nodeIndex, const glm::vec3& center, const glm::vec3& extents, std::vector<int>& leafIndices) const {
         while (nodeIndex >= 0) {
             const Node& node = this->nodes[nodeIndex];
             const ::Scenes::Structure::Plane3<float>& plane = this->planes[node.planeIndex].plane;
 
-            if (glm::dot(plane.normal, (location - plane.origin())) >= 0) {
+            //box against plane: the projected radius decides whether it straddles
+            const float distance = glm::dot(plane.normal, center) - plane.distance;
+            const float radius = glm::dot(glm::abs(plane.normal), extents);
+            if (distance > radius) {
                 nodeIndex = node.childIndices[0];
+            } else if (distance < -radius) {
+                nodeIndex = node.childIndices[1];
             } else {
+                findTouchedLeaves(node.childIndices[0], center, extents, leafIndices);
                 nodeIndex = node.childIndices[1];
             }
         }
 
-        return ~nodeIndex;
+        const int leafIndex = ~nodeIndex;
+        if (leafIndex == 0 || this->leaves[leafIndex].contentType == ContentType::SOLID) return;
+        leafIndices.push_back(leafIndex);
+    }
+
+    //the render nodes as a clip hull: leaves collapse into their contents like in the clip node lump
+    void BSP::buildPointHull() {
+        this->pointHullClipNodes.resize(this->nodes.size());
+
+        for (size_t i = 0; i < this->nodes.size(); ++i) {
+            const Node& node = this->nodes[i];
+            ClipNode& clipNode = this->pointHullClipNodes[i];
+            clipNode.planeIndex = node.planeIndex;
+
+            for (size_t j = 0; j < Node::CHILD_COUNT; ++j) {
+                const int childIndex = node.childIndices[j];
+                if (childIndex >= 0) {
+                    clipNode.childIndices[j] = static_cast<ClipNode::ChildIndexType>(childIndex);
+                } else {
+                    const size_t leafIndex = ~childIndex;
+                    const ContentType contentType = leafIndex < this->leaves.size() ? this->leaves[leafIndex].contentType : ContentType::SOLID;
+                    clipNode.childIndices[j] = static_cast<ClipNode::ChildIndexType>(contentType);
+                }
+            }
+        }
+    }
+
+    boost::optional<BSP::HullView> BSP::getHull(HullType hull, int modelIndex) const {
+        const size_t hullIndex = static_cast<size_t>(hull);
+        if (modelIndex < 0 || static_cast<size_t>(modelIndex) >= this->models.size() || hullIndex >= Model::HEAD_NODE_INDEX_COUNT) {
+            return boost::none;
+        }
+
+        HullView hullView;
+        hullView.clipNodes = hull == HullType::POINT ? this->pointHullClipNodes : this->clipNodes;
+        hullView.headNodeIndex = this->models[modelIndex].headNodeIndices[hullIndex];
+        if (hullView.clipNodes.empty() || hullView.headNodeIndex >= static_cast<int>(hullView.clipNodes.size())) {
+            return boost::none;
+        }
+        return hullView;
+    }
+
+    int BSP::getHullContents(const HullView& hull, int nodeIndex, const glm::vec3& location) const {
+        while (nodeIndex >= 0) {
+            const ClipNode& clipNode = hull.clipNodes[nodeIndex];
+            const ::Scenes::Structure::Plane3<float>& plane = this->planes[clipNode.planeIndex].plane;
+            nodeIndex = clipNode.childIndices[glm::dot(plane.normal, location) - plane.distance < 0 ? 1 : 0];
+        }
+        return nodeIndex;
+    }
+
+    BSP::ContentType BSP::getContents(const glm::vec3& location, HullType hull, int modelIndex) const {
+        const boost::optional<HullView> hullView = getHull(hull, modelIndex);
+        if (!hullView) return ContentType::EMPTY;
+        return static_cast<ContentType>(getHullContents(*hullView, hullView->headNodeIndex, location));
+    }
+
+    BSP::TraceResult BSP::trace(const TraceArgs& args) const {
+        const boost::optional<HullView> hullView = getHull(args.hull, args.modelIndex);
+        if (!hullView) {
+            TraceResult result;
+            result.ratio = 1.0f;
+            result.location = args.line.end;
+            return result;
+        }
+        return traceFrom(*hullView, hullView->headNodeIndex, args);
+    }
+
+    void BSP::trace(std::span<const TraceArgs> args, std::span<TraceResult> results) const {
+        static const size_t PACKETS_PER_JOB = 64;
+        if (results.size() < args.size()) throw std::runtime_error("Trace results are smaller than the trace arguments");
+
+        const size_t packetCount = (args.size() + TRACE_PACKET_SIZE - 1) / TRACE_PACKET_SIZE;
+        auto tracePackets = [&](size_t packetBegin, size_t packetEnd) {
+            for (size_t packetIndex = packetBegin; packetIndex < packetEnd; ++packetIndex) {
+                const size_t begin = packetIndex * TRACE_PACKET_SIZE;
+                const size_t count = std::min(TRACE_PACKET_SIZE, args.size() - begin);
+                tracePacket(args.subspan(begin, count), results.subspan(begin, count));
+            }
+        };
+
+        if (packetCount > PACKETS_PER_JOB) {
+            Core::Threading::workers.parallelFor(0, packetCount, PACKETS_PER_JOB, tracePackets);
+        } else {
+            tracePackets(0, packetCount);
+        }
+    }
+
+    //walks the lanes down together while every segment stays on one side of each plane, the lanes
+    //then finish on their own from where they split. Until a segment straddles a plane the scalar
+    //walk would have taken the same path, so the results are identical to tracing one by one.
+    void BSP::tracePacket(std::span<const TraceArgs> args, std::span<TraceResult> results) const {
+        bool isCoherent = true;
+        for (const TraceArgs& traceArgs : args) {
+            isCoherent &= traceArgs.hull == args[0].hull && traceArgs.modelIndex == args[0].modelIndex;
+        }
+
+        const boost::optional<HullView> hullView = getHull(args[0].hull, args[0].modelIndex);
+        if (!isCoherent || !hullView) {
+            for (size_t i = 0; i < args.size(); ++i) {
+                results[i] = trace(args[i]);
+            }
+            return;
+        }
+
+        int nodeIndex = hullView->headNodeIndex;
+#if QUAKE_SIMD_SSE2
+        //structure of arrays over the lanes, short packets repeat their first lane
+        alignas(16) float lanes[6][TRACE_PACKET_SIZE];
+        for (size_t i = 0; i < TRACE_PACKET_SIZE; ++i) {
+            const ::Scenes::Structure::Line3<float>& line = args[i < args.size() ? i : 0].line;
+            lanes[0][i] = line.start.x;
+            lanes[1][i] = line.start.y;
+            lanes[2][i] = line.start.z;
+            lanes[3][i] = line.end.x;
+            lanes[4][i] = line.end.y;
+            lanes[5][i] = line.end.z;
+        }
+
+        const __m128 startX = _mm_load_ps(lanes[0]);
+        const __m128 startY = _mm_load_ps(lanes[1]);
+        const __m128 startZ = _mm_load_ps(lanes[2]);
+        const __m128 endX = _mm_load_ps(lanes[3]);
+        const __m128 endY = _mm_load_ps(lanes[4]);
+        const __m128 endZ = _mm_load_ps(lanes[5]);
+        const __m128 zero = _mm_setzero_ps();
+        static const int ALL_LANES = (1 << TRACE_PACKET_SIZE) - 1;
+
+        while (nodeIndex >= 0) {
+            const ClipNode& clipNode = hullView->clipNodes[nodeIndex];
+            const ::Scenes::Structure::Plane3<float>& plane = this->planes[clipNode.planeIndex].plane;
+            const __m128 normalX = _mm_set1_ps(plane.normal.x);
+            const __m128 normalY = _mm_set1_ps(plane.normal.y);
+            const __m128 normalZ = _mm_set1_ps(plane.normal.z);
+            const __m128 distance = _mm_set1_ps(plane.distance);
+
+            const __m128 startDistance = _mm_sub_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(startX, normalX), _mm_mul_ps(startY, normalY)), _mm_mul_ps(startZ, normalZ)), distance);
+            const __m128 endDistance = _mm_sub_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(endX, normalX), _mm_mul_ps(endY, normalY)), _mm_mul_ps(endZ, normalZ)), distance);
+
+            if (_mm_movemask_ps(_mm_and_ps(_mm_cmpge_ps(startDistance, zero), _mm_cmpge_ps(endDistance, zero))) == ALL_LANES) {
+                nodeIndex = clipNode.childIndices[0];
+            } else if (_mm_movemask_ps(_mm_and_ps(_mm_cmplt_ps(startDistance, zero), _mm_cmplt_ps(endDistance, zero))) == ALL_LANES) {
+                nodeIndex = clipNode.childIndices[1];
+            } else {
+                break;
+            }
+        }
+#endif
+
+        for (size_t i = 0; i < args.size(); ++i) {
+            results[i] = traceFrom(*hullView, nodeIndex, args[i]);
+        }
+    }
+
+    BSP::TraceResult BSP::traceFrom(const HullView& hull, int nodeIndex, const TraceArgs& args) const {
+        TraceResult result;
+        result.ratio = 1.0f;
+        result.location = args.line.end;
+        result.isAllSolid = true;
+        traceHull(hull, nodeIndex, 0.0f, 1.0f, args.line.start, args.line.end, result);
+
+        if (result.isAllSolid) {
+            result.isStartSolid = true;
+        }
+        if (result.ratio < 1.0f) {
+            result.didHit = true;
+            result.location = args.line.start + (result.ratio * (args.line.end - args.line.start));
+        }
+        return result;
+    }
+
+    ::Scenes::Structure::AABB3<float> BSP::getWorldBounds() const {
+        if (this->models.empty()) return {};
+        const ::Scenes::Structure::AABB3<float>& aabb = this->models[0].aabb;
+        return { glm::min(aabb.min, aabb.max), glm::max(aabb.min, aabb.max) };
+    }
+
+    //SV_RecursiveHullCheck: returns false once the sweep has been stopped by solid
+    bool BSP::traceHull(const HullView& hull, int nodeIndex, float startRatio, float endRatio, const glm::vec3& start, const glm::vec3& end, TraceResult& result) const {
+        //keeps the impact point this far in front of the hit plane
+        static const float DIST_EPSILON = 0.03125f;
+
+        if (nodeIndex < 0) {
+            if (nodeIndex != static_cast<int>(ContentType::SOLID)) {
+                result.isAllSolid = false;
+            } else {
+                result.isStartSolid = true;
+            }
+            return true;
+        }
+
+        const ClipNode& clipNode = hull.clipNodes[nodeIndex];
+        const ::Scenes::Structure::Plane3<float>& plane = this->planes[clipNode.planeIndex].plane;
+        const float startDistance = glm::dot(plane.normal, start) - plane.distance;
+        const float endDistance = glm::dot(plane.normal, end) - plane.distance;
+
+        if (startDistance >= 0 && endDistance >= 0) {
+            return traceHull(hull, clipNode.childIndices[0], startRatio, endRatio, start, end, result);
+        }
+        if (startDistance < 0 && endDistance < 0) {
+            return traceHull(hull, clipNode.childIndices[1], startRatio, endRatio, start, end, result);
+        }
+
+        //split at the crossing, nudged back onto the start side
+        float ratio = startDistance < 0 ?
+                (startDistance + DIST_EPSILON) / (startDistance - endDistance) :
+                (startDistance - DIST_EPSILON) / (startDistance - endDistance);
+        ratio = glm::clamp(ratio, 0.0f, 1.0f);
+
+        float middleRatio = startRatio + ((endRatio - startRatio) * ratio);
+        glm::vec3 middle = start + (ratio * (end - start));
+        const size_t side = startDistance < 0 ? 1 : 0;
+
+        if (!traceHull(hull, clipNode.childIndices[side], startRatio, middleRatio, start, middle, result)) {
+            return false;
+        }
+
+        if (getHullContents(hull, clipNode.childIndices[side ^ 1], middle) != static_cast<int>(ContentType::SOLID)) {
+            return traceHull(hull, clipNode.childIndices[side ^ 1], middleRatio, endRatio, middle, end, result);
+        }
+
+        //never left solid, there is no impact to report
+        if (result.isAllSolid) {
+            return false;
+        }
+
+        //the far side is solid, this plane is the impact
+        if (side == 0) {
+            result.plane = plane;
+        } else {
+            result.plane = -plane;
+        }
+
+        //epsilon adjustments can leave the point inside solid, back off until it is clear
+        while (getHullContents(hull, hull.headNodeIndex, middle) == static_cast<int>(ContentType::SOLID)) {
+            ratio -= 0.1f;
+            if (ratio < 0) {
+                break;
+            }
+            middleRatio = startRatio + ((endRatio - startRatio) * ratio);
+            middle = start + (ratio * (end - start));
+        }
+
+        result.ratio = middleRatio;
+        result.location = middle;
+        return false;
     }
-}
\ No newline at end of file
+}
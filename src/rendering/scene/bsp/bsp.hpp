@@ -4,25 +4,52 @@
 #define QUAKE_BSP_HPP
 
 #include <array>
+#include <span>
+#include <cstdint>
 #include <vector>
 #include <map>
+#include <string>
+#include <utility>
+#include <memory>
+#include <chrono>
 #include <glm/glm.hpp>
 #include <boost/shared_ptr.hpp>
-#include <boost/dynamic_bitset.hpp>
 #include <boost/lexical_cast.hpp>
 #include <boost/optional.hpp>
 
 #include "../../../scene/structure/aabb.hpp"
 #include "../../../scene/structure/line.hpp"
 #include "../../../resources/texture.hpp"
+#include "../../../resources/io/mappedFile.hpp"
 #include "bspEntity.hpp"
+#include "visibleSurfaceList.hpp"
+#include "bspVisibilityMatrix.hpp"
+#include "bspTraversal.hpp"
+#include "bspPointLocator.hpp"
+#include "lightstyles.hpp"
+#include "occlusionBuffer.hpp"
+#include "geometryCompiler.hpp"
 #include "../../../device/gpu/gpu.hpp"
 #include "../../../device/gpu/buffers/vertexBuffer.hpp"
 #include "../../../device/gpu/buffers/indexBuffer.hpp"
 #include "../../../device/gpu/shaders/programs/bspShader.hpp"
 #include "../../../platform/game/components/cameraParams.hpp"
+#include "../../view/renderView.hpp"
 
 namespace Rendering::Scene {
+    struct BSPLumpReader;
+    struct CompiledLevel;
+    struct LightmapAtlas;
+
+    struct BSPLoadOptions {
+        // Decode the palettised textures embedded in the texture lump instead of loading <name>.png
+        // through the resource manager. Textures that live in a WAD still go through the PNG path.
+        bool useEmbeddedTextures = false;
+        // Create the GPU objects before the constructor returns, which ties loading to the GL
+        // thread. Background and headless loads turn this off and call BSP::upload themselves.
+        bool shouldUpload = true;
+    };
+
 class BSP: public Resources::Resource {
     public:
         typedef int NodeIndexType;
@@ -140,18 +167,39 @@ class BSP: public Resources::Resource {
             Type type = Type::X;
         };
 
+        // Leaf holding a point and that leaf's contents.
+        struct LeafLocation {
+            int leafIndex = 0;
+            ContentType contentType = ContentType::SOLID;
+        };
+
+        static const int LIGHTMAP_PAGE_NONE = -1;
+        static const size_t TRACE_PACKET_SIZE = 4;
+
         typedef BSPShader::VertexType VertexType;
         typedef Device::GPU::Buffers::VertexBuffer<VertexType> VertexBufferType;
         typedef unsigned int IndexType;
         typedef Device::GPU::Buffers::IndexBuffer<IndexType> IndexBufferType;
 
+        // Collision hulls baked by the map compiler. POINT walks the render nodes, the others the
+        // clip nodes expanded by the matching Half-Life box size.
+        enum class HullType: unsigned int {
+            POINT,      //0x0x0
+            PLAYER,     //32x32x72, standing
+            LARGE,      //64x64x64
+            CROUCH      //32x32x36
+        };
+
         struct TraceArgs {
             ::Scenes::Structure::Line3<float> line;
+            HullType hull = HullType::POINT;
+            int modelIndex = 0;
         };
 
         struct TraceResult {
             bool didHit = false;
             bool isAllSolid = false;
+            bool isStartSolid = false;
             glm::vec3 location;
             ::Scenes::Structure::Plane3<float> plane;
             float ratio = 0.0f;
@@ -159,26 +207,118 @@ class BSP: public Resources::Resource {
 
         struct RenderSettings {
             float lightmap_gamma = 1.0f;
+            // Rasterize the largest nearby world faces into a small CPU depth buffer and skip the
+            // leaves and brush entities hidden behind them.
+            bool useOcclusionCulling = false;
+            // Tree depth at which the world walk is split into subtree jobs for the worker pool,
+            // face collection is then spread over the pool too. 0 does everything on this thread.
+            unsigned int visibilitySplitDepth = 4;
         };
 
         struct RenderStats {
             unsigned int faceCount = 0;
             unsigned int leafCount = 0;
             unsigned int leafIndex = 0;
+            unsigned int drawCallCount = 0;
+            unsigned int stateChangeCount = 0;
+            unsigned int culledNodeCount = 0;
+            unsigned int culledLeafCount = 0;
+            unsigned int culledBrushEntityCount = 0;
+            unsigned int occluderCount = 0;
+            unsigned int occludedLeafCount = 0;
+            unsigned int occludedBrushEntityCount = 0;
             void reset() {
                 this->faceCount = 0;
                 this->leafCount = 0;
                 this->leafIndex = 0;
+                this->drawCallCount = 0;
+                this->stateChangeCount = 0;
+                this->culledNodeCount = 0;
+                this->culledLeafCount = 0;
+                this->culledBrushEntityCount = 0;
+                this->occluderCount = 0;
+                this->occludedLeafCount = 0;
+                this->occludedBrushEntityCount = 0;
             }
         };
 
-        BSP(std::istream& istream);
+        BSP(std::istream& istream, const BSPLoadOptions& options = BSPLoadOptions());
+        BSP(const Resources::IO::MappedFile& file, const BSPLoadOptions& options = BSPLoadOptions());
+        ~BSP();
+        // Loading is split in two. The constructor only touches the CPU and may run on any thread,
+        // it leaves the level staged. upload creates the GPU objects on the GL thread, a texture or
+        // buffer at a time until budget runs out (at least one per call), so it can be spread over
+        // several frames. Returns true once everything is uploaded. The level does not render
+        // before that, but every CPU query (traces, PVS, entities) works straight away.
+        bool upload(std::chrono::microseconds budget = std::chrono::microseconds::max());
+        [[nodiscard]] bool isUploaded() const { return !this->stagedLevel; }
         void render(const View::CameraParameters& cameraParameters);
-        [[nodiscard]] int getLeafIndexFromLocation(const glm::vec3& location) const;
+        // Draws several views in one go (split-screen, cubemap faces, thumbnails). GL state,
+        // buffers and shared uniforms are bound once, views standing in the same leaf share one
+        // PVS marking, and each view is culled against its own frustum. Render stats are summed.
+        void render(std::span<const View::RenderView> views);
+        // Advances the lightstyles and uploads the lightmaps of faces whose styles changed.
+        void tick(float dt);
+        void setLightstyle(size_t styleIndex, std::string pattern) { this->lightstyles.set(styleIndex, std::move(pattern)); }
+        [[nodiscard]] int getLeafIndexFromLocation(const glm::vec3& location) const { return this->pointLocator.locate(location); }
+        [[nodiscard]] LeafLocation locate(const glm::vec3& location) const;
+        // Locates every location into the result at the same index. Meant for per-tick lookups of
+        // many entities; large batches use the worker pool.
+        void locate(std::span<const glm::vec3> locations, std::span<LeafLocation> results) const;
+        [[nodiscard]] size_t getLeafCount() const { return this->leaves.size(); }
+        // Sweeps the hull origin along args.line through the given model (0 is the world).
+        // ratio is the fraction of the line travelled before the first solid hit.
+        [[nodiscard]] TraceResult trace(const TraceArgs& args) const;
+        // Traces every args entry into the result at the same index. Traces are walked in packets
+        // of TRACE_PACKET_SIZE while they share a path through the hull, and large batches are
+        // spread over the worker pool.
+        void trace(std::span<const TraceArgs> args, std::span<TraceResult> results) const;
+        [[nodiscard]] ContentType getContents(const glm::vec3& location, HullType hull = HullType::POINT, int modelIndex = 0) const;
+        // PVS queries by leaf index (as returned by getLeafIndexFromLocation) or world location.
+        // A leaf without visibility data sees every leaf; leaf 0 is solid and is never visible.
+        [[nodiscard]] bool isLeafVisibleFrom(int fromLeafIndex, int toLeafIndex) const { return this->visibility.isLeafVisibleFrom(fromLeafIndex, toLeafIndex); }
+        [[nodiscard]] bool isLeafVisibleFrom(const glm::vec3& from, const glm::vec3& to) const;
+        // PHS queries, same conventions as the PVS ones. A leaf hears every leaf its visible
+        // leaves can see, which is what sounds and events are sent by.
+        [[nodiscard]] bool isLeafHearableFrom(int fromLeafIndex, int toLeafIndex) const { return this->hearability.isLeafVisibleFrom(fromLeafIndex, toLeafIndex); }
+        [[nodiscard]] bool isLeafHearableFrom(const glm::vec3& from, const glm::vec3& to) const;
+        template<typename F>
+        void forEachHearableLeaf(int leafIndex, F&& fn) const { this->hearability.forEachVisibleLeaf(leafIndex, std::forward<F>(fn)); }
+        template<typename F>
+        void forEachVisibleLeaf(int leafIndex, F&& fn) const { this->visibility.forEachVisibleLeaf(leafIndex, std::forward<F>(fn)); }
+        template<typename F>
+        void forEachVisibleLeaf(const glm::vec3& location, F&& fn) const { forEachVisibleLeaf(getLeafIndexFromLocation(location), std::forward<F>(fn)); }
+        // Calls fn(leafIndex) for every leaf in the camera leaf's PVS that is inside the frustum,
+        // with the same hierarchical culling the world render uses.
+        template<typename F>
+        void forEachLeafInView(const View::CameraParameters& cameraParameters, F&& fn) {
+            BSPTraversal::Stats stats;
+            this->traversal.beginFrame(getLeafIndexFromLocation(cameraParameters.location), this->visibility);
+            this->traversal.traverse(0, cameraParameters.location, cameraParameters.frustum, glm::vec3(0.0f), true, stats, std::forward<F>(fn));
+        }
+        // Leaves in the camera leaf's PVS and inside the frustum, front to back, less the ones hidden
+        // behind occluders when renderSettings.useOcclusionCulling is set. Valid until the next call,
+        // the culling counts are added to the render stats (reset by render).
+        const std::vector<int>& collectVisibleLeaves(const View::CameraParameters& cameraParameters);
+        // Appends every non-solid leaf the bounds touch, as SV_FindTouchedLeafs does for edicts.
+        void getLeavesInBounds(const ::Scenes::Structure::AABB3<float>& bounds, std::vector<int>& leafIndices) const;
         [[nodiscard]] const RenderStats& geRenderStats() const { return this->renderStats; }
+        [[nodiscard]] ::Scenes::Structure::AABB3<float> getWorldBounds() const;
         RenderSettings renderSettings;  //TODO: sort this out elsewhere
 
     private:
+        // Brush entity properties resolved once at load, in draw order.
+        struct BrushEntityRenderRecord {
+            size_t entityIndex = 0;
+            int modelIndex = 0;
+            RenderMode renderMode = RenderMode::NORMAL;
+            float alpha = 1.0f;
+            glm::vec4 color = glm::vec4(1.0f);
+            glm::vec3 translation = glm::vec3(0.0f);
+            glm::mat4 worldMatrix;
+            ::Scenes::Structure::AABB3<float> bounds;
+        };
+
         std::vector<BSPPlane> planes;
         std::vector<Edge> edges;
         std::vector<Face> faces;
@@ -187,19 +327,101 @@ class BSP: public Resources::Resource {
         std::vector<Leaf> leaves;
         std::vector<unsigned short> markSurfaces;
         std::vector<TextureInfo> textureInfos;
-        std::vector<boost::shared_ptr<Resources::Texture>> faceLightmapTextures;
+        std::vector<boost::shared_ptr<Resources::Texture>> lightmapPageTextures;
+        std::vector<int> faceLightmapPageIndices;
+        Lightstyles lightstyles;
+        LightstyleCompositor lightstyleCompositor;
+        float lightstyleTime = 0.0f;
         std::vector<ClipNode> clipNodes;
+        std::vector<ClipNode> pointHullClipNodes;
         std::vector<Model> models;
+        std::vector<char> entityText;
         std::vector<BSPEntity> entities;
-        std::vector<size_t> brushEntityIndices;
-        std::map<size_t, boost::dynamic_bitset<>> leafPvsMap;
-        std::vector<size_t> faceStartIndices;
-        size_t visLeafCount = 0;
+        std::vector<BrushEntityRenderRecord> brushEntityRecords;
+        BSPVisibilityMatrix visibility;
+        BSPVisibilityMatrix hearability;
+        BSPTraversal traversal;
+        BSPPointLocator pointLocator;
+        std::vector<VisibleSurfaceList::IndexRange> faceIndexRanges;
+        VisibleSurfaceList visibleSurfaces;
         std::vector<boost::shared_ptr<Resources::Texture>> textures;
         RenderStats renderStats;
         boost::shared_ptr<VertexBufferType> vertexBuffer;
         boost::shared_ptr<IndexBufferType> indexBuffer;
+        GeometryCompiler::LocationTransform locationTransform;
+
+        // Convex world face used as an occluder, its vertices live in occluderVertices.
+        struct Occluder {
+            size_t vertexStartIndex = 0;
+            size_t vertexCount = 0;
+            glm::vec3 center;
+            float radius = 0.0f;
+            float area = 0.0f;
+        };
+
+        std::vector<Occluder> occluders;
+        std::vector<glm::vec3> occluderVertices;
+        std::vector<int> faceOccluderIndices;       //-1 for faces too small or see-through
+        std::vector<uint32_t> occluderFrames;
+        uint32_t occluderFrame = 0;
+        std::vector<std::pair<float, int>> occluderCandidates;
+        std::vector<int> viewLeaves;
+        OcclusionBuffer occlusionBuffer;
+
+        // Scratch space of one visibility job, kept between frames. Results are merged in job order.
+        struct VisibilityJob {
+            std::vector<BSPTraversal::StackEntry> stack;
+            std::vector<int> leafIndices;
+            std::vector<unsigned int> faceIndices;
+            BSPTraversal::Stats stats;
+        };
+
+        std::vector<BSPTraversal::StackEntry> visibilitySubtrees;
+        std::vector<VisibilityJob> visibilityJobs;
+        std::vector<std::pair<int, size_t>> viewOrder;     //camera leaf and view index
+
+        struct HullView {
+            std::span<const ClipNode> clipNodes;
+            int headNodeIndex = 0;
+        };
+
+        // Final geometry ready for upload, either owned by the loader or mapped from a compiled level.
+        struct LevelGeometry {
+            std::span<const VertexType> vertices;
+            std::span<const IndexType> indices;
+            GeometryCompiler::LocationTransform locationTransform;
+            glm::uvec2 lightmapPageSize;
+            std::vector<std::span<const unsigned char>> lightmapPages;
+        };
+
+        // CPU results of the load waiting for upload, defined in bsp.cpp. Reset once uploaded.
+        struct StagedLevel;
+        std::unique_ptr<StagedLevel> stagedLevel;
 
+        BSP(const std::vector<char>& buffer, const BSPLoadOptions& options);
+        // Converts the lumps that are swizzled or widened on load, each on its own job.
+        void decodeLumps(const BSPLumpReader& reader, std::vector<glm::vec3>& vertexLocations);
+        void decodeVisibility(const BSPLumpReader& reader);
+        void decodeEntities(const BSPLumpReader& reader);
+        void buildTraversal();
+        void findTouchedLeaves(int nodeIndex, const glm::vec3& center, const glm::vec3& extents, std::vector<int>& leafIndices) const;
+        void buildBrushEntityRecords();
+        void buildPointHull();
+        [[nodiscard]] ContentType getLeafContentType(int leafIndex) const;
+        void buildOccluders(const std::vector<glm::vec3>& vertexLocations, const std::vector<std::string>& textureNames);
+        void rasterizeOccluders(const View::CameraParameters& cameraParameters);
+        void collectViewLeaves(const View::CameraParameters& cameraParameters, BSPTraversal::Stats& stats);
+        // Adds the faces of the leaves to the visible surface list, each face once.
+        void collectVisibleSurfaces(std::span<const int> leafIndices);
+        void buildGeometry(const BSPLumpReader& reader, const std::vector<glm::vec3>& vertexLocations, const std::vector<BSPTexture>& bspTextures, std::vector<VertexType>& vertices, std::vector<IndexType>& indices, GeometryCompiler::LocationTransform& locationTransform, LightmapAtlas& lightmapAtlas);
+        [[nodiscard]] boost::optional<HullView> getHull(HullType hull, int modelIndex) const;
+        [[nodiscard]] int getHullContents(const HullView& hull, int nodeIndex, const glm::vec3& location) const;
+        [[nodiscard]] TraceResult traceFrom(const HullView& hull, int nodeIndex, const TraceArgs& args) const;
+        void tracePacket(std::span<const TraceArgs> args, std::span<TraceResult> results) const;
+        bool traceHull(const HullView& hull, int nodeIndex, float startRatio, float endRatio, const glm::vec3& start, const glm::vec3& end, TraceResult& result) const;
+        bool addLightstyleSurface(size_t faceIndex, size_t pageIndex, const glm::uvec2& location, const glm::uvec2& size, std::span<const char> lightingData);
+        bool loadCompiledLevel(const CompiledLevel& compiledLevel, const BSPLumpReader& reader, LevelGeometry& geometry);
+        void writeCompiledLevel(const std::string& cacheName, uint32_t sourceChecksum, const LevelGeometry& geometry) const;
         BSP(const BSP&) = delete;
         BSP& operator=(const BSP&) = delete;
     };
@@ -1,25 +1,134 @@
 #include "bspEntity.hpp"
 
+#include <algorithm>
+#include <charconv>
+#include <spdlog/spdlog.h>
+
 namespace Rendering::Scene {
-    BSPEntity::BSPEntity(const std::string& string) {
-        std::string::size_type end = -1;
+    static bool isSpace(char character) {
+        return character == ' ' || character == '\t' || character == '\r' || character == '\n' || character == '\0';
+    }
+
+    void BSPEntity::parse(std::string_view lump, std::vector<BSPEntity>& entities) {
+        size_t offset = 0;
+
+        //whitespace and // comments, as COM_Parse skips them
+        auto skip = [&]() {
+            for (;;) {
+                while (offset < lump.size() && isSpace(lump[offset])) ++offset;
+                if (lump.substr(offset, 2) != "//") return;
+                offset = std::min(lump.find('\n', offset), lump.size());
+            }
+        };
+        auto readString = [&](std::string_view& token) {
+            if (offset >= lump.size() || lump[offset] != '"') return false;
+            const size_t end = lump.find('"', offset + 1);
+            if (end == std::string_view::npos) return false;
+            token = lump.substr(offset + 1, end - offset - 1);
+            offset = end + 1;
+            return true;
+        };
+
+        //a malformed entity is dropped and parsing picks up at the next block, as the old scanner did
+        auto drop = [&](const char* message) {
+            spdlog::warn("Skipping entity {} in entity lump: {}", entities.size(), message);
+            entities.pop_back();
+            offset = std::min(lump.find('}', offset), lump.size());
+            if (offset < lump.size()) ++offset;
+        };
 
         for (;;) {
-            unsigned long begin = string.find_first_of('"', end + 1);
-            if (begin == -1) break;
-            end = string.find_first_of('"', begin + 1);
+            skip();
+            if (offset >= lump.size()) break;
+            if (lump[offset] != '{') {
+                spdlog::warn("Expected '{{' in entity lump at offset {}", offset);
+                offset = std::min(lump.find('{', offset), lump.size());
+                continue;
+            }
+            ++offset;
+
+            BSPEntity& entity = entities.emplace_back();
+            bool isValid = true;
+            for (;;) {
+                skip();
+                if (offset >= lump.size()) {
+                    drop("unterminated entity");
+                    isValid = false;
+                    break;
+                }
+                if (lump[offset] == '}') {
+                    ++offset;
+                    break;
+                }
+
+                Property property;
+                if (!readString(property.key)) {
+                    drop("expected a key");
+                    isValid = false;
+                    break;
+                }
+                skip();
+                if (!readString(property.value)) {
+                    drop("expected a value");
+                    isValid = false;
+                    break;
+                }
+
+                //the classname has its own accessor and is not a property, as before
+                if (property.key == "classname") {
+                    entity.classname = property.value;
+                    continue;
+                }
+                property.keyHash = getKeyHash(property.key);
+                parseNumbers(property);
+                entity.properties.push_back(property);
+            }
+            if (!isValid) continue;
 
-            std::string key = string.substr(begin + 1, end - begin - 1);
-            begin = string.find_first_of('"', end + 1);
-            end = string.find_first_of('"', begin + 1);
+            //stable so a repeated key still finds its first occurrence
+            std::stable_sort(entity.properties.begin(), entity.properties.end(), [](const Property& lhs, const Property& rhs) {
+                return lhs.keyHash < rhs.keyHash;
+            });
+        }
+    }
+
+    const BSPEntity::Property* BSPEntity::find(std::string_view key) const {
+        const unsigned int keyHash = getKeyHash(key);
+        auto propertiesItr = std::lower_bound(this->properties.begin(), this->properties.end(), keyHash, [](const Property& property, unsigned int hash) {
+            return property.keyHash < hash;
+        });
+
+        for (; propertiesItr != this->properties.end() && propertiesItr->keyHash == keyHash; ++propertiesItr) {
+            if (propertiesItr->key == key) return &*propertiesItr;
+        }
+        return nullptr;
+    }
 
-            std::string value = string.substr(begin + 1, end - begin - 1);
+    void BSPEntity::parseNumbers(Property& property) {
+        const char* current = property.value.data();
+        const char* end = current + property.value.size();
+        unsigned char numberCount = 0;
+        bool isInteger = false;
 
-            if (key == "classname") {
-                this->classname = value;
-            } else {
-                this->properties.insert(std::make_pair(key, value));
+        for (;;) {
+            while (current < end && isSpace(*current)) ++current;
+            if (current == end) break;
+            if (numberCount == MAX_NUMBER_COUNT) return;
+
+            const std::from_chars_result result = std::from_chars(current, end, property.numbers[numberCount]);
+            if (result.ec != std::errc() || (result.ptr != end && !isSpace(*result.ptr))) return;
+
+            //a lone integer keeps its exact value, floats would round large spawnflags
+            if (numberCount == 0) {
+                const std::from_chars_result integerResult = std::from_chars(current, end, property.integer);
+                isInteger = integerResult.ec == std::errc() && integerResult.ptr == result.ptr;
             }
+
+            current = result.ptr;
+            ++numberCount;
         }
+
+        property.numberCount = numberCount;
+        property.isInteger = isInteger && numberCount == 1;
     }
-}
\ No newline at end of file
+}
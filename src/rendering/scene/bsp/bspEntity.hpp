@@ -3,38 +3,108 @@
 #ifndef QUAKE_BSPENTITY_HPP
 #define QUAKE_BSPENTITY_HPP
 
-#include <map>
+#include <span>
+#include <array>
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include <string_view>
+#include <type_traits>
+#include <glm/glm.hpp>
 #include <boost/optional.hpp>
 #include <boost/lexical_cast.hpp>
 
+#include "../../../utils/hash.hpp"
+
 namespace Rendering::Scene {
+    // Key/value view of one entity in the entity lump. Keys and values point straight into the lump
+    // text, which has to outlive the entity. Properties are kept in a flat array sorted by key hash,
+    // and numeric values (ints, floats, vectors and colors) are parsed once when the lump is read.
     class BSPEntity {
+    public:
+        typedef Utils::hash_u32 KeyType;
+        static const size_t MAX_NUMBER_COUNT = 4;
 
-        [[nodiscard]] const std::string& getClassname() const { return classname; }
+        struct Property {
+            unsigned int keyHash = 0;
+            std::string_view key;
+            std::string_view value;
+            std::array<float, MAX_NUMBER_COUNT> numbers = {};
+            int integer = 0;
+            unsigned char numberCount = 0;  //0 unless the whole value is whitespace separated numbers
+            bool isInteger = false;
+        };
 
-    public:
-        BSPEntity(const std::string& string);
+        // Tokenises a whole entity lump in a single pass and appends an entity per {...} block.
+        // Malformed blocks are logged and skipped. The classname is not listed among the properties.
+        static void parse(std::string_view lump, std::vector<BSPEntity>& entities);
+
+        static unsigned int getKeyHash(std::string_view key) { return KeyType(key).get_value(); }
+
+        [[nodiscard]] std::string_view getClassname() const { return this->classname; }
+        [[nodiscard]] std::span<const Property> getProperties() const { return this->properties; }
+        [[nodiscard]] const Property* find(std::string_view key) const;
 
+        // T can be std::string_view, std::string, an arithmetic type, glm::vec3 or glm::vec4, anything
+        // else goes through lexical_cast. Missing keys and values of the wrong shape give none.
         template<typename T = std::string>
-        boost::optional<T> getOptional(const std::string& key) const {
-            boost::optional<T> property = boost::none;
-            auto propertiesItr = this->properties.find(key);
-            if (propertiesItr != this->properties.end()) {
-                try{
-                    property = boost::lexical_cast<T>(propertiesItr->second);
-                } catch (boost::bad_lexical_cast& e) {}
-            }
-            return property;
+        boost::optional<T> getOptional(std::string_view key) const {
+            const Property* property = find(key);
+            T value;
+            if (property == nullptr || !convert(*property, value)) return boost::none;
+            return value;
         }
 
         template<typename T = std::string>
-        T get(const std::string& key) const {
-            return boost::lexical_cast<T>(this->properties.at(key));
+        T get(std::string_view key) const {
+            const boost::optional<T> value = getOptional<T>(key);
+            if (!value) throw std::out_of_range("Missing or invalid entity property: " + std::string(key));
+            return value.get();
         }
 
     private:
-        std::map<std::string, std::string> properties;
-        std::string classname;
+        std::vector<Property> properties;
+        std::string_view classname;
+
+        static void parseNumbers(Property& property);
+
+        template<typename T>
+        static bool convert(const Property& property, T& value) {
+            if constexpr (std::is_same_v<T, std::string_view>) {
+                value = property.value;
+                return true;
+            } else if constexpr (std::is_same_v<T, std::string>) {
+                value.assign(property.value);
+                return true;
+            } else if constexpr (std::is_same_v<T, bool>) {
+                if (!property.isInteger) return false;
+                value = property.integer != 0;
+                return true;
+            } else if constexpr (std::is_integral_v<T>) {
+                if (!property.isInteger) return false;
+                value = static_cast<T>(property.integer);
+                return true;
+            } else if constexpr (std::is_floating_point_v<T>) {
+                if (property.numberCount != 1) return false;
+                value = static_cast<T>(property.numbers[0]);
+                return true;
+            } else if constexpr (std::is_same_v<T, glm::vec3>) {
+                if (property.numberCount != 3) return false;
+                value = glm::vec3(property.numbers[0], property.numbers[1], property.numbers[2]);
+                return true;
+            } else if constexpr (std::is_same_v<T, glm::vec4>) {
+                if (property.numberCount != 4) return false;
+                value = glm::vec4(property.numbers[0], property.numbers[1], property.numbers[2], property.numbers[3]);
+                return true;
+            } else {
+                try {
+                    value = boost::lexical_cast<T>(property.value);
+                    return true;
+                } catch (boost::bad_lexical_cast&) {
+                    return false;
+                }
+            }
+        }
     };
 }
 
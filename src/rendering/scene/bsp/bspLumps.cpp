@@ -0,0 +1,72 @@
+#include "bspLumps.hpp"
+
+#include <string>
+
+#include "../../../utils/simd.hpp"
+
+namespace Rendering::Scene {
+    namespace Lumps {
+        void swizzleLocations(float* data, size_t count) {
+            size_t i = 0;
+#if QUAKE_SIMD_SSE2
+            //four locations (three registers) per iteration:
+            //a = [x0 y0 z0 x1], b = [y1 z1 x2 y2], c = [z2 x3 y3 z3]
+            const __m128 signs0 = _mm_castsi128_ps(_mm_set_epi32(0, static_cast<int>(0x80000000), 0, 0));
+            const __m128 signs1 = _mm_castsi128_ps(_mm_set_epi32(0, 0, static_cast<int>(0x80000000), 0));
+            const __m128 signs2 = _mm_castsi128_ps(_mm_set_epi32(static_cast<int>(0x80000000), 0, 0, static_cast<int>(0x80000000)));
+
+            for (; i + 4 <= count; i += 4) {
+                float* ptr = data + (i * 3);
+                const __m128 a = _mm_loadu_ps(ptr);
+                const __m128 b = _mm_loadu_ps(ptr + 4);
+                const __m128 c = _mm_loadu_ps(ptr + 8);
+
+                //[x0 z0 -y0 x1]
+                const __m128 out0 = _mm_xor_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 1, 2, 0)), signs0);
+
+                //[z1 -y1 x2 z2]
+                const __m128 bc0 = _mm_shuffle_ps(b, c, _MM_SHUFFLE(0, 0, 2, 2));
+                const __m128 out1 = _mm_xor_ps(_mm_shuffle_ps(b, bc0, _MM_SHUFFLE(2, 0, 0, 1)), signs1);
+
+                //[-y2 x3 z3 -y3]
+                const __m128 bc1 = _mm_shuffle_ps(b, c, _MM_SHUFFLE(1, 1, 3, 3));
+                const __m128 out2 = _mm_xor_ps(_mm_shuffle_ps(bc1, c, _MM_SHUFFLE(2, 3, 2, 0)), signs2);
+
+                _mm_storeu_ps(ptr, out0);
+                _mm_storeu_ps(ptr + 4, out1);
+                _mm_storeu_ps(ptr + 8, out2);
+            }
+#endif
+            for (; i < count; ++i) {
+                float* ptr = data + (i * 3);
+                const float y = ptr[1];
+                ptr[1] = ptr[2];
+                ptr[2] = -y;
+            }
+        }
+    }
+
+    BSPLumpReader::BSPLumpReader(std::span<const char> data) :
+            data(data) {
+        static const size_t HEADER_SIZE = sizeof(int) + (sizeof(BSPChunk) * static_cast<size_t>(BSPChunk::Type::COUNT));
+        if (data.size() < HEADER_SIZE) throw std::runtime_error("BSP data is too small to contain a header");
+
+        //version
+        int version;
+        std::memcpy(&version, data.data(), sizeof(int));
+        if (version != VERSION) throw std::runtime_error("Bad BSP version: " + std::to_string(version));
+
+        //chunks
+        std::memcpy(this->chunks.data(), data.data() + sizeof(int), sizeof(BSPChunk) * this->chunks.size());
+        for (const BSPChunk& chunk : this->chunks) {
+            if (static_cast<size_t>(chunk.offset) + chunk.length > data.size()) {
+                throw std::runtime_error("BSP chunk exceeds file bounds");
+            }
+        }
+    }
+
+    std::span<const char> BSPLumpReader::getBytes(BSPChunk::Type type) const {
+        const BSPChunk& chunk = getChunk(type);
+        return this->data.subspan(chunk.offset, chunk.length);
+    }
+}
@@ -0,0 +1,145 @@
+#pragma once
+
+#ifndef QUAKE_BSPLUMPS_HPP
+#define QUAKE_BSPLUMPS_HPP
+
+#include <array>
+#include <span>
+#include <vector>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+#include <glm/glm.hpp>
+
+namespace Rendering::Scene {
+    struct BSPChunk {
+        enum class Type: unsigned char {
+            ENTITIES,
+            PLANES,
+            TEXTURES,
+            VERTICES,
+            VISIBLIITY,
+            NODES,
+            TEXTURE_INFO,
+            FACES,
+            LIGHTING,
+            CLIP_NODES,
+            LEAVES,
+            MARK_SURFACES,
+            EDGES,
+            SURFACE_EDGES,
+            MODELS,
+            COUNT
+        };
+
+        unsigned int offset = 0;
+        unsigned int length = 0;
+    };
+
+    // On-disk BSP30 records. These mirror the file layout byte for byte (every field is
+    // naturally aligned, so no packing is needed) so a lump can be copied out in one go
+    // and converted in a tight loop afterwards.
+    namespace Lumps {
+        struct Plane {
+            float normal[3];
+            float distance;
+            int type;
+        };
+
+        struct Node {
+            int planeIndex;
+            short childIndices[2];
+            short min[3];
+            short max[3];
+            unsigned short faceStartIndex;
+            unsigned short faceCount;
+        };
+
+        struct Leaf {
+            int contentType;
+            int visibilityOffset;
+            short min[3];
+            short max[3];
+            unsigned short markSurfaceStartIndex;
+            unsigned short markSurfaceCount;
+            unsigned char ambientSoundLevels[4];
+        };
+
+        struct Model {
+            float min[3];
+            float max[3];
+            float origin[3];
+            int headNodeIndices[4];
+            int visLeafs;
+            int faceStartIndex;
+            int faceCount;
+        };
+
+        struct TextureInfo {
+            float s[4];
+            float t[4];
+            unsigned int textureIndex;
+            unsigned int flags;
+        };
+
+        struct MipTexture {
+            static const auto NAME_LENGTH = 16;
+            static const auto MIPMAP_OFFSET_COUNT = 4;
+            char name[NAME_LENGTH];
+            unsigned int width;
+            unsigned int height;
+            unsigned int mipmapOffsets[MIPMAP_OFFSET_COUNT];
+        };
+
+        static_assert(sizeof(Plane) == 20);
+        static_assert(sizeof(Node) == 24);
+        static_assert(sizeof(Leaf) == 28);
+        static_assert(sizeof(Model) == 64);
+        static_assert(sizeof(TextureInfo) == 40);
+        static_assert(sizeof(MipTexture) == 40);
+
+        //BSP files are Z-up, we are Y-up: (x, y, z) -> (x, z, -y)
+        template<typename T>
+        inline glm::tvec3<T> swizzle(const T (&v)[3]) {
+            return glm::tvec3<T>(v[0], v[2], static_cast<T>(-v[1]));
+        }
+
+        // In-place (x, y, z) -> (x, z, -y) over a packed array of float triples.
+        void swizzleLocations(float* data, size_t count);
+    }
+
+    struct BSPLumpReader {
+        static const int VERSION = 30;
+
+        explicit BSPLumpReader(std::span<const char> data);
+
+        [[nodiscard]] const BSPChunk& getChunk(BSPChunk::Type type) const { return this->chunks[static_cast<size_t>(type)]; }
+        [[nodiscard]] std::span<const char> getBytes(BSPChunk::Type type) const;
+
+        // Copies a whole lump out as an array of trivially copyable records in a single pass.
+        template<typename T>
+        void read(BSPChunk::Type type, std::vector<T>& data) const {
+            static_assert(std::is_trivially_copyable_v<T>, "lump records must be trivially copyable");
+            const std::span<const char> bytes = getBytes(type);
+            data.resize(bytes.size() / sizeof(T));
+            if (!data.empty()) {
+                std::memcpy(static_cast<void*>(data.data()), bytes.data(), data.size() * sizeof(T));
+            }
+        }
+
+        template<typename T>
+        static T readAt(std::span<const char> bytes, size_t offset) {
+            static_assert(std::is_trivially_copyable_v<T>, "lump records must be trivially copyable");
+            if (offset + sizeof(T) > bytes.size()) throw std::runtime_error("BSP lump record out of bounds");
+            T t;
+            std::memcpy(&t, bytes.data() + offset, sizeof(T));
+            return t;
+        }
+
+    private:
+        std::span<const char> data;
+        std::array<BSPChunk, static_cast<size_t>(BSPChunk::Type::COUNT)> chunks;
+    };
+}
+
+#endif //QUAKE_BSPLUMPS_HPP
@@ -0,0 +1,70 @@
+#include "bspPointLocator.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace Rendering::Scene {
+    void BSPPointLocator::reset(size_t nodeCount) {
+        for (std::vector<float>& normal : this->normals) {
+            normal.assign(nodeCount, 0.0f);
+        }
+        this->distances.assign(nodeCount, 0.0f);
+        this->axes.assign(nodeCount, AXIS_NONE);
+        this->frontChildIndices.assign(nodeCount, -1);
+        this->backChildIndices.assign(nodeCount, -1);
+    }
+
+    void BSPPointLocator::setNode(size_t nodeIndex, const glm::vec3& normal, float distance, int axis, int frontChildIndex, int backChildIndex) {
+        for (int i = 0; i < 3; ++i) {
+            this->normals[i][nodeIndex] = normal[i];
+        }
+        this->distances[nodeIndex] = distance;
+        this->axes[nodeIndex] = static_cast<int8_t>(axis);
+        this->frontChildIndices[nodeIndex] = frontChildIndex;
+        this->backChildIndices[nodeIndex] = backChildIndex;
+    }
+
+    void BSPPointLocator::assign(const Nodes& nodes) {
+        const size_t nodeCount = nodes.distances.size();
+        for (const std::span<const float>& normal : nodes.normals) {
+            if (normal.size() != nodeCount) throw std::runtime_error("Point locator array size mismatch");
+        }
+        if (nodes.axes.size() != nodeCount || nodes.frontChildIndices.size() != nodeCount || nodes.backChildIndices.size() != nodeCount) {
+            throw std::runtime_error("Point locator array size mismatch");
+        }
+
+        for (int i = 0; i < 3; ++i) {
+            this->normals[i].assign(nodes.normals[i].begin(), nodes.normals[i].end());
+        }
+        this->distances.assign(nodes.distances.begin(), nodes.distances.end());
+        this->axes.assign(nodes.axes.begin(), nodes.axes.end());
+        this->frontChildIndices.assign(nodes.frontChildIndices.begin(), nodes.frontChildIndices.end());
+        this->backChildIndices.assign(nodes.backChildIndices.begin(), nodes.backChildIndices.end());
+    }
+
+    BSPPointLocator::Nodes BSPPointLocator::getNodes() const {
+        return { { this->normals[0], this->normals[1], this->normals[2] }, this->distances, this->axes, this->frontChildIndices, this->backChildIndices };
+    }
+
+    int BSPPointLocator::locate(const glm::vec3& location) const {
+        if (this->distances.empty()) return 0;
+
+        int nodeIndex = 0;
+        while (nodeIndex >= 0) {
+            const int axis = this->axes[nodeIndex];
+            //the other normal components are zero, so this matches the full dot product exactly
+            const float side = axis != AXIS_NONE ?
+                    (location[axis] * this->normals[axis][nodeIndex]) - this->distances[nodeIndex] :
+                    ((location.x * this->normals[0][nodeIndex]) + (location.y * this->normals[1][nodeIndex]) + (location.z * this->normals[2][nodeIndex])) - this->distances[nodeIndex];
+            nodeIndex = side >= 0 ? this->frontChildIndices[nodeIndex] : this->backChildIndices[nodeIndex];
+        }
+        return ~nodeIndex;
+    }
+
+    void BSPPointLocator::locate(std::span<const glm::vec3> locations, std::span<int> leafIndices) const {
+        //points split onto different paths within a few nodes, so each walks alone with the axial shortcut
+        for (size_t i = 0; i < locations.size(); ++i) {
+            leafIndices[i] = locate(locations[i]);
+        }
+    }
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#ifndef QUAKE_BSPPOINTLOCATOR_HPP
+#define QUAKE_BSPPOINTLOCATOR_HPP
+
+#include <span>
+#include <array>
+#include <vector>
+#include <cstdint>
+#include <glm/glm.hpp>
+
+namespace Rendering::Scene {
+    // Finds the leaf holding a point by walking the render nodes. Planes are kept as separate
+    // arrays per component (structure of arrays). Axial planes test a single coordinate.
+    struct BSPPointLocator {
+        static const int AXIS_NONE = -1;
+
+        // The node arrays as set, one entry per node.
+        struct Nodes {
+            std::array<std::span<const float>, 3> normals;
+            std::span<const float> distances;
+            std::span<const int8_t> axes;
+            std::span<const int> frontChildIndices;
+            std::span<const int> backChildIndices;
+        };
+
+        // Sizes every array, nodes are filled in afterwards.
+        void reset(size_t nodeCount);
+        // axis is the coordinate an axial plane's normal lies along, or AXIS_NONE.
+        void setNode(size_t nodeIndex, const glm::vec3& normal, float distance, int axis, int frontChildIndex, int backChildIndex);
+        // Adopts nodes flattened elsewhere (e.g. a compiled level) in place of reset and setNode.
+        void assign(const Nodes& nodes);
+        [[nodiscard]] Nodes getNodes() const;
+
+        // Points exactly on a plane go to the front, like SV_PointInLeaf.
+        [[nodiscard]] int locate(const glm::vec3& location) const;
+        // Writes the leaf of every location into the matching entry of leafIndices.
+        void locate(std::span<const glm::vec3> locations, std::span<int> leafIndices) const;
+
+    private:
+        std::array<std::vector<float>, 3> normals;
+        std::vector<float> distances;
+        std::vector<int8_t> axes;
+        std::vector<int> frontChildIndices;
+        std::vector<int> backChildIndices;
+    };
+}
+
+#endif //QUAKE_BSPPOINTLOCATOR_HPP
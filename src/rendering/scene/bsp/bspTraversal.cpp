@@ -0,0 +1,105 @@
+#include "bspTraversal.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace Rendering::Scene {
+    void BSPTraversal::reset(size_t nodeCount, size_t leafCount, size_t faceCount) {
+        this->nodePlanes.assign(nodeCount, glm::vec4(0.0f));
+        this->nodeChildIndices.assign(nodeCount, { -1, -1 });
+        this->nodeBounds.assign(nodeCount, AABBType());
+        this->nodeParents.assign(nodeCount, -1);
+        this->nodeVisFrames.assign(nodeCount, 0);
+
+        this->leafBounds.assign(leafCount, AABBType());
+        this->leafParents.assign(leafCount, -1);
+        this->leafVisFrames.assign(leafCount, 0);
+
+        this->faceFrames.assign(faceCount, 0);
+
+        this->visibleLeaves.clear();
+        this->visibleLeaves.reserve(leafCount);
+        //the stack never holds more than one entry per node plus the pending sibling leaves
+        this->stack.clear();
+        this->stack.reserve(nodeCount + 2);
+        this->cameraLeafIndex = 0;
+        this->visFrame = 0;
+        this->frame = 0;
+    }
+
+    void BSPTraversal::setNode(size_t nodeIndex, const glm::vec3& normal, float distance, const ChildIndicesType& childIndices, const AABBType& bounds) {
+        this->nodePlanes[nodeIndex] = glm::vec4(normal, distance);
+        this->nodeChildIndices[nodeIndex] = childIndices;
+        this->nodeBounds[nodeIndex] = bounds;
+    }
+
+    void BSPTraversal::setLeaf(size_t leafIndex, const AABBType& bounds) {
+        this->leafBounds[leafIndex] = bounds;
+    }
+
+    void BSPTraversal::build() {
+        for (size_t nodeIndex = 0; nodeIndex < this->nodeChildIndices.size(); ++nodeIndex) {
+            for (const int childIndex : this->nodeChildIndices[nodeIndex]) {
+                if (childIndex >= 0) {
+                    if (static_cast<size_t>(childIndex) < this->nodeParents.size()) this->nodeParents[childIndex] = static_cast<int>(nodeIndex);
+                } else if (static_cast<size_t>(~childIndex) < this->leafParents.size()) {
+                    //leaf 0 is shared by every solid child so its parent is meaningless, it is never drawn
+                    this->leafParents[~childIndex] = static_cast<int>(nodeIndex);
+                }
+            }
+        }
+    }
+
+    void BSPTraversal::assign(const Tree& tree, size_t faceCount) {
+        const size_t nodeCount = tree.nodePlanes.size();
+        const size_t leafCount = tree.leafBounds.size();
+        if (tree.nodeChildIndices.size() != nodeCount || tree.nodeBounds.size() != nodeCount || tree.nodeParents.size() != nodeCount || tree.leafParents.size() != leafCount) {
+            throw std::runtime_error("Traversal array size mismatch");
+        }
+
+        reset(nodeCount, leafCount, faceCount);
+        std::copy(tree.nodePlanes.begin(), tree.nodePlanes.end(), this->nodePlanes.begin());
+        std::copy(tree.nodeChildIndices.begin(), tree.nodeChildIndices.end(), this->nodeChildIndices.begin());
+        std::copy(tree.nodeBounds.begin(), tree.nodeBounds.end(), this->nodeBounds.begin());
+        std::copy(tree.nodeParents.begin(), tree.nodeParents.end(), this->nodeParents.begin());
+        std::copy(tree.leafBounds.begin(), tree.leafBounds.end(), this->leafBounds.begin());
+        std::copy(tree.leafParents.begin(), tree.leafParents.end(), this->leafParents.begin());
+    }
+
+    BSPTraversal::Tree BSPTraversal::getTree() const {
+        return { this->nodePlanes, this->nodeChildIndices, this->nodeBounds, this->nodeParents, this->leafBounds, this->leafParents };
+    }
+
+    void BSPTraversal::beginFrame(int cameraLeafIndex, const BSPVisibilityMatrix& visibility) {
+        if (++this->frame == 0) {
+            std::fill(this->faceFrames.begin(), this->faceFrames.end(), 0);
+            this->frame = 1;
+        }
+
+        if (this->visFrame != 0 && cameraLeafIndex == this->cameraLeafIndex) return;
+        markVisibleLeaves(cameraLeafIndex, visibility);
+    }
+
+    void BSPTraversal::markVisibleLeaves(int cameraLeafIndex, const BSPVisibilityMatrix& visibility) {
+        if (++this->visFrame == 0) {
+            std::fill(this->nodeVisFrames.begin(), this->nodeVisFrames.end(), 0);
+            std::fill(this->leafVisFrames.begin(), this->leafVisFrames.end(), 0);
+            this->visFrame = 1;
+        }
+        this->cameraLeafIndex = cameraLeafIndex;
+        this->visibleLeaves.clear();
+
+        //mark each visible leaf and the path up to the root, stopping at the first node already on a marked path
+        visibility.forEachVisibleLeaf(cameraLeafIndex, [this](int leafIndex) {
+            if (static_cast<size_t>(leafIndex) >= this->leafVisFrames.size()) return;
+
+            this->leafVisFrames[leafIndex] = this->visFrame;
+            this->visibleLeaves.push_back(leafIndex);
+
+            for (int nodeIndex = this->leafParents[leafIndex]; nodeIndex >= 0; nodeIndex = this->nodeParents[nodeIndex]) {
+                if (this->nodeVisFrames[nodeIndex] == this->visFrame) break;
+                this->nodeVisFrames[nodeIndex] = this->visFrame;
+            }
+        });
+    }
+}
@@ -0,0 +1,180 @@
+#pragma once
+
+#ifndef QUAKE_BSPTRAVERSAL_HPP
+#define QUAKE_BSPTRAVERSAL_HPP
+
+#include <span>
+#include <array>
+#include <atomic>
+#include <vector>
+#include <cstdint>
+#include <glm/glm.hpp>
+
+#include "../../../scene/structure/aabb.hpp"
+#include "../../../physics/collision.hpp"
+#include "../../view/frustum.hpp"
+#include "bspVisibilityMatrix.hpp"
+
+namespace Rendering::Scene {
+    // Flattened view of the BSP tree used by the renderer. Nodes are stored as parallel arrays
+    // and walked with an explicit stack. Visibility is tracked with frame stamps instead of
+    // per-frame sets: leaves and nodes carry the PVS generation they were last marked in, faces
+    // carry the frame they were last drawn in. Nothing here allocates once build() has run.
+    struct BSPTraversal {
+        typedef ::Scenes::Structure::AABB3<float> AABBType;
+        typedef std::array<int, 2> ChildIndicesType;
+
+        struct Stats {
+            unsigned int culledNodeCount = 0;
+            unsigned int culledLeafCount = 0;
+
+            Stats& operator+=(const Stats& rhs) {
+                this->culledNodeCount += rhs.culledNodeCount;
+                this->culledLeafCount += rhs.culledLeafCount;
+                return *this;
+            }
+        };
+
+        // Pending node (or, for a negative index, leaf) on the walk. Subtree roots handed out by
+        // split are entries too: nodes have not been tested yet, leaves already passed.
+        struct StackEntry {
+            int nodeIndex;
+            unsigned int planeMask;
+            unsigned int depth;
+        };
+
+        // The built tree as flat arrays, one entry per node or leaf, without the frame stamps.
+        struct Tree {
+            std::span<const glm::vec4> nodePlanes;
+            std::span<const ChildIndicesType> nodeChildIndices;
+            std::span<const AABBType> nodeBounds;
+            std::span<const int> nodeParents;
+            std::span<const AABBType> leafBounds;
+            std::span<const int> leafParents;
+        };
+
+        static const unsigned int NO_SPLIT = ~0u;
+
+        // Sizes every array and clears all stamps. Nodes and leaves are filled in afterwards.
+        void reset(size_t nodeCount, size_t leafCount, size_t faceCount);
+        void setNode(size_t nodeIndex, const glm::vec3& normal, float distance, const ChildIndicesType& childIndices, const AABBType& bounds);
+        void setLeaf(size_t leafIndex, const AABBType& bounds);
+        // Links children to their parents, call once every node is set.
+        void build();
+        // Adopts a tree flattened elsewhere (e.g. a compiled level) in place of the calls above.
+        void assign(const Tree& tree, size_t faceCount);
+        [[nodiscard]] Tree getTree() const;
+
+        // Starts a frame. The visible leaf list and node marks are only rebuilt when the camera
+        // moved into a different leaf (or the first time round).
+        void beginFrame(int cameraLeafIndex, const BSPVisibilityMatrix& visibility);
+
+        // Walks the subtree under headNodeIndex front to back from the eye location, calling
+        // fn(leafIndex) for every leaf that passes the PVS (when usePvs is set) and the frustum.
+        // offset translates the node bounds, for brush models placed in the world.
+        template<typename F>
+        void traverse(int headNodeIndex, const glm::vec3& eye, const View::Frustum<float>& frustum, const glm::vec3& offset, bool usePvs, Stats& stats, F&& fn) {
+            walk(this->stack, { headNodeIndex, Physics::FRUSTUM_PLANE_MASK_ALL, 0 }, eye, frustum, offset, usePvs, NO_SPLIT, stats, fn, [](const StackEntry&) {});
+        }
+
+        // Walks the world tree down to splitDepth like traverse (with the PVS), appending the
+        // subtree roots found there, and any leaf that passed above them, front to back.
+        void split(int headNodeIndex, const glm::vec3& eye, const View::Frustum<float>& frustum, unsigned int splitDepth, Stats& stats, std::vector<StackEntry>& subtrees) {
+            walk(this->stack, { headNodeIndex, Physics::FRUSTUM_PLANE_MASK_ALL, 0 }, eye, frustum, glm::vec3(0.0f), true, splitDepth, stats,
+                 [&subtrees, splitDepth](int leafIndex) { subtrees.push_back({ ~leafIndex, 0, splitDepth }); },
+                 [&subtrees](const StackEntry& entry) { subtrees.push_back(entry); });
+        }
+
+        // Finishes a subtree from split. The tree is only read, so jobs can walk different
+        // subtrees at the same time as long as each brings its own stack and stats.
+        template<typename F>
+        void traverseSubtree(const StackEntry& subtree, const glm::vec3& eye, const View::Frustum<float>& frustum, std::vector<StackEntry>& stack, Stats& stats, F&& fn) const {
+            if (subtree.nodeIndex < 0) {
+                fn(~subtree.nodeIndex);
+                return;
+            }
+            walk(stack, subtree, eye, frustum, glm::vec3(0.0f), true, NO_SPLIT, stats, fn, [](const StackEntry&) {});
+        }
+
+        // Stamps a face as drawn this frame. Returns false if it was already drawn.
+        bool markFace(size_t faceIndex) {
+            if (this->faceFrames[faceIndex] == this->frame) return false;
+            this->faceFrames[faceIndex] = this->frame;
+            return true;
+        }
+
+        // markFace for jobs running at the same time, exactly one caller gets true for a face.
+        bool markFaceShared(size_t faceIndex) {
+            return std::atomic_ref<uint32_t>(this->faceFrames[faceIndex]).exchange(this->frame, std::memory_order_relaxed) != this->frame;
+        }
+
+        [[nodiscard]] const std::vector<int>& getVisibleLeaves() const { return this->visibleLeaves; }
+        [[nodiscard]] const AABBType& getLeafBounds(size_t leafIndex) const { return this->leafBounds[leafIndex]; }
+
+    private:
+        //node data, one entry per node in each array
+        std::vector<glm::vec4> nodePlanes;
+        std::vector<ChildIndicesType> nodeChildIndices;
+        std::vector<AABBType> nodeBounds;
+        std::vector<int> nodeParents;
+        std::vector<uint32_t> nodeVisFrames;
+
+        std::vector<AABBType> leafBounds;
+        std::vector<int> leafParents;
+        std::vector<uint32_t> leafVisFrames;
+
+        std::vector<uint32_t> faceFrames;
+
+        std::vector<int> visibleLeaves;
+        std::vector<StackEntry> stack;
+        int cameraLeafIndex = 0;
+        uint32_t visFrame = 0;
+        uint32_t frame = 0;
+
+        void markVisibleLeaves(int cameraLeafIndex, const BSPVisibilityMatrix& visibility);
+
+        //fn(leafIndex) for leaves that pass, onSplit(entry) for untested nodes at splitDepth
+        template<typename F, typename G>
+        void walk(std::vector<StackEntry>& stack, const StackEntry& root, const glm::vec3& eye, const View::Frustum<float>& frustum, const glm::vec3& offset, bool usePvs, unsigned int splitDepth, Stats& stats, F&& fn, G&& onSplit) const {
+            stack.clear();
+            stack.push_back(root);
+
+            while (!stack.empty()) {
+                StackEntry entry = stack.back();
+                stack.pop_back();
+
+                if (entry.nodeIndex < 0) {
+                    const int leafIndex = ~entry.nodeIndex;
+                    if (leafIndex == 0) continue;
+                    if (usePvs && this->leafVisFrames[leafIndex] != this->visFrame) continue;
+                    if (Physics::intersects(frustum, this->leafBounds[leafIndex] + offset, entry.planeMask) == Physics::IntersectType::DISJOINT) {
+                        ++stats.culledLeafCount;
+                        continue;
+                    }
+                    fn(leafIndex);
+                    continue;
+                }
+
+                if (entry.depth >= splitDepth) {
+                    onSplit(entry);
+                    continue;
+                }
+
+                if (usePvs && this->nodeVisFrames[entry.nodeIndex] != this->visFrame) continue;
+                if (Physics::intersects(frustum, this->nodeBounds[entry.nodeIndex] + offset, entry.planeMask) == Physics::IntersectType::DISJOINT) {
+                    ++stats.culledNodeCount;
+                    continue;
+                }
+
+                //push the far side first so the near side is popped (and drawn) first
+                const glm::vec4& plane = this->nodePlanes[entry.nodeIndex];
+                const ChildIndicesType& childIndices = this->nodeChildIndices[entry.nodeIndex];
+                const bool isFront = glm::dot(glm::vec3(plane), eye - offset) - plane.w > 0;
+                stack.push_back({ childIndices[isFront ? 1 : 0], entry.planeMask, entry.depth + 1 });
+                stack.push_back({ childIndices[isFront ? 0 : 1], entry.planeMask, entry.depth + 1 });
+            }
+        }
+    };
+}
+
+#endif //QUAKE_BSPTRAVERSAL_HPP
@@ -0,0 +1,61 @@
+#include "bspVisibilityMatrix.hpp"
+
+#include "../../../core/threading/workerPool.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace Rendering::Scene {
+    void BSPVisibilityMatrix::resize(size_t rowCount, size_t leafCount) {
+        this->rowCount = rowCount;
+        this->columnCount = leafCount > 0 ? leafCount - 1 : 0;
+        this->wordsPerRow = (this->columnCount + WORD_BIT_COUNT - 1) / WORD_BIT_COUNT;
+        this->words.assign(this->rowCount * this->wordsPerRow, ~WordType(0));
+
+        //bits past the last leaf stay clear so row scans never report leaves that do not exist
+        const size_t tailBitCount = this->columnCount % WORD_BIT_COUNT;
+        if (tailBitCount != 0) {
+            const WordType tailMask = (WordType(1) << tailBitCount) - 1;
+            for (size_t rowIndex = 0; rowIndex < this->rowCount; ++rowIndex) {
+                getRow(rowIndex).back() &= tailMask;
+            }
+        }
+    }
+
+    void BSPVisibilityMatrix::assign(size_t rowCount, size_t leafCount, std::span<const WordType> words) {
+        resize(rowCount, leafCount);
+        if (words.size() != this->words.size()) throw std::runtime_error("Visibility matrix size mismatch");
+        std::copy(words.begin(), words.end(), this->words.begin());
+    }
+
+    void BSPVisibilityMatrix::assignHearable(const BSPVisibilityMatrix& visibility) {
+        static const size_t ROWS_PER_JOB = 64;
+        resize(visibility.rowCount, visibility.columnCount + 1);
+
+        Core::Threading::workers.parallelFor(0, this->rowCount, ROWS_PER_JOB, [&](size_t rowBegin, size_t rowEnd) {
+            for (size_t rowIndex = rowBegin; rowIndex < rowEnd; ++rowIndex) {
+                const std::span<const WordType> visibleRow = visibility.getRow(rowIndex);
+                const std::span<WordType> row = getRow(rowIndex);
+                std::copy(visibleRow.begin(), visibleRow.end(), row.begin());
+
+                for (size_t wordIndex = 0; wordIndex < visibleRow.size(); ++wordIndex) {
+                    for (WordType word = visibleRow[wordIndex]; word != 0; word &= word - 1) {
+                        //leaves past the vis leaves (brush model leaves) carry no row of their own
+                        const size_t column = (wordIndex * WORD_BIT_COUNT) + std::countr_zero(word);
+                        if (column >= this->rowCount) continue;
+
+                        const std::span<const WordType> otherRow = visibility.getRow(column);
+                        for (size_t i = 0; i < row.size(); ++i) {
+                            row[i] |= otherRow[i];
+                        }
+                    }
+                }
+            }
+        });
+    }
+
+    void BSPVisibilityMatrix::clearRow(size_t rowIndex) {
+        const std::span<WordType> row = getRow(rowIndex);
+        std::fill(row.begin(), row.end(), 0);
+    }
+}
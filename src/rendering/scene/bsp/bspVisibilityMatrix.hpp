@@ -0,0 +1,78 @@
+#pragma once
+
+#ifndef QUAKE_BSPVISIBILITYMATRIX_HPP
+#define QUAKE_BSPVISIBILITYMATRIX_HPP
+
+#include <bit>
+#include <span>
+#include <vector>
+#include <cstdint>
+
+namespace Rendering::Scene {
+    // Decompressed PVS as one row-major bit matrix. Row r holds what leaf r + 1 can see and
+    // bit c of a row stands for leaf c + 1, mirroring the BSP30 convention that leaf 0 is the
+    // shared solid leaf. Leaves without visibility data get a row that sees everything.
+    struct BSPVisibilityMatrix {
+        typedef uint64_t WordType;
+        static const size_t WORD_BIT_COUNT = 64;
+
+        // Sizes the matrix for rowCount visible leaves out of leafCount leaves (leaf 0 included).
+        // Every row starts out fully visible.
+        void resize(size_t rowCount, size_t leafCount);
+
+        // Adopts rows that were flattened elsewhere (e.g. a compiled level).
+        void assign(size_t rowCount, size_t leafCount, std::span<const WordType> words);
+
+        // Builds the potentially hearable set from a PVS. Each row becomes the union of its own PVS
+        // row and the PVS rows of every leaf it sees (as in Quake's PHS). Rows are built in parallel
+        // on the worker pool, a whole word at a time.
+        void assignHearable(const BSPVisibilityMatrix& visibility);
+
+        [[nodiscard]] bool isLeafVisibleFrom(int fromLeafIndex, int toLeafIndex) const {
+            if (toLeafIndex <= 0 || static_cast<size_t>(toLeafIndex) > this->columnCount) return false;
+            if (!hasRow(fromLeafIndex)) return true;
+
+            const size_t column = static_cast<size_t>(toLeafIndex - 1);
+            const WordType word = this->words[(static_cast<size_t>(fromLeafIndex - 1) * this->wordsPerRow) + (column / WORD_BIT_COUNT)];
+            return (word >> (column % WORD_BIT_COUNT)) & 1;
+        }
+
+        // Calls fn(leafIndex) for every leaf visible from the given leaf, in ascending order.
+        template<typename F>
+        void forEachVisibleLeaf(int fromLeafIndex, F&& fn) const {
+            if (!hasRow(fromLeafIndex)) {
+                for (size_t column = 0; column < this->columnCount; ++column) {
+                    fn(static_cast<int>(column + 1));
+                }
+                return;
+            }
+
+            const std::span<const WordType> row = getRow(static_cast<size_t>(fromLeafIndex - 1));
+            for (size_t wordIndex = 0; wordIndex < row.size(); ++wordIndex) {
+                for (WordType word = row[wordIndex]; word != 0; word &= word - 1) {
+                    fn(static_cast<int>((wordIndex * WORD_BIT_COUNT) + std::countr_zero(word) + 1));
+                }
+            }
+        }
+
+        [[nodiscard]] bool hasRow(int leafIndex) const { return leafIndex > 0 && static_cast<size_t>(leafIndex) <= this->rowCount; }
+        [[nodiscard]] std::span<WordType> getRow(size_t rowIndex) { return { this->words.data() + (rowIndex * this->wordsPerRow), this->wordsPerRow }; }
+        [[nodiscard]] std::span<const WordType> getRow(size_t rowIndex) const { return { this->words.data() + (rowIndex * this->wordsPerRow), this->wordsPerRow }; }
+        [[nodiscard]] std::span<const WordType> getWords() const { return this->words; }
+        [[nodiscard]] size_t getRowCount() const { return this->rowCount; }
+        [[nodiscard]] size_t getColumnCount() const { return this->columnCount; }
+        [[nodiscard]] size_t getWordsPerRow() const { return this->wordsPerRow; }
+
+        // Clears a row so it can be filled from compressed visibility data.
+        void clearRow(size_t rowIndex);
+        void setVisible(size_t rowIndex, size_t column) { this->words[(rowIndex * this->wordsPerRow) + (column / WORD_BIT_COUNT)] |= WordType(1) << (column % WORD_BIT_COUNT); }
+
+    private:
+        size_t rowCount = 0;
+        size_t columnCount = 0;
+        size_t wordsPerRow = 0;
+        std::vector<WordType> words;
+    };
+}
+
+#endif //QUAKE_BSPVISIBILITYMATRIX_HPP
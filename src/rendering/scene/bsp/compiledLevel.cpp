@@ -0,0 +1,72 @@
+#include "compiledLevel.hpp"
+
+#include <boost/filesystem.hpp>
+#include <spdlog/spdlog.h>
+
+#include "../../../store/cache.hpp"
+
+namespace Rendering::Scene {
+    static size_t alignSection(size_t offset) {
+        return (offset + CompiledLevel::SECTION_ALIGNMENT - 1) & ~(CompiledLevel::SECTION_ALIGNMENT - 1);
+    }
+
+    void CompiledLevel::Writer::write(const std::string& cacheName, uint32_t sourceChecksum, uint32_t layoutChecksum) const {
+        Header header;
+        header.sourceChecksum = sourceChecksum;
+        header.layoutChecksum = layoutChecksum;
+
+        size_t offset = alignSection(sizeof(Header));
+        for (size_t i = 0; i < this->sections.size(); ++i) {
+            header.sections[i].offset = offset;
+            header.sections[i].size = this->sections[i].size();
+            offset = alignSection(offset + this->sections[i].size());
+        }
+
+        std::string data(offset, '\0');
+        std::memcpy(data.data(), &header, sizeof(Header));
+        for (size_t i = 0; i < this->sections.size(); ++i) {
+            std::memcpy(data.data() + header.sections[i].offset, this->sections[i].data(), this->sections[i].size());
+        }
+
+        Store::cache.put_buffer(cacheName, data.data(), data.size());
+    }
+
+    boost::optional<CompiledLevel> CompiledLevel::load(const std::string& cacheName, uint32_t sourceChecksum, uint32_t layoutChecksum) {
+        const std::string path = Store::cache.getPath(cacheName);
+        if (!boost::filesystem::exists(path)) return boost::none;
+
+        try {
+            Resources::IO::MappedFile file(path);
+            if (file.size() < sizeof(Header)) return boost::none;
+
+            Header header;
+            std::memcpy(&header, file.data(), sizeof(Header));
+            if (header.magic != MAGIC ||
+                header.version != VERSION ||
+                header.sourceChecksum != sourceChecksum ||
+                header.layoutChecksum != layoutChecksum) {
+                return boost::none;
+            }
+
+            //the pointer fix-up: every section has to lie inside the mapping at an aligned offset
+            for (const SectionEntry& entry : header.sections) {
+                if (entry.offset % SECTION_ALIGNMENT != 0 || entry.offset + entry.size > file.size()) {
+                    return boost::none;
+                }
+            }
+
+            return CompiledLevel(std::move(file), header);
+        } catch (const std::exception& e) {
+            spdlog::warn("Could not map compiled level {}: {}", cacheName, e.what());
+            return boost::none;
+        }
+    }
+
+    std::string CompiledLevel::getCacheName(uint32_t sourceChecksum) {
+        return "level_" + std::to_string(sourceChecksum);
+    }
+
+    CompiledLevel::CompiledLevel(Resources::IO::MappedFile file, const Header& header) :
+            file(std::move(file)),
+            header(header) {}
+}
@@ -0,0 +1,158 @@
+#pragma once
+
+#ifndef QUAKE_COMPILEDLEVEL_HPP
+#define QUAKE_COMPILEDLEVEL_HPP
+
+#include <array>
+#include <span>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+#include <boost/optional.hpp>
+
+#include "../../../resources/io/mappedFile.hpp"
+
+namespace Rendering::Scene {
+    // Everything the BSP loader derives from the raw map (converted lumps, traversal and point
+    // hull, occluders, triangulated geometry, lightmap atlas pages, decompressed PVS and the PHS
+    // built from it) in a single versioned file kept in Store::cache. Lumps that are used as they
+    // are on disk are not stored, and neither are entities, tokenising the entity lump is cheaper
+    // than reading a copy of it back.
+    // Sections are 16 byte aligned so they can be read in place from the mapping.
+    struct CompiledLevel {
+        static const uint32_t MAGIC = 0x564c4351; //"QCLV"
+        static const uint32_t VERSION = 7;
+        static const size_t SECTION_ALIGNMENT = 16;
+
+        enum class Section: uint32_t {
+            METADATA,
+            VERTICES,
+            INDICES,
+            FACE_INDEX_RANGES,
+            FACE_LIGHTMAP_PAGE_INDICES,
+            LIGHTMAP_PAGES,
+            LIGHTSTYLE_SURFACES,
+            VISIBILITY,
+            HEARABILITY,
+            PLANES,
+            NODES,
+            LEAVES,
+            MODELS,
+            TEXTURE_INFOS,
+            TRAVERSAL_NODE_PLANES,
+            TRAVERSAL_NODE_CHILD_INDICES,
+            TRAVERSAL_NODE_BOUNDS,
+            TRAVERSAL_NODE_PARENTS,
+            TRAVERSAL_LEAF_BOUNDS,
+            TRAVERSAL_LEAF_PARENTS,
+            LOCATOR_NORMALS,        //every x, then every y, then every z
+            LOCATOR_DISTANCES,
+            LOCATOR_AXES,
+            LOCATOR_FRONT_CHILD_INDICES,
+            LOCATOR_BACK_CHILD_INDICES,
+            POINT_HULL_CLIP_NODES,
+            OCCLUDERS,
+            OCCLUDER_VERTICES,
+            FACE_OCCLUDER_INDICES,
+            COUNT
+        };
+
+        struct SectionEntry {
+            uint64_t offset = 0;
+            uint64_t size = 0;
+        };
+
+        struct Header {
+            uint32_t magic = MAGIC;
+            uint32_t version = VERSION;
+            uint32_t sourceChecksum = 0;
+            uint32_t layoutChecksum = 0;
+            std::array<SectionEntry, static_cast<size_t>(Section::COUNT)> sections;
+        };
+
+        struct Metadata {
+            uint32_t visLeafCount = 0;
+            uint32_t visibilityBitCount = 0;
+            uint32_t visibilityWordsPerRow = 0;
+            uint32_t lightmapPageCount = 0;
+            uint32_t lightmapPageSize = 0;
+            //vertex location dequantisation, see GeometryCompiler::LocationTransform
+            float locationOffset[3] = { 0.0f, 0.0f, 0.0f };
+            float locationScale[3] = { 1.0f, 1.0f, 1.0f };
+        };
+
+        // Atlas placement of a face whose lightmap is rebuilt from its style layers at runtime.
+        struct LightstyleSurface {
+            uint32_t faceIndex = 0;
+            uint32_t pageIndex = 0;
+            uint32_t location[2] = {};
+            uint32_t size[2] = {};
+        };
+
+        // World face used as an occluder, its vertices are a range of OCCLUDER_VERTICES.
+        struct Occluder {
+            uint32_t vertexStartIndex = 0;
+            uint32_t vertexCount = 0;
+            float center[3] = { 0.0f, 0.0f, 0.0f };
+            float radius = 0.0f;
+            float area = 0.0f;
+        };
+
+        struct Writer {
+            template<typename T>
+            void set(Section section, std::span<const T> data) {
+                static_assert(std::is_trivially_copyable_v<T>, "compiled level sections must be trivially copyable");
+                std::string& bytes = this->sections[static_cast<size_t>(section)];
+                bytes.assign(reinterpret_cast<const char*>(data.data()), data.size_bytes());
+            }
+
+            template<typename T>
+            void set(Section section, const std::vector<T>& data) { set(section, std::span<const T>(data)); }
+
+            template<typename T>
+            void set(Section section, const T& t) { set(section, std::span<const T>(&t, 1)); }
+
+            void setBytes(Section section, std::string bytes) { this->sections[static_cast<size_t>(section)] = std::move(bytes); }
+
+            // Serialises the sections and stores them in the cache under the given name.
+            void write(const std::string& cacheName, uint32_t sourceChecksum, uint32_t layoutChecksum) const;
+
+        private:
+            std::array<std::string, static_cast<size_t>(Section::COUNT)> sections;
+        };
+
+        // Maps a compiled level out of the cache. Returns nothing when there is no usable file
+        // for this source (missing, stale, different version or layout), so callers can rebuild.
+        static boost::optional<CompiledLevel> load(const std::string& cacheName, uint32_t sourceChecksum, uint32_t layoutChecksum);
+
+        static std::string getCacheName(uint32_t sourceChecksum);
+
+        template<typename T>
+        [[nodiscard]] std::span<const T> get(Section section) const {
+            static_assert(std::is_trivially_copyable_v<T>, "compiled level sections must be trivially copyable");
+            const SectionEntry& entry = this->header.sections[static_cast<size_t>(section)];
+            if (entry.size % sizeof(T) != 0) throw std::runtime_error("Compiled level section has a bad size");
+            return { reinterpret_cast<const T*>(this->file.data() + entry.offset), entry.size / sizeof(T) };
+        }
+
+        template<typename T>
+        [[nodiscard]] T getValue(Section section) const {
+            const std::span<const T> values = get<T>(section);
+            if (values.size() != 1) throw std::runtime_error("Compiled level section has a bad size");
+            return values[0];
+        }
+
+        [[nodiscard]] std::span<const char> getBytes(Section section) const { return get<char>(section); }
+
+    private:
+        Resources::IO::MappedFile file;
+        Header header;
+
+        CompiledLevel(Resources::IO::MappedFile file, const Header& header);
+    };
+}
+
+#endif //QUAKE_COMPILEDLEVEL_HPP
@@ -0,0 +1,202 @@
+#include "geometryCompiler.hpp"
+
+#include <cmath>
+#include <limits>
+#include <cstring>
+#include <algorithm>
+#include <string_view>
+#include <unordered_map>
+#include <glm/gtc/packing.hpp>
+#include <spdlog/spdlog.h>
+
+namespace Rendering::Scene {
+    static_assert(sizeof(GeometryCompiler::SourceVertexType) == sizeof(float) * 7, "vertices are welded bytewise, they must not have padding");
+    static_assert(sizeof(GeometryCompiler::QuantizedVertexType) == 16, "quantized vertex layout changed");
+
+    static const GeometryCompiler::IndexType INDEX_NONE = std::numeric_limits<GeometryCompiler::IndexType>::max();
+
+    //Forsyth's scoring: vertices of the last triangle score a flat 0.75, the rest of the cache decays
+    //with position, and vertices with few triangles left get a boost so they are finished off
+    static float getVertexScore(int cachePosition, unsigned int remainingValence) {
+        static const float CACHE_DECAY_POWER = 1.5f;
+        static const float LAST_TRIANGLE_SCORE = 0.75f;
+        static const float VALENCE_BOOST_SCALE = 2.0f;
+        static const float VALENCE_BOOST_POWER = 0.5f;
+
+        if (remainingValence == 0) return -1.0f;
+
+        float score = 0.0f;
+        if (cachePosition >= 0) {
+            if (cachePosition < 3) {
+                score = LAST_TRIANGLE_SCORE;
+            } else {
+                const float scaler = 1.0f / static_cast<float>(GeometryCompiler::CACHE_SIZE - 3);
+                score = std::pow(1.0f - (static_cast<float>(cachePosition - 3) * scaler), CACHE_DECAY_POWER);
+            }
+        }
+        return score + (VALENCE_BOOST_SCALE * std::pow(static_cast<float>(remainingValence), -VALENCE_BOOST_POWER));
+    }
+
+    GeometryCompiler::Stats GeometryCompiler::compile(std::vector<SourceVertexType>& vertices, std::vector<IndexType>& indices, std::span<const VisibleSurfaceList::IndexRange> faceIndexRanges) {
+        Stats stats;
+        stats.sourceVertexCount = vertices.size();
+        stats.sourceAcmr = getAcmr(indices);
+
+        //weld: keys point into vertices, which stays untouched until the renumbering below
+        std::vector<IndexType> weldedIndices(vertices.size());
+        std::vector<IndexType> weldedSourceIndices;
+        std::unordered_map<std::string_view, IndexType> vertexIndices;
+        vertexIndices.reserve(vertices.size());
+        for (size_t i = 0; i < vertices.size(); ++i) {
+            const std::string_view key(reinterpret_cast<const char*>(&vertices[i]), sizeof(SourceVertexType));
+            const auto [it, isInserted] = vertexIndices.try_emplace(key, static_cast<IndexType>(weldedSourceIndices.size()));
+            if (isInserted) {
+                weldedSourceIndices.push_back(static_cast<IndexType>(i));
+            }
+            weldedIndices[i] = it->second;
+        }
+        for (IndexType& index : indices) {
+            index = weldedIndices[index];
+        }
+
+        reorderTriangles(indices, faceIndexRanges, weldedSourceIndices.size());
+
+        //renumber in first use order so vertex fetches walk the buffer forwards, unused vertices go
+        std::vector<IndexType> newIndices(weldedSourceIndices.size(), INDEX_NONE);
+        std::vector<SourceVertexType> newVertices;
+        newVertices.reserve(weldedSourceIndices.size());
+        for (IndexType& index : indices) {
+            if (newIndices[index] == INDEX_NONE) {
+                newIndices[index] = static_cast<IndexType>(newVertices.size());
+                newVertices.push_back(vertices[weldedSourceIndices[index]]);
+            }
+            index = newIndices[index];
+        }
+        vertices = std::move(newVertices);
+
+        stats.vertexCount = vertices.size();
+        stats.acmr = getAcmr(indices);
+        return stats;
+    }
+
+    void GeometryCompiler::reorderTriangles(std::vector<IndexType>& indices, std::span<const VisibleSurfaceList::IndexRange> faceIndexRanges, size_t vertexCount) {
+        std::vector<unsigned int> valences(vertexCount, 0);
+        for (const IndexType index : indices) {
+            ++valences[index];
+        }
+
+        //the cache carries over from face to face, so shared vertices pull neighbours together
+        std::vector<int> cachePositions(vertexCount, -1);
+        std::vector<IndexType> cache;
+        cache.reserve(CACHE_SIZE + 3);
+        std::vector<IndexType> faceIndices;
+        std::vector<unsigned char> isEmitted;
+
+        for (const VisibleSurfaceList::IndexRange& range : faceIndexRanges) {
+            const size_t triangleCount = range.count / 3;
+            if (triangleCount == 0) continue;
+
+            faceIndices.assign(indices.begin() + range.start, indices.begin() + range.start + (triangleCount * 3));
+            isEmitted.assign(triangleCount, 0);
+
+            for (size_t outputIndex = 0; outputIndex < triangleCount; ++outputIndex) {
+                //faces are small fans, a linear scan beats keeping scores up to date
+                size_t bestTriangle = 0;
+                float bestScore = std::numeric_limits<float>::lowest();
+                for (size_t triangle = 0; triangle < triangleCount; ++triangle) {
+                    if (isEmitted[triangle]) continue;
+
+                    float score = 0.0f;
+                    for (size_t corner = 0; corner < 3; ++corner) {
+                        const IndexType index = faceIndices[(triangle * 3) + corner];
+                        score += getVertexScore(cachePositions[index], valences[index]);
+                    }
+                    if (score > bestScore) {
+                        bestScore = score;
+                        bestTriangle = triangle;
+                    }
+                }
+
+                isEmitted[bestTriangle] = 1;
+                IndexType* output = indices.data() + range.start + (outputIndex * 3);
+                for (size_t corner = 0; corner < 3; ++corner) {
+                    const IndexType index = faceIndices[(bestTriangle * 3) + corner];
+                    output[corner] = index;
+                    --valences[index];
+
+                    //move to the front, keeping the triangle's own order
+                    const auto cached = std::find(cache.begin(), cache.end(), index);
+                    if (cached != cache.end()) {
+                        cache.erase(cached);
+                    }
+                    cache.insert(cache.begin() + static_cast<std::ptrdiff_t>(corner), index);
+                }
+
+                for (size_t i = CACHE_SIZE; i < cache.size(); ++i) {
+                    cachePositions[cache[i]] = -1;
+                }
+                if (cache.size() > CACHE_SIZE) {
+                    cache.resize(CACHE_SIZE);
+                }
+                for (size_t i = 0; i < cache.size(); ++i) {
+                    cachePositions[cache[i]] = static_cast<int>(i);
+                }
+            }
+        }
+    }
+
+    GeometryCompiler::LocationTransform GeometryCompiler::quantize(std::span<const SourceVertexType> vertices, std::vector<QuantizedVertexType>& quantizedVertices) {
+        static const float QUANTIZED_EXTENT = 32767.0f;
+
+        LocationTransform transform;
+        quantizedVertices.resize(vertices.size());
+        if (vertices.empty()) return transform;
+
+        glm::vec3 min = vertices[0].location;
+        glm::vec3 max = vertices[0].location;
+        for (const SourceVertexType& vertex : vertices) {
+            min = glm::min(min, vertex.location);
+            max = glm::max(max, vertex.location);
+        }
+        transform.offset = (min + max) * 0.5f;
+        transform.scale = glm::max((max - min) * (0.5f / QUANTIZED_EXTENT), glm::vec3(1e-6f));
+
+        size_t impreciseTexcoordCount = 0;
+        for (size_t i = 0; i < vertices.size(); ++i) {
+            const SourceVertexType& vertex = vertices[i];
+            QuantizedVertexType& quantizedVertex = quantizedVertices[i];
+
+            if (std::max(std::abs(vertex.diffuseTexcoord.x), std::abs(vertex.diffuseTexcoord.y)) > QUANTIZED_TEXCOORD_LIMIT) {
+                ++impreciseTexcoordCount;
+            }
+
+            const glm::vec3 location = glm::clamp(glm::round((vertex.location - transform.offset) / transform.scale), glm::vec3(-QUANTIZED_EXTENT), glm::vec3(QUANTIZED_EXTENT));
+            quantizedVertex.location = { static_cast<int16_t>(location.x), static_cast<int16_t>(location.y), static_cast<int16_t>(location.z), 0 };
+
+            const uint32_t diffuseTexcoord = glm::packHalf2x16(vertex.diffuseTexcoord);
+            const uint32_t lightmapTexcoord = glm::packUnorm2x16(vertex.lightmapTexcoord);
+            std::memcpy(quantizedVertex.diffuseTexcoord.data(), &diffuseTexcoord, sizeof(diffuseTexcoord));
+            std::memcpy(quantizedVertex.lightmapTexcoord.data(), &lightmapTexcoord, sizeof(lightmapTexcoord));
+        }
+
+        if (impreciseTexcoordCount > 0) {
+            spdlog::warn("{} diffuse texcoords lie beyond {} repeats and lose precision as half floats, build without QUAKE_BSP_QUANTIZED_VERTICES for this level", impreciseTexcoordCount, QUANTIZED_TEXCOORD_LIMIT);
+        }
+        return transform;
+    }
+
+    float GeometryCompiler::getAcmr(std::span<const IndexType> indices, size_t cacheSize) {
+        if (indices.size() < 3) return 0.0f;
+
+        std::vector<IndexType> cache(cacheSize, INDEX_NONE);
+        size_t cacheHead = 0;
+        size_t missCount = 0;
+        for (const IndexType index : indices) {
+            if (std::find(cache.begin(), cache.end(), index) != cache.end()) continue;
+            cache[cacheHead] = index;
+            cacheHead = (cacheHead + 1) % cacheSize;
+            ++missCount;
+        }
+        return static_cast<float>(missCount) / static_cast<float>(indices.size() / 3);
+    }
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#ifndef QUAKE_GEOMETRYCOMPILER_HPP
+#define QUAKE_GEOMETRYCOMPILER_HPP
+
+#include <span>
+#include <vector>
+#include <utility>
+#include <glm/glm.hpp>
+
+#include "visibleSurfaceList.hpp"
+#include "../../../device/gpu/shaders/programs/bspShader.hpp"
+
+namespace Rendering::Scene {
+    // Turns the per-face vertex runs built by the BSP loader into the final buffers. Identical
+    // vertices are welded, the triangles of every face are reordered for the post-transform cache
+    // with Forsyth's algorithm (faces keep their index ranges so they can still be drawn on their
+    // own), and vertices are renumbered in first use order. quantize then optionally packs them.
+    struct GeometryCompiler {
+        typedef Device::GPU::Shaders::Programs::BSPShader::Vertex SourceVertexType;
+        typedef Device::GPU::Shaders::Programs::BSPShader::QuantizedVertex QuantizedVertexType;
+        typedef unsigned int IndexType;
+
+        //LRU size the reordering optimises for
+        static const size_t CACHE_SIZE = 32;
+        //FIFO size the ACMR is measured with, about what hardware has
+        static const size_t MEASURE_CACHE_SIZE = 16;
+        //repeats from the origin up to which half floats keep 1/64 of a repeat or better
+        static constexpr float QUANTIZED_TEXCOORD_LIMIT = 16.0f;
+
+        struct Stats {
+            size_t sourceVertexCount = 0;
+            size_t vertexCount = 0;
+            //average cache miss ratio, vertices transformed per triangle
+            float sourceAcmr = 0.0f;
+            float acmr = 0.0f;
+        };
+
+        // world location = offset + (quantized location * scale)
+        struct LocationTransform {
+            glm::vec3 offset = glm::vec3(0.0f);
+            glm::vec3 scale = glm::vec3(1.0f);
+        };
+
+        // Welds, reorders and renumbers in place. The face index ranges must not overlap.
+        static Stats compile(std::vector<SourceVertexType>& vertices, std::vector<IndexType>& indices, std::span<const VisibleSurfaceList::IndexRange> faceIndexRanges);
+
+        // Positions go to int16 around the center of the bounds, diffuse texcoords to half floats
+        // and lightmap texcoords (atlas space, 0 to 1) to unorm16. Diffuse texcoords beyond
+        // QUANTIZED_TEXCOORD_LIMIT repeats are reported, such levels want the float vertices.
+        static LocationTransform quantize(std::span<const SourceVertexType> vertices, std::vector<QuantizedVertexType>& quantizedVertices);
+
+        // Moves compiled vertices into the buffer layout the shader was built for (see
+        // QUAKE_BSP_QUANTIZED_VERTICES), float vertices go through untouched.
+        static LocationTransform pack(std::vector<SourceVertexType>& vertices, std::vector<SourceVertexType>& packedVertices) {
+            packedVertices = std::move(vertices);
+            return LocationTransform();
+        }
+        static LocationTransform pack(std::vector<SourceVertexType>& vertices, std::vector<QuantizedVertexType>& packedVertices) {
+            return quantize(vertices, packedVertices);
+        }
+
+        [[nodiscard]] static float getAcmr(std::span<const IndexType> indices, size_t cacheSize = MEASURE_CACHE_SIZE);
+
+    private:
+        static void reorderTriangles(std::vector<IndexType>& indices, std::span<const VisibleSurfaceList::IndexRange> faceIndexRanges, size_t vertexCount);
+    };
+}
+
+#endif //QUAKE_GEOMETRYCOMPILER_HPP
@@ -0,0 +1,106 @@
+#include "lightmapAtlas.hpp"
+
+#include <cstring>
+#include <stdexcept>
+#include <spdlog/spdlog.h>
+
+namespace Rendering::Scene {
+    float LightmapAtlas::Page::getOccupancy() const {
+        const size_t texelCount = static_cast<size_t>(this->size.x) * this->size.y;
+        return texelCount == 0 ? 0.0f : static_cast<float>(this->usedTexelCount) / static_cast<float>(texelCount);
+    }
+
+    LightmapAtlas::LightmapAtlas(unsigned int pageSize) :
+            pageSize(pageSize) {}
+
+    LightmapAtlas::Region LightmapAtlas::insert(const glm::uvec2& size, const unsigned char* data) {
+        const glm::uvec2 paddedSize = size + glm::uvec2(PADDING * 2);
+        if (paddedSize.x > this->pageSize || paddedSize.y > this->pageSize) {
+            throw std::runtime_error("Lightmap is larger than an atlas page");
+        }
+
+        Region region;
+        region.size = size;
+
+        //a small lightmap can still fit a gap left on an earlier page, so every page is tried first
+        region.pageIndex = this->pages.size();
+        for (size_t i = 0; i < this->pages.size(); ++i) {
+            if (allocate(this->pages[i], paddedSize, region.location)) {
+                region.pageIndex = i;
+                break;
+            }
+        }
+
+        if (region.pageIndex == this->pages.size()) {
+            Page& page = this->pages.emplace_back();
+            page.size = glm::uvec2(this->pageSize);
+            page.data.resize(static_cast<size_t>(this->pageSize) * this->pageSize * CHANNEL_COUNT);
+            allocate(page, paddedSize, region.location);
+        }
+
+        Page& page = this->pages[region.pageIndex];
+        blit(page, region.location, size, data);
+        page.usedTexelCount += static_cast<size_t>(size.x) * size.y;
+        return region;
+    }
+
+    glm::vec2 LightmapAtlas::getTexcoord(const Region& region, const glm::vec2& lightmapTexcoord) const {
+        return (glm::vec2(region.location) + lightmapTexcoord) / static_cast<float>(this->pageSize);
+    }
+
+    void LightmapAtlas::logOccupancy() const {
+        for (size_t i = 0; i < this->pages.size(); ++i) {
+            const Page& page = this->pages[i];
+            spdlog::info("Lightmap atlas page {} ({}x{}): {:.1f}% occupied", i, page.size.x, page.size.y, page.getOccupancy() * 100.0f);
+        }
+    }
+
+    bool LightmapAtlas::allocate(Page& page, const glm::uvec2& size, glm::uvec2& location) {
+        //best fit: the shortest shelf that is tall enough and still has room
+        Page::Shelf* bestShelf = nullptr;
+        for (Page::Shelf& shelf : page.shelves) {
+            if (shelf.height < size.y || shelf.width + size.x > page.size.x) continue;
+            if (bestShelf == nullptr || shelf.height < bestShelf->height) {
+                bestShelf = &shelf;
+            }
+        }
+
+        if (bestShelf == nullptr) {
+            if (page.shelvesHeight + size.y > page.size.y) return false;
+
+            Page::Shelf& shelf = page.shelves.emplace_back();
+            shelf.y = page.shelvesHeight;
+            shelf.height = size.y;
+            page.shelvesHeight += size.y;
+            bestShelf = &shelf;
+        }
+
+        location = glm::uvec2(bestShelf->width + PADDING, bestShelf->y + PADDING);
+        bestShelf->width += size.x;
+        return true;
+    }
+
+    void LightmapAtlas::blit(Page& page, const glm::uvec2& location, const glm::uvec2& size, const unsigned char* data) {
+        const size_t pageRowSize = static_cast<size_t>(page.size.x) * CHANNEL_COUNT;
+        blitPadded(page.data.data() + (pageRowSize * location.y) + (static_cast<size_t>(location.x) * CHANNEL_COUNT), pageRowSize, size, data);
+    }
+
+    void LightmapAtlas::blitPadded(unsigned char* destination, size_t destinationRowSize, const glm::uvec2& size, const unsigned char* data) {
+        if (size.x == 0 || size.y == 0) return;
+
+        const size_t rowSize = static_cast<size_t>(size.x) * CHANNEL_COUNT;
+
+        for (unsigned int y = 0; y < size.y + PADDING * 2; ++y) {
+            //padding rows repeat the first and last rows of the lightmap
+            const unsigned int sourceY = y < PADDING ? 0 : glm::min(y - PADDING, size.y - 1);
+            const unsigned char* source = data + (rowSize * sourceY);
+            unsigned char* row = destination + (destinationRowSize * y) - (destinationRowSize * PADDING);
+
+            std::memcpy(row, source, rowSize);
+            for (unsigned int x = 1; x <= PADDING; ++x) {
+                std::memcpy(row - (x * CHANNEL_COUNT), source, CHANNEL_COUNT);
+                std::memcpy(row + rowSize + ((x - 1) * CHANNEL_COUNT), source + rowSize - CHANNEL_COUNT, CHANNEL_COUNT);
+            }
+        }
+    }
+}
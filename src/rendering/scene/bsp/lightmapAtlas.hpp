@@ -0,0 +1,72 @@
+#pragma once
+
+#ifndef QUAKE_LIGHTMAPATLAS_HPP
+#define QUAKE_LIGHTMAPATLAS_HPP
+
+#include <vector>
+#include <glm/glm.hpp>
+
+namespace Rendering::Scene {
+    // Packs many small RGB lightmaps into a few large pages using a shelf packer.
+    // Every lightmap is surrounded by a border of replicated edge texels so that
+    // bilinear filtering never bleeds a neighbour into it.
+    struct LightmapAtlas {
+        static const unsigned int DEFAULT_PAGE_SIZE = 1024;
+        static const unsigned int PADDING = 1;
+        static const size_t CHANNEL_COUNT = 3;
+
+        struct Region {
+            size_t pageIndex = 0;
+            glm::uvec2 location;    //first texel of the lightmap itself, padding excluded
+            glm::uvec2 size;
+        };
+
+        struct Page {
+            glm::uvec2 size;
+            std::vector<unsigned char> data;
+            size_t usedTexelCount = 0;
+
+            // Fraction of the page covered by lightmap texels, padding excluded.
+            [[nodiscard]] float getOccupancy() const;
+
+        private:
+            struct Shelf {
+                unsigned int y = 0;
+                unsigned int height = 0;
+                unsigned int width = 0;
+            };
+
+            std::vector<Shelf> shelves;
+            unsigned int shelvesHeight = 0;
+
+            friend struct LightmapAtlas;
+        };
+
+        explicit LightmapAtlas(unsigned int pageSize = DEFAULT_PAGE_SIZE);
+
+        // Copies a tightly packed RGB lightmap into the atlas. Lightmaps should be inserted
+        // tallest first for the shelves to pack well. The first page with room takes it.
+        Region insert(const glm::uvec2& size, const unsigned char* data);
+
+        // Maps a texel-space coordinate inside a region's lightmap to page texture coordinates.
+        [[nodiscard]] glm::vec2 getTexcoord(const Region& region, const glm::vec2& lightmapTexcoord) const;
+
+        [[nodiscard]] const std::vector<Page>& getPages() const { return this->pages; }
+        [[nodiscard]] unsigned int getPageSize() const { return this->pageSize; }
+
+        void logOccupancy() const;
+
+        // Writes a lightmap and its replicated border. destination points at the lightmap's first
+        // texel inside a larger image whose rows are destinationRowSize bytes apart.
+        static void blitPadded(unsigned char* destination, size_t destinationRowSize, const glm::uvec2& size, const unsigned char* data);
+
+    private:
+        unsigned int pageSize;
+        std::vector<Page> pages;
+
+        bool allocate(Page& page, const glm::uvec2& size, glm::uvec2& location);
+        void blit(Page& page, const glm::uvec2& location, const glm::uvec2& size, const unsigned char* data);
+    };
+}
+
+#endif //QUAKE_LIGHTMAPATLAS_HPP
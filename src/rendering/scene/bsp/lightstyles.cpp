@@ -0,0 +1,126 @@
+#include "lightstyles.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#include "lightmapAtlas.hpp"
+
+namespace Rendering::Scene {
+    Lightstyles::Lightstyles() {
+        //the stock Half-Life table, styles 32 and up are left to switchable lights
+        this->patterns[0] = "m";
+        this->patterns[1] = "mmnmmommommnonmmonqnmmo";
+        this->patterns[2] = "abcdefghijklmnopqrstuvwxyzyxwvutsrqponmlkjihgfedcba";
+        this->patterns[3] = "mmmmmaaaaammmmmaaaaaabcdefgabcdefg";
+        this->patterns[4] = "mamamamamama";
+        this->patterns[5] = "jklmnopqrstuvwxyzyxwvutsrqponmlkj";
+        this->patterns[6] = "nmonqnmomnmomomno";
+        this->patterns[7] = "mmmaaaabcdefgmmmmaaaammmaamm";
+        this->patterns[8] = "mmmaaammmaaammmabcdefaaaammmmabcdefmmmaaaa";
+        this->patterns[9] = "aaaaaaaazzzzzzzz";
+        this->patterns[10] = "mmamammmmammamamaaamammma";
+        this->patterns[11] = "abcdefghijklmnopqrrqponmlkjihgfedcba";
+        this->patterns[12] = "mmnnmmnnnmmnn";
+        for (size_t i = 13; i < STYLE_COUNT; ++i) {
+            this->patterns[i] = "m";
+        }
+        this->patterns[63] = "a";
+        this->steps.fill(NORMAL_STEP);
+    }
+
+    void Lightstyles::set(size_t styleIndex, std::string pattern) {
+        if (styleIndex >= STYLE_COUNT) throw std::out_of_range("Lightstyle index out of range");
+        this->patterns[styleIndex] = std::move(pattern);
+        this->forcedDirtyStyles |= uint64_t(1) << styleIndex;
+    }
+
+    uint64_t Lightstyles::update(float time) {
+        const auto frame = static_cast<size_t>(std::max(0.0f, time) * FRAMES_PER_SECOND);
+        uint64_t dirtyStyles = this->forcedDirtyStyles;
+        this->forcedDirtyStyles = 0;
+
+        for (size_t i = 0; i < STYLE_COUNT; ++i) {
+            const std::string& pattern = this->patterns[i];
+            const int step = pattern.empty() ? NORMAL_STEP : glm::clamp(pattern[frame % pattern.size()] - 'a', 0, 'z' - 'a');
+            if (step != this->steps[i]) {
+                this->steps[i] = step;
+                dirtyStyles |= uint64_t(1) << i;
+            }
+        }
+        return dirtyStyles;
+    }
+
+    bool LightstyleCompositor::isAnimated(std::span<const unsigned char, LAYER_COUNT> styles) {
+        return styles[0] != STYLE_NONE && (styles[0] != 0 || styles[1] != STYLE_NONE);
+    }
+
+    size_t LightstyleCompositor::getLayerCount(std::span<const unsigned char, LAYER_COUNT> styles) {
+        size_t layerCount = 0;
+        while (layerCount < LAYER_COUNT && styles[layerCount] != STYLE_NONE) {
+            ++layerCount;
+        }
+        return layerCount;
+    }
+
+    void LightstyleCompositor::add(uint32_t faceIndex, uint32_t pageIndex, const glm::uvec2& location, const glm::uvec2& size, std::span<const unsigned char, LAYER_COUNT> styles, std::span<const unsigned char> layers) {
+        Surface& surface = this->surfaces.emplace_back();
+        surface.faceIndex = faceIndex;
+        surface.pageIndex = pageIndex;
+        surface.location = location;
+        surface.size = size;
+        std::copy(styles.begin(), styles.end(), surface.styles.begin());
+        surface.layerCount = getLayerCount(styles);
+        surface.layerOffset = this->layers.size();
+
+        //styles past the table never animate, so they never make the surface dirty
+        for (size_t i = 0; i < surface.layerCount; ++i) {
+            if (surface.styles[i] < Lightstyles::STYLE_COUNT) {
+                surface.styleMask |= uint64_t(1) << surface.styles[i];
+            }
+        }
+
+        this->layers.insert(this->layers.end(), layers.begin(), layers.end());
+
+        const size_t texelCount = static_cast<size_t>(size.x) * size.y * LightmapAtlas::CHANNEL_COUNT;
+        const size_t paddedTexelCount = static_cast<size_t>(size.x + LightmapAtlas::PADDING * 2) * (size.y + LightmapAtlas::PADDING * 2) * LightmapAtlas::CHANNEL_COUNT;
+        if (texelCount > this->accumulator.size()) {
+            this->accumulator.resize(texelCount);
+            this->texels.resize(texelCount);
+        }
+        if (paddedTexelCount > this->paddedTexels.size()) {
+            this->paddedTexels.resize(paddedTexelCount);
+        }
+    }
+
+    void LightstyleCompositor::clear() {
+        this->surfaces.clear();
+        this->layers.clear();
+    }
+
+    void LightstyleCompositor::compositeSurface(const Surface& surface, const Lightstyles& lightstyles, glm::uvec2& location, glm::uvec2& size) {
+        const size_t texelCount = static_cast<size_t>(surface.size.x) * surface.size.y * LightmapAtlas::CHANNEL_COUNT;
+        std::fill(this->accumulator.begin(), this->accumulator.begin() + texelCount, 0);
+
+        //R_BuildLightMap: sum the layers weighted by their style's step, 'm' being unscaled
+        for (size_t i = 0; i < surface.layerCount; ++i) {
+            const int step = surface.styles[i] < Lightstyles::STYLE_COUNT ? lightstyles.getStep(surface.styles[i]) : Lightstyles::NORMAL_STEP;
+            if (step == 0) continue;
+
+            const unsigned char* layer = this->layers.data() + surface.layerOffset + (texelCount * i);
+            for (size_t j = 0; j < texelCount; ++j) {
+                this->accumulator[j] += layer[j] * step;
+            }
+        }
+
+        for (size_t j = 0; j < texelCount; ++j) {
+            this->texels[j] = static_cast<unsigned char>(std::min(this->accumulator[j] / Lightstyles::NORMAL_STEP, 255));
+        }
+
+        const size_t paddedRowSize = static_cast<size_t>(surface.size.x + LightmapAtlas::PADDING * 2) * LightmapAtlas::CHANNEL_COUNT;
+        LightmapAtlas::blitPadded(this->paddedTexels.data() + (paddedRowSize * LightmapAtlas::PADDING) + (LightmapAtlas::PADDING * LightmapAtlas::CHANNEL_COUNT), paddedRowSize, surface.size, this->texels.data());
+
+        location = surface.location - glm::uvec2(LightmapAtlas::PADDING);
+        size = surface.size + glm::uvec2(LightmapAtlas::PADDING * 2);
+    }
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#ifndef QUAKE_LIGHTSTYLES_HPP
+#define QUAKE_LIGHTSTYLES_HPP
+
+#include <array>
+#include <span>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <glm/glm.hpp>
+
+namespace Rendering::Scene {
+    // Lightstyle value table. Every style is a string of brightness steps from 'a' (dark) to
+    // 'z' (double bright), 'm' being normal, played back at 10 steps per second.
+    struct Lightstyles {
+        static const size_t STYLE_COUNT = 64;
+        static const unsigned int FRAMES_PER_SECOND = 10;
+        static const int NORMAL_STEP = 'm' - 'a';
+
+        Lightstyles();
+
+        // Replaces a style's pattern, e.g. "a" / "m" to switch a toggled light off / on.
+        void set(size_t styleIndex, std::string pattern);
+
+        // Steps every style to the given time and returns a bitmask of the styles whose value changed.
+        uint64_t update(float time);
+
+        // Current step of a style, 0 for 'a' up to 25 for 'z'. NORMAL_STEP leaves a layer unchanged.
+        [[nodiscard]] int getStep(size_t styleIndex) const { return this->steps[styleIndex]; }
+
+    private:
+        std::array<std::string, STYLE_COUNT> patterns;
+        std::array<int, STYLE_COUNT> steps;
+        uint64_t forcedDirtyStyles = ~uint64_t(0);
+    };
+
+    // Keeps the per-style lightmap layers of every face lit by something other than the static
+    // style 0, and rebuilds only the faces that use a style whose value changed. Each rebuilt face
+    // is handed back as one padded atlas sub-rectangle ready to upload.
+    struct LightstyleCompositor {
+        static const size_t LAYER_COUNT = 4;
+        static const unsigned char STYLE_NONE = 255;
+
+        struct Surface {
+            uint32_t faceIndex = 0;
+            uint32_t pageIndex = 0;
+            glm::uvec2 location;
+            glm::uvec2 size;
+            std::array<unsigned char, LAYER_COUNT> styles;
+            size_t layerCount = 0;
+            size_t layerOffset = 0;
+            uint64_t styleMask = 0;
+        };
+
+        // Whether a face's styles need the compositor, as opposed to a single static layer.
+        static bool isAnimated(std::span<const unsigned char, LAYER_COUNT> styles);
+        static size_t getLayerCount(std::span<const unsigned char, LAYER_COUNT> styles);
+
+        // layers holds one tightly packed RGB lightmap of the given size per used style.
+        void add(uint32_t faceIndex, uint32_t pageIndex, const glm::uvec2& location, const glm::uvec2& size, std::span<const unsigned char, LAYER_COUNT> styles, std::span<const unsigned char> layers);
+        void clear();
+
+        // Composites the surfaces touched by dirtyStyles and calls
+        // upload(pageIndex, location, size, data) with each padded RGB rectangle.
+        template<typename F>
+        size_t composite(uint64_t dirtyStyles, const Lightstyles& lightstyles, F&& upload) {
+            size_t compositeCount = 0;
+            for (const Surface& surface : this->surfaces) {
+                if (!(surface.styleMask & dirtyStyles)) continue;
+
+                glm::uvec2 location;
+                glm::uvec2 size;
+                compositeSurface(surface, lightstyles, location, size);
+                upload(surface.pageIndex, location, size, this->paddedTexels.data());
+                ++compositeCount;
+            }
+            return compositeCount;
+        }
+
+        [[nodiscard]] const std::vector<Surface>& getSurfaces() const { return this->surfaces; }
+        [[nodiscard]] bool isEmpty() const { return this->surfaces.empty(); }
+
+    private:
+        std::vector<Surface> surfaces;
+        std::vector<unsigned char> layers;
+        //scratch buffers reused by every surface, sized for the largest one
+        std::vector<int> accumulator;
+        std::vector<unsigned char> texels;
+        std::vector<unsigned char> paddedTexels;
+
+        void compositeSurface(const Surface& surface, const Lightstyles& lightstyles, glm::uvec2& location, glm::uvec2& size);
+    };
+}
+
+#endif //QUAKE_LIGHTSTYLES_HPP
@@ -0,0 +1,83 @@
+#include "mipTextureDecoder.hpp"
+
+#include <cstring>
+#include <stdexcept>
+
+#include "bspLumps.hpp"
+#include "../../../utils/simd.hpp"
+
+namespace Rendering::Scene {
+    static glm::uvec2 getLevelSize(const glm::uvec2& size, unsigned int level) {
+        return glm::max(glm::uvec2(1), size >> level);
+    }
+
+    size_t MipTextureDecoder::getChainSize(const glm::uvec2& size) {
+        size_t chainSize = 0;
+        for (unsigned int level = 0; level < LEVEL_COUNT; ++level) {
+            const glm::uvec2 levelSize = getLevelSize(size, level);
+            chainSize += static_cast<size_t>(levelSize.x) * levelSize.y * CHANNEL_COUNT;
+        }
+        return chainSize;
+    }
+
+    std::vector<unsigned char> MipTextureDecoder::decode(std::span<const char> data, glm::uvec2& size) {
+        const auto mipTexture = BSPLumpReader::readAt<Lumps::MipTexture>(data, 0);
+        if (mipTexture.mipmapOffsets[0] == 0) throw std::runtime_error("Miptex has no embedded pixels");
+        if (mipTexture.width == 0 || mipTexture.height == 0 || mipTexture.width > 4096 || mipTexture.height > 4096) {
+            throw std::runtime_error("Miptex has an invalid size");
+        }
+
+        size = glm::uvec2(mipTexture.width, mipTexture.height);
+
+        //the palette follows the smallest level: a 16 bit colour count, then RGB triplets
+        const glm::uvec2 lastLevelSize = getLevelSize(size, LEVEL_COUNT - 1);
+        const size_t paletteOffset = static_cast<size_t>(mipTexture.mipmapOffsets[LEVEL_COUNT - 1]) + (static_cast<size_t>(lastLevelSize.x) * lastLevelSize.y);
+        const size_t storedPaletteCount = BSPLumpReader::readAt<uint16_t>(data, paletteOffset);
+        const size_t paletteCount = storedPaletteCount < PALETTE_SIZE ? storedPaletteCount : PALETTE_SIZE;
+        const size_t paletteDataOffset = paletteOffset + sizeof(uint16_t);
+        if (paletteDataOffset + (paletteCount * 3) > data.size()) throw std::runtime_error("Miptex palette out of bounds");
+
+        PaletteType palette{};
+        for (size_t i = 0; i < paletteCount; ++i) {
+            const unsigned char texel[CHANNEL_COUNT] = {
+                    static_cast<unsigned char>(data[paletteDataOffset + (i * 3)]),
+                    static_cast<unsigned char>(data[paletteDataOffset + (i * 3) + 1]),
+                    static_cast<unsigned char>(data[paletteDataOffset + (i * 3) + 2]),
+                    255
+            };
+            std::memcpy(&palette[i], texel, CHANNEL_COUNT);
+        }
+        if (mipTexture.name[0] == '{') {
+            palette[TRANSPARENT_INDEX] = 0;
+        }
+
+        std::vector<unsigned char> texels(getChainSize(size));
+        size_t texelOffset = 0;
+        for (unsigned int level = 0; level < LEVEL_COUNT; ++level) {
+            const glm::uvec2 levelSize = getLevelSize(size, level);
+            const size_t texelCount = static_cast<size_t>(levelSize.x) * levelSize.y;
+            const size_t levelOffset = mipTexture.mipmapOffsets[level];
+            if (levelOffset + texelCount > data.size()) throw std::runtime_error("Miptex level out of bounds");
+
+            expand(palette, reinterpret_cast<const unsigned char*>(data.data() + levelOffset), texelCount, reinterpret_cast<uint32_t*>(texels.data() + texelOffset));
+            texelOffset += texelCount * CHANNEL_COUNT;
+        }
+        return texels;
+    }
+
+    void MipTextureDecoder::expand(const PaletteType& palette, const unsigned char* indices, size_t count, uint32_t* texels) {
+        size_t i = 0;
+#if QUAKE_SIMD_AVX2
+        //eight texels a step: widen eight indices to 32 bits and gather their palette entries
+        const auto* paletteData = reinterpret_cast<const int*>(palette.data());
+        for (; i + 8 <= count; i += 8) {
+            const __m256i paletteIndices = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(indices + i)));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(texels + i), _mm256_i32gather_epi32(paletteData, paletteIndices, sizeof(uint32_t)));
+        }
+#endif
+        //a table lookup per texel for the tail, and for everything on builds without AVX2
+        for (; i < count; ++i) {
+            texels[i] = palette[indices[i]];
+        }
+    }
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#ifndef QUAKE_MIPTEXTUREDECODER_HPP
+#define QUAKE_MIPTEXTUREDECODER_HPP
+
+#include <span>
+#include <array>
+#include <vector>
+#include <cstdint>
+#include <glm/glm.hpp>
+
+namespace Rendering::Scene {
+    // Expands the 8-bit palettised miptex embedded in the texture lump (four precomputed mip
+    // levels followed by a 256 colour palette) into an RGBA8 mip chain ready for a single upload.
+    struct MipTextureDecoder {
+        static const unsigned int LEVEL_COUNT = 4;
+        static const size_t PALETTE_SIZE = 256;
+        static const size_t CHANNEL_COUNT = 4;
+        //'{' textures key out the last palette entry
+        static const unsigned char TRANSPARENT_INDEX = 255;
+
+        typedef std::array<uint32_t, PALETTE_SIZE> PaletteType;
+
+        // Decodes the miptex at the start of data, which must carry its own pixels (WAD textures only
+        // have a header with zero offsets). The levels are packed back to back, largest first.
+        static std::vector<unsigned char> decode(std::span<const char> data, glm::uvec2& size);
+
+        // Size in bytes of the whole RGBA8 chain for a level 0 of the given size.
+        static size_t getChainSize(const glm::uvec2& size);
+
+        // Looks every index up in the palette, writing one RGBA8 texel each.
+        static void expand(const PaletteType& palette, const unsigned char* indices, size_t count, uint32_t* texels);
+    };
+}
+
+#endif //QUAKE_MIPTEXTUREDECODER_HPP
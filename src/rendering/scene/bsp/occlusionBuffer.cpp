@@ -0,0 +1,223 @@
+#include "occlusionBuffer.hpp"
+
+#include <array>
+#include <algorithm>
+#include <limits>
+
+#include "../../../utils/simd.hpp"
+
+namespace Rendering::Scene {
+    static const float FAR_DEPTH = 1.0f;
+    //clip space w below this counts as behind the eye
+    static const float MIN_W = 1e-4f;
+
+    OcclusionBuffer::OcclusionBuffer(unsigned int width, unsigned int height) {
+        this->tileCounts = glm::uvec2((glm::max(width, 1u) + TILE_SIZE - 1) / TILE_SIZE, (glm::max(height, 1u) + TILE_SIZE - 1) / TILE_SIZE);
+        this->size = this->tileCounts * TILE_SIZE;
+        this->hiZSize = this->size / HIZ_BLOCK_SIZE;
+        this->depth.resize(static_cast<size_t>(this->size.x) * this->size.y, FAR_DEPTH);
+        this->hiZ.resize(static_cast<size_t>(this->hiZSize.x) * this->hiZSize.y, FAR_DEPTH);
+        this->tileTriangles.resize(static_cast<size_t>(this->tileCounts.x) * this->tileCounts.y);
+    }
+
+    void OcclusionBuffer::begin(const glm::mat4& viewProjectionMatrix) {
+        this->viewProjectionMatrix = viewProjectionMatrix;
+        std::fill(this->depth.begin(), this->depth.end(), FAR_DEPTH);
+        std::fill(this->hiZ.begin(), this->hiZ.end(), FAR_DEPTH);
+        this->triangles.clear();
+        for (std::vector<uint32_t>& triangleIndices : this->tileTriangles) {
+            triangleIndices.clear();
+        }
+    }
+
+    glm::vec3 OcclusionBuffer::toScreen(const glm::vec4& clip) const {
+        const glm::vec3 ndc = glm::vec3(clip) / clip.w;
+        return {
+            ((ndc.x * 0.5f) + 0.5f) * static_cast<float>(this->size.x),
+            ((ndc.y * 0.5f) + 0.5f) * static_cast<float>(this->size.y),
+            (ndc.z * 0.5f) + 0.5f
+        };
+    }
+
+    bool OcclusionBuffer::addOccluder(std::span<const glm::vec3> polygon) {
+        if (polygon.size() < 3 || polygon.size() > MAX_POLYGON_VERTEX_COUNT) return false;
+
+        //clipping against the near plane (z >= -w) adds at most one vertex
+        std::array<glm::vec4, MAX_POLYGON_VERTEX_COUNT + 1> clipped;
+        size_t clippedCount = 0;
+        glm::vec4 previous = this->viewProjectionMatrix * glm::vec4(polygon.back(), 1.0f);
+        float previousDistance = previous.z + previous.w;
+
+        for (const glm::vec3& vertex : polygon) {
+            const glm::vec4 current = this->viewProjectionMatrix * glm::vec4(vertex, 1.0f);
+            const float currentDistance = current.z + current.w;
+
+            if ((previousDistance >= 0) != (currentDistance >= 0)) {
+                const float t = previousDistance / (previousDistance - currentDistance);
+                clipped[clippedCount++] = previous + ((current - previous) * t);
+            }
+            if (currentDistance >= 0) {
+                clipped[clippedCount++] = current;
+            }
+
+            previous = current;
+            previousDistance = currentDistance;
+        }
+
+        if (clippedCount < 3) return false;
+
+        std::array<glm::vec3, MAX_POLYGON_VERTEX_COUNT + 1> screen;
+        for (size_t i = 0; i < clippedCount; ++i) {
+            if (clipped[i].w < MIN_W) return false;
+            screen[i] = toScreen(clipped[i]);
+        }
+
+        const size_t triangleCount = this->triangles.size();
+        for (size_t i = 2; i < clippedCount; ++i) {
+            addTriangle(screen[0], screen[i - 1], screen[i]);
+        }
+        return this->triangles.size() != triangleCount;
+    }
+
+    void OcclusionBuffer::addTriangle(const glm::vec3& v0, const glm::vec3& v1, const glm::vec3& v2) {
+        float area = ((v1.x - v0.x) * (v2.y - v0.y)) - ((v1.y - v0.y) * (v2.x - v0.x));
+        if (glm::abs(area) < 1e-6f) return;
+
+        //occluders are drawn from both sides, wind everything counter-clockwise
+        const glm::vec3 a = v0;
+        const glm::vec3 b = area > 0 ? v1 : v2;
+        const glm::vec3 c = area > 0 ? v2 : v1;
+        area = glm::abs(area);
+
+        Triangle triangle;
+        const glm::vec3* vertices[3] = { &a, &b, &c };
+        for (size_t i = 0; i < 3; ++i) {
+            const glm::vec3& from = *vertices[i];
+            const glm::vec3& to = *vertices[(i + 1) % 3];
+            const float edgeA = from.y - to.y;
+            const float edgeB = to.x - from.x;
+            triangle.edges[i] = glm::vec3(edgeA, edgeB, -((edgeA * from.x) + (edgeB * from.y)));
+        }
+
+        const float dz1 = b.z - a.z;
+        const float dz2 = c.z - a.z;
+        const float depthX = ((dz1 * (c.y - a.y)) - (dz2 * (b.y - a.y))) / area;
+        const float depthY = ((dz2 * (b.x - a.x)) - (dz1 * (c.x - a.x))) / area;
+        triangle.depthPlane = glm::vec3(depthX, depthY, a.z - (depthX * a.x) - (depthY * a.y));
+
+        const glm::vec2 min = glm::min(glm::vec2(a), glm::min(glm::vec2(b), glm::vec2(c)));
+        const glm::vec2 max = glm::max(glm::vec2(a), glm::max(glm::vec2(b), glm::vec2(c)));
+        triangle.min = glm::max(glm::ivec2(glm::floor(min)), glm::ivec2(0));
+        triangle.max = glm::min(glm::ivec2(glm::ceil(max)), glm::ivec2(this->size) - 1);
+        if (triangle.min.x > triangle.max.x || triangle.min.y > triangle.max.y) return;
+
+        //bin into every tile the bounds touch
+        const auto triangleIndex = static_cast<uint32_t>(this->triangles.size());
+        this->triangles.push_back(triangle);
+        for (int tileY = triangle.min.y / static_cast<int>(TILE_SIZE); tileY <= triangle.max.y / static_cast<int>(TILE_SIZE); ++tileY) {
+            for (int tileX = triangle.min.x / static_cast<int>(TILE_SIZE); tileX <= triangle.max.x / static_cast<int>(TILE_SIZE); ++tileX) {
+                this->tileTriangles[(tileY * this->tileCounts.x) + tileX].push_back(triangleIndex);
+            }
+        }
+    }
+
+    void OcclusionBuffer::rasterize() {
+        for (unsigned int tileY = 0; tileY < this->tileCounts.y; ++tileY) {
+            for (unsigned int tileX = 0; tileX < this->tileCounts.x; ++tileX) {
+                rasterizeTile(tileX, tileY);
+            }
+        }
+        buildHiZ();
+    }
+
+    void OcclusionBuffer::rasterizeTile(unsigned int tileX, unsigned int tileY) {
+        const glm::ivec2 tileMin(tileX * TILE_SIZE, tileY * TILE_SIZE);
+        const glm::ivec2 tileMax = tileMin + glm::ivec2(TILE_SIZE - 1);
+
+        for (const uint32_t triangleIndex : this->tileTriangles[(tileY * this->tileCounts.x) + tileX]) {
+            const Triangle& triangle = this->triangles[triangleIndex];
+            //spans start on a multiple of four, tiles are a multiple of four wide so they never run over
+            const glm::ivec2 min(glm::max(triangle.min.x, tileMin.x) & ~3, glm::max(triangle.min.y, tileMin.y));
+            const glm::ivec2 max = glm::min(triangle.max, tileMax);
+
+            for (int y = min.y; y <= max.y; ++y) {
+                const float centerY = static_cast<float>(y) + 0.5f;
+                float* row = this->depth.data() + (static_cast<size_t>(y) * this->size.x);
+                const float rowEdge0 = (triangle.edges[0].y * centerY) + triangle.edges[0].z;
+                const float rowEdge1 = (triangle.edges[1].y * centerY) + triangle.edges[1].z;
+                const float rowEdge2 = (triangle.edges[2].y * centerY) + triangle.edges[2].z;
+                const float rowDepth = (triangle.depthPlane.y * centerY) + triangle.depthPlane.z;
+
+#if QUAKE_SIMD_SSE2
+                const __m128 centerOffsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+                const __m128 zero = _mm_setzero_ps();
+                for (int x = min.x; x <= max.x; x += 4) {
+                    const __m128 centerX = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), centerOffsets);
+                    const __m128 edge0 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(triangle.edges[0].x), centerX), _mm_set1_ps(rowEdge0));
+                    const __m128 edge1 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(triangle.edges[1].x), centerX), _mm_set1_ps(rowEdge1));
+                    const __m128 edge2 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(triangle.edges[2].x), centerX), _mm_set1_ps(rowEdge2));
+                    const __m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(edge0, zero), _mm_cmpge_ps(edge1, zero)), _mm_cmpge_ps(edge2, zero));
+                    if (_mm_movemask_ps(inside) == 0) continue;
+
+                    const __m128 depth = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(triangle.depthPlane.x), centerX), _mm_set1_ps(rowDepth));
+                    const __m128 current = _mm_loadu_ps(row + x);
+                    const __m128 nearest = _mm_min_ps(current, depth);
+                    _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearest), _mm_andnot_ps(inside, current)));
+                }
+#else
+                for (int x = min.x; x <= max.x; ++x) {
+                    const float centerX = static_cast<float>(x) + 0.5f;
+                    if ((triangle.edges[0].x * centerX) + rowEdge0 < 0 ||
+                        (triangle.edges[1].x * centerX) + rowEdge1 < 0 ||
+                        (triangle.edges[2].x * centerX) + rowEdge2 < 0) {
+                        continue;
+                    }
+                    row[x] = glm::min(row[x], (triangle.depthPlane.x * centerX) + rowDepth);
+                }
+#endif
+            }
+        }
+    }
+
+    void OcclusionBuffer::buildHiZ() {
+        for (unsigned int blockY = 0; blockY < this->hiZSize.y; ++blockY) {
+            for (unsigned int blockX = 0; blockX < this->hiZSize.x; ++blockX) {
+                float farthest = 0.0f;
+                for (unsigned int y = blockY * HIZ_BLOCK_SIZE; y < (blockY + 1) * HIZ_BLOCK_SIZE; ++y) {
+                    const float* row = this->depth.data() + (static_cast<size_t>(y) * this->size.x) + (blockX * HIZ_BLOCK_SIZE);
+                    farthest = glm::max(farthest, *std::max_element(row, row + HIZ_BLOCK_SIZE));
+                }
+                this->hiZ[(blockY * this->hiZSize.x) + blockX] = farthest;
+            }
+        }
+    }
+
+    bool OcclusionBuffer::isVisible(const ::Scenes::Structure::AABB3<float>& aabb) const {
+        glm::vec2 min(std::numeric_limits<float>::max());
+        glm::vec2 max(std::numeric_limits<float>::lowest());
+        float nearest = std::numeric_limits<float>::max();
+
+        for (const glm::vec3& corner : aabb.getCorners()) {
+            const glm::vec4 clip = this->viewProjectionMatrix * glm::vec4(corner, 1.0f);
+            //anything reaching past the near plane could cover the whole screen
+            if (clip.w < MIN_W || clip.z < -clip.w) return true;
+
+            const glm::vec3 screen = toScreen(clip);
+            min = glm::min(min, glm::vec2(screen));
+            max = glm::max(max, glm::vec2(screen));
+            nearest = glm::min(nearest, screen.z);
+        }
+
+        //off screen boxes are left to the frustum
+        if (max.x < 0 || max.y < 0 || min.x >= static_cast<float>(this->size.x) || min.y >= static_cast<float>(this->size.y)) return true;
+
+        const glm::ivec2 blockMin = glm::max(glm::ivec2(glm::floor(min)), glm::ivec2(0)) / static_cast<int>(HIZ_BLOCK_SIZE);
+        const glm::ivec2 blockMax = glm::min(glm::ivec2(glm::floor(max)), glm::ivec2(this->size) - 1) / static_cast<int>(HIZ_BLOCK_SIZE);
+        for (int blockY = blockMin.y; blockY <= blockMax.y; ++blockY) {
+            for (int blockX = blockMin.x; blockX <= blockMax.x; ++blockX) {
+                if (nearest <= this->hiZ[(blockY * this->hiZSize.x) + blockX]) return true;
+            }
+        }
+        return false;
+    }
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#ifndef QUAKE_OCCLUSIONBUFFER_HPP
+#define QUAKE_OCCLUSIONBUFFER_HPP
+
+#include <span>
+#include <vector>
+#include <cstdint>
+#include <glm/glm.hpp>
+
+#include "../../../scene/structure/aabb.hpp"
+
+namespace Rendering::Scene {
+    // Low resolution CPU depth buffer for occlusion culling. Occluder polygons are clipped to the
+    // near plane, binned into screen tiles and rasterized with edge functions four pixels at a
+    // time. A max-depth pyramid level (hierarchical Z) over blocks of pixels is then built, and
+    // boxes are tested against it conservatively: a box is only reported hidden when its nearest
+    // point is behind the farthest occluder depth in every block it covers. No GPU involved.
+    struct OcclusionBuffer {
+        static const unsigned int DEFAULT_WIDTH = 256;
+        static const unsigned int DEFAULT_HEIGHT = 128;
+        static const unsigned int TILE_SIZE = 32;
+        static const unsigned int HIZ_BLOCK_SIZE = 8;
+        static const size_t MAX_POLYGON_VERTEX_COUNT = 32;
+
+        // Width and height are rounded up to whole tiles.
+        explicit OcclusionBuffer(unsigned int width = DEFAULT_WIDTH, unsigned int height = DEFAULT_HEIGHT);
+
+        // Clears depth to the far plane and drops every occluder.
+        void begin(const glm::mat4& viewProjectionMatrix);
+        // Adds a convex world space polygon. Returns false if it was dropped (behind the eye, too
+        // many vertices or degenerate).
+        bool addOccluder(std::span<const glm::vec3> polygon);
+        // Rasterizes the occluders and builds the hierarchical Z.
+        void rasterize();
+        [[nodiscard]] bool isVisible(const ::Scenes::Structure::AABB3<float>& aabb) const;
+
+        [[nodiscard]] glm::uvec2 getSize() const { return this->size; }
+        [[nodiscard]] std::span<const float> getDepth() const { return this->depth; }
+        [[nodiscard]] size_t getTriangleCount() const { return this->triangles.size(); }
+
+    private:
+        // Screen space triangle: edge functions a*x + b*y + c >= 0 inside, depth = z.x*x + z.y*y + z.z.
+        struct Triangle {
+            glm::vec3 edges[3];
+            glm::vec3 depthPlane;
+            glm::ivec2 min;
+            glm::ivec2 max;
+        };
+
+        glm::uvec2 size;
+        glm::uvec2 tileCounts;
+        glm::uvec2 hiZSize;
+        glm::mat4 viewProjectionMatrix;
+        std::vector<float> depth;
+        std::vector<float> hiZ;
+        std::vector<Triangle> triangles;
+        std::vector<std::vector<uint32_t>> tileTriangles;
+
+        void addTriangle(const glm::vec3& v0, const glm::vec3& v1, const glm::vec3& v2);
+        void rasterizeTile(unsigned int tileX, unsigned int tileY);
+        void buildHiZ();
+        [[nodiscard]] glm::vec3 toScreen(const glm::vec4& clip) const;
+    };
+}
+
+#endif //QUAKE_OCCLUSIONBUFFER_HPP
@@ -0,0 +1,18 @@
+#include "visibleSurfaceList.hpp"
+
+#include <algorithm>
+
+namespace Rendering::Scene {
+    void VisibleSurfaceList::clear() {
+        this->keys.clear();
+    }
+
+    void VisibleSurfaceList::add(unsigned int textureIndex, int lightmapPageIndex, unsigned int faceIndex) {
+        const uint64_t bucket = (static_cast<uint64_t>(textureIndex) << LIGHTMAP_PAGE_BITS) | (static_cast<uint64_t>(lightmapPageIndex + 1) & LIGHTMAP_PAGE_MASK);
+        this->keys.push_back((bucket << FACE_INDEX_BITS) | faceIndex);
+    }
+
+    void VisibleSurfaceList::sortKeys() {
+        std::sort(this->keys.begin(), this->keys.end());
+    }
+}
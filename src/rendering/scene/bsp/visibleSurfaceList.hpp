@@ -0,0 +1,87 @@
+#pragma once
+
+#ifndef QUAKE_VISIBLESURFACELIST_HPP
+#define QUAKE_VISIBLESURFACELIST_HPP
+
+#include <vector>
+#include <cstdint>
+
+namespace Rendering::Scene {
+    // Per-frame list of visible BSP faces, bucketed by diffuse texture and lightmap page so that
+    // every bucket can be submitted as a single multi-draw. Storage is kept between frames.
+    struct VisibleSurfaceList {
+        struct IndexRange {
+            unsigned int start = 0;
+            unsigned int count = 0;
+        };
+
+        struct Batch {
+            unsigned int textureIndex = 0;
+            int lightmapPageIndex = 0;
+            size_t firstDraw = 0;
+            size_t drawCount = 0;
+        };
+
+        void clear();
+        void add(unsigned int textureIndex, int lightmapPageIndex, unsigned int faceIndex);
+
+        // Sorts the surfaces into batches. Index ranges that are adjacent in the index buffer are merged.
+        template<typename F>
+        void build(F&& getFaceIndexRange) {
+            sortKeys();
+            this->batches.clear();
+            this->counts.clear();
+            this->offsets.clear();
+
+            uint64_t previousBucket = ~uint64_t(0);
+            unsigned int previousEnd = 0;
+
+            for (const uint64_t key : this->keys) {
+                const IndexRange range = getFaceIndexRange(static_cast<unsigned int>(key & FACE_INDEX_MASK));
+                if (range.count == 0) continue;
+
+                const uint64_t bucket = key >> FACE_INDEX_BITS;
+                if (bucket != previousBucket) {
+                    Batch& batch = this->batches.emplace_back();
+                    batch.textureIndex = static_cast<unsigned int>(bucket >> LIGHTMAP_PAGE_BITS);
+                    batch.lightmapPageIndex = static_cast<int>(bucket & LIGHTMAP_PAGE_MASK) - 1;
+                    batch.firstDraw = this->counts.size();
+                    previousBucket = bucket;
+                } else if (range.start == previousEnd) {
+                    this->counts.back() += static_cast<int>(range.count);
+                    previousEnd += range.count;
+                    continue;
+                }
+
+                this->counts.push_back(static_cast<int>(range.count));
+                this->offsets.push_back(reinterpret_cast<const void*>(static_cast<uintptr_t>(range.start) * this->indexSize));
+                ++this->batches.back().drawCount;
+                previousEnd = range.start + range.count;
+            }
+        }
+
+        void setIndexSize(size_t indexSize) { this->indexSize = indexSize; }
+        [[nodiscard]] bool empty() const { return this->keys.empty(); }
+        [[nodiscard]] size_t getSurfaceCount() const { return this->keys.size(); }
+        [[nodiscard]] const std::vector<Batch>& getBatches() const { return this->batches; }
+        [[nodiscard]] const int* getCounts(const Batch& batch) const { return this->counts.data() + batch.firstDraw; }
+        [[nodiscard]] const void* const* getOffsets(const Batch& batch) const { return this->offsets.data() + batch.firstDraw; }
+
+    private:
+        static const int FACE_INDEX_BITS = 32;
+        static const int LIGHTMAP_PAGE_BITS = 12;
+        static const uint64_t FACE_INDEX_MASK = (uint64_t(1) << FACE_INDEX_BITS) - 1;
+        static const uint64_t LIGHTMAP_PAGE_MASK = (uint64_t(1) << LIGHTMAP_PAGE_BITS) - 1;
+
+        //texture | lightmap page + 1 | face, so sorting groups buckets and keeps faces in buffer order
+        std::vector<uint64_t> keys;
+        std::vector<Batch> batches;
+        std::vector<int> counts;
+        std::vector<const void*> offsets;
+        size_t indexSize = sizeof(unsigned int);
+
+        void sortKeys();
+    };
+}
+
+#endif //QUAKE_VISIBLESURFACELIST_HPP
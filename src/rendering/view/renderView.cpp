@@ -0,0 +1,32 @@
+#include "renderView.hpp"
+
+#include <glm/ext.hpp>
+
+namespace Rendering::View {
+    std::array<Platform::Game::Components::CameraParameters, CUBEMAP_FACE_COUNT> getCubemapCameraParameters(const glm::vec3& location, float near, float far) {
+        static const float FOV = 90.0f;
+        //forward and up of each face, as GL samples them
+        static const std::array<std::array<glm::vec3, 2>, CUBEMAP_FACE_COUNT> FACE_AXES = {{
+            { glm::vec3( 1,  0,  0), glm::vec3(0, -1,  0) },
+            { glm::vec3(-1,  0,  0), glm::vec3(0, -1,  0) },
+            { glm::vec3( 0,  1,  0), glm::vec3(0,  0,  1) },
+            { glm::vec3( 0, -1,  0), glm::vec3(0,  0, -1) },
+            { glm::vec3( 0,  0,  1), glm::vec3(0, -1,  0) },
+            { glm::vec3( 0,  0, -1), glm::vec3(0, -1,  0) }
+        }};
+
+        std::array<Platform::Game::Components::CameraParameters, CUBEMAP_FACE_COUNT> faces;
+        for (size_t i = 0; i < CUBEMAP_FACE_COUNT; ++i) {
+            const glm::vec3& forward = FACE_AXES[i][0];
+            const glm::vec3& up = FACE_AXES[i][1];
+            const glm::vec3 left = glm::cross(up, forward);
+
+            Platform::Game::Components::CameraParameters& face = faces[i];
+            face.location = location;
+            face.projectionMatrix = glm::perspective(glm::radians(FOV), 1.0f, near, far);
+            face.viewMatrix = glm::lookAt(location, location + forward, up);
+            face.frustum.set(location, left, up, forward, FOV, near, far, 1.0f);
+        }
+        return faces;
+    }
+}
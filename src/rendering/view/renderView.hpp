@@ -0,0 +1,33 @@
+#pragma once
+
+#ifndef QUAKE_RENDERVIEW_HPP
+#define QUAKE_RENDERVIEW_HPP
+
+#include <array>
+#include <glm/glm.hpp>
+#include <boost/optional.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include "../../device/gpu/gpuDefs.hpp"
+#include "../../platform/game/components/cameraParams.hpp"
+
+namespace Device::GPU::Buffers { struct FrameBuffer; }
+
+namespace Rendering::View {
+    // One of several views drawn in a single pass: a camera plus where it lands. Without a frame
+    // buffer or viewport the ones currently bound are used, so split-screen views share a target
+    // and only differ in viewport, while cubemap faces each bring their own frame buffer.
+    struct RenderView {
+        Platform::Game::Components::CameraParameters cameraParameters;
+        boost::optional<Device::GPU::GpuViewportType> viewport;
+        boost::shared_ptr<Device::GPU::Buffers::FrameBuffer> frameBuffer;
+    };
+
+    static const size_t CUBEMAP_FACE_COUNT = 6;
+
+    // Camera parameters for the six 90 degree faces of a cubemap captured at location, in GL face
+    // order (+X, -X, +Y, -Y, +Z, -Z).
+    std::array<Platform::Game::Components::CameraParameters, CUBEMAP_FACE_COUNT> getCubemapCameraParameters(const glm::vec3& location, float near, float far);
+}
+
+#endif //QUAKE_RENDERVIEW_HPP
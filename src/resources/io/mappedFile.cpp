@@ -0,0 +1,14 @@
+#include "mappedFile.hpp"
+
+namespace Resources::IO {
+    MappedFile::MappedFile(const std::string& path) :
+            source(path) {
+        if (!this->source.is_open()) throw std::runtime_error("Could not map file: " + path);
+        this->dataPtr = this->source.data();
+        this->dataSize = this->source.size();
+    }
+
+    MappedFile::MappedFile(const char* data, size_t size) :
+            dataPtr(data),
+            dataSize(size) {}
+}
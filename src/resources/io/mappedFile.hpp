@@ -0,0 +1,28 @@
+#pragma once
+
+#ifndef QUAKE_MAPPEDFILE_HPP
+#define QUAKE_MAPPEDFILE_HPP
+
+#include <span>
+#include <string>
+#include <boost/iostreams/device/mapped_file.hpp>
+
+namespace Resources::IO {
+    // Read-only view over a file's bytes. Either owns a mapping of a loose file
+    // or borrows a range of memory that is kept alive elsewhere (e.g. a mounted package).
+    struct MappedFile {
+        explicit MappedFile(const std::string& path);
+        MappedFile(const char* data, size_t size);
+
+        [[nodiscard]] const char* data() const { return this->dataPtr; }
+        [[nodiscard]] size_t size() const { return this->dataSize; }
+        [[nodiscard]] std::span<const char> span() const { return { this->dataPtr, this->dataSize }; }
+
+    private:
+        boost::iostreams::mapped_file_source source;
+        const char* dataPtr = nullptr;
+        size_t dataSize = 0;
+    };
+}
+
+#endif //QUAKE_MAPPEDFILE_HPP
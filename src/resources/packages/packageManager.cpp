@@ -46,4 +46,18 @@ namespace Resources::Packages {
         const Package& package = packages.at(file.package_name);
 		return boost::make_shared<std::istrstream>(package.mappedFileSource.data() + file.offset, file.length);
     }
+
+    IO::MappedFile PackageManager::map(const std::string& file_name) {
+        std::lock_guard<std::recursive_mutex> lock(mutex);
+        auto filesItr = files.find(file_name);
+        if (filesItr == files.end()) {
+            std::ostringstream ostringstream;
+            ostringstream << "No such file " << file_name;
+            throw std::out_of_range(ostringstream.str().c_str());
+        }
+
+        const Package::File& file = filesItr->second;
+        const Package& package = packages.at(file.package_name);
+        return { package.mappedFileSource.data() + file.offset, file.length };
+    }
 }
@@ -3,6 +3,7 @@
 #include <mutex>
 
 #include "package.hpp"
+#include "../io/mappedFile.hpp"
 
 namespace Resources::Packages {
     struct PackageManager {
@@ -10,6 +11,7 @@ namespace Resources::Packages {
         void unmountAll();
 
         boost::shared_ptr<std::istream> extract(const std::string& fileName);
+        IO::MappedFile map(const std::string& fileName);
 
     private:
         std::recursive_mutex mutex;
@@ -4,9 +4,11 @@
 #include <map>
 #include <mutex>
 #include <typeindex>
+#include <type_traits>
 #include <sstream>
 #include <boost/shared_ptr.hpp>
 #include <boost/make_shared.hpp>
+#include <boost/optional.hpp>
 #include <boost/uuid/random_generator.hpp>
 #include <boost/uuid/uuid_io.hpp>
 
@@ -30,40 +32,68 @@ namespace Resources {
         }
 
         template<typename T> requires IsResource<T>
-        boost::shared_ptr<T> get(const std::string& name) {
+        boost::shared_ptr<T> find(const std::string& name) {
             static const std::type_index TYPE_INDEX = typeid(T);
             std::lock_guard<std::recursive_mutex> lock(mutex);
             const auto typeResourcesItr = this->typeResources.find(TYPE_INDEX);
+            if (typeResourcesItr == this->typeResources.end()) return {};
 
-			if (typeResourcesItr == this->typeResources.end()) {
-				//no resources of this type have yet been allocated
-                this->typeResources.insert(std::make_pair(TYPE_INDEX, ResourceMap()));
-			}
+            const auto resourcesItr = typeResourcesItr->second.find(name);
+            if (resourcesItr == typeResourcesItr->second.end()) return {};
+
+            const boost::shared_ptr<Resource>& resource = resourcesItr->second;
+            resource->lastAccessTime = Resource::ClockType::now();
+            return boost::static_pointer_cast<T, Resource>(resource);
+        }
+
+        template<typename T> requires IsResource<T>
+        boost::shared_ptr<T> get(const std::string& name) {
+            boost::shared_ptr<T> resource = find<T>(name);
+            if (resource) return resource;
+
+            //decode without holding the lock so that other threads can load resources concurrently
+            if constexpr (std::is_constructible_v<T, const IO::MappedFile&>) {
+                //resources that decode from contiguous memory get the mapped bytes directly
+                boost::optional<IO::MappedFile> mappedFile;
+                try {
+                    mappedFile.emplace(map(name));
+                } catch (const std::out_of_range&) {
+                    mappedFile.emplace(name);
+                }
+                resource = boost::make_shared<T>(*mappedFile);
+            } else {
+                resource = boost::make_shared<T>(*open(name));
+            }
+
+            return put(name, resource);
+		}
 
+        // Opens a file from the mounted packages, falling back to the file system.
+        boost::shared_ptr<std::istream> open(const std::string& name) {
+            try {
+                return extract(name);
+            } catch (const std::out_of_range&) {
+                // TODO: not in the packs, check the file system!
+                return boost::make_shared<std::ifstream>(name, std::ios::binary);
+            }
+        }
+
+        // Registers a resource under a name. If one was registered under that name in the
+        // meantime (e.g. by another loading thread) the existing resource is returned instead.
+        template<typename T> requires IsResource<T>
+        boost::shared_ptr<T> put(const std::string& name, const boost::shared_ptr<T>& resource) {
+            static const std::type_index TYPE_INDEX = typeid(T);
+            std::lock_guard<std::recursive_mutex> lock(mutex);
             ResourceMap& resources = this->typeResources[TYPE_INDEX];
-			auto resourcesItr = resources.find(name);
+            const auto resourcesItr = resources.emplace(name, resource).first;
 
-            if (resourcesItr != resources.end()) {
-                //resource already exists
-                boost::shared_ptr<Resource>& resource = resourcesItr->second;
+            if (resourcesItr->second == resource) {
+                resource->name = name;
                 resource->lastAccessTime = Resource::ClockType::now();
-                return boost::static_pointer_cast<T, Resource>(resource);
             }
+            return boost::static_pointer_cast<T, Resource>(resourcesItr->second);
+        }
 
-			boost::shared_ptr<std::istream> istream;
-			try {
-				istream = extract(name);
-			} catch (const std::out_of_range&) {
-				// TODO: not in the packs, check the file system!
-				istream = boost::make_shared<std::ifstream>(name, std::ios::binary);
-			}
-
-            boost::shared_ptr<T> resource = boost::make_shared<T>(*istream);
-            resource->name = name;
-            resources.emplace(name, resource);
-            return resource;
-		}
-		
 		template<typename T, typename... Args>
 		boost::shared_ptr<T> make(Args&&... args) {
             boost::shared_ptr<T> resource = boost::make_shared<T>(args...);
@@ -5,10 +5,10 @@
 #include <boost/make_shared.hpp>
 
 namespace Resources {
-    Texture::Texture(Device::GPU::ColorType color_type, const glm::vec2& size, const void* data) :
+    Texture::Texture(Device::GPU::ColorType color_type, const glm::vec2& size, const void* data, unsigned int levelCount) :
             colorType(color_type),
             size(size) {
-        id = Device::GPU::gpu.createTexture(color_type, static_cast<glm::uvec2>(size), data);
+        id = Device::GPU::gpu.createTexture(color_type, static_cast<glm::uvec2>(size), data, levelCount);
     }
 
     Texture::Texture(const boost::shared_ptr<Image>& image) :
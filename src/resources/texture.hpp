@@ -18,7 +18,8 @@ namespace Resources {
         typedef int FormatType;
         typedef int TypeType;
 
-        Texture(Device::GPU::ColorType color_type, const glm::vec2& size, const void* data);
+        // data may hold a full mip chain, levelCount levels packed back to back largest first.
+        Texture(Device::GPU::ColorType color_type, const glm::vec2& size, const void* data, unsigned int levelCount = 1);
         Texture(const boost::shared_ptr<Image>& image);
         Texture(std::istream& istream);
         virtual ~Texture();
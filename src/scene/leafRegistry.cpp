@@ -0,0 +1,108 @@
+#include "leafRegistry.hpp"
+
+#include <algorithm>
+
+#include "../platform/game/objects/gameObject.hpp"
+#include "../rendering/scene/bsp/bsp.hpp"
+
+namespace Scenes {
+    //order within the lists does not matter, so removal swaps with the last entry
+    static void eraseUnordered(std::vector<uint32_t>& values, uint32_t value) {
+        auto valuesItr = std::find(values.begin(), values.end(), value);
+        if (valuesItr == values.end()) return;
+        *valuesItr = values.back();
+        values.pop_back();
+    }
+
+    void LeafRegistry::reset(const boost::shared_ptr<Rendering::Scene::BSP>& bsp) {
+        this->bsp = bsp;
+        this->leafRecords.clear();
+        this->leafRecords.resize(bsp ? bsp->getLeafCount() : 0);
+        this->unlinkedRecords.clear();
+
+        //known objects stay registered, they are relinked against the new leaves
+        for (uint32_t recordIndex = 0; recordIndex < this->records.size(); ++recordIndex) {
+            Record& record = this->records[recordIndex];
+            record.leafIndices.clear();
+            if (record.gameObject != nullptr) link(recordIndex);
+        }
+    }
+
+    bool LeafRegistry::update(GameObjectType& gameObject, const boost::optional<AABBType>& bounds) {
+        auto recordIndicesItr = this->recordIndices.find(gameObject.getId());
+        if (recordIndicesItr != this->recordIndices.end()) {
+            Record& record = this->records[recordIndicesItr->second];
+            if (record.bounds == bounds) return false;
+
+            unlink(recordIndicesItr->second);
+            record.bounds = bounds;
+            link(recordIndicesItr->second);
+            return true;
+        }
+
+        uint32_t recordIndex;
+        if (this->freeRecords.empty()) {
+            recordIndex = static_cast<uint32_t>(this->records.size());
+            this->records.emplace_back();
+        } else {
+            recordIndex = this->freeRecords.back();
+            this->freeRecords.pop_back();
+        }
+
+        Record& record = this->records[recordIndex];
+        record.gameObject = &gameObject;
+        record.bounds = bounds;
+        record.queryFrame = 0;
+        this->recordIndices.emplace(gameObject.getId(), recordIndex);
+        link(recordIndex);
+        return true;
+    }
+
+    void LeafRegistry::remove(const GameObjectType& gameObject) {
+        auto recordIndicesItr = this->recordIndices.find(gameObject.getId());
+        if (recordIndicesItr == this->recordIndices.end()) return;
+
+        const uint32_t recordIndex = recordIndicesItr->second;
+        unlink(recordIndex);
+        this->records[recordIndex].gameObject = nullptr;
+        this->records[recordIndex].bounds = boost::none;
+        this->freeRecords.push_back(recordIndex);
+        this->recordIndices.erase(recordIndicesItr);
+    }
+
+    void LeafRegistry::beginQuery() {
+        if (++this->queryFrame == 0) {
+            for (Record& record : this->records) {
+                record.queryFrame = 0;
+            }
+            this->queryFrame = 1;
+        }
+    }
+
+    void LeafRegistry::link(uint32_t recordIndex) {
+        Record& record = this->records[recordIndex];
+        if (this->bsp && record.bounds) {
+            this->bsp->getLeavesInBounds(record.bounds.get(), record.leafIndices);
+        }
+
+        if (record.leafIndices.empty()) {
+            this->unlinkedRecords.push_back(recordIndex);
+            return;
+        }
+        for (const int leafIndex : record.leafIndices) {
+            this->leafRecords[leafIndex].push_back(recordIndex);
+        }
+    }
+
+    void LeafRegistry::unlink(uint32_t recordIndex) {
+        Record& record = this->records[recordIndex];
+        if (record.leafIndices.empty()) {
+            eraseUnordered(this->unlinkedRecords, recordIndex);
+            return;
+        }
+        for (const int leafIndex : record.leafIndices) {
+            eraseUnordered(this->leafRecords[leafIndex], recordIndex);
+        }
+        record.leafIndices.clear();
+    }
+}
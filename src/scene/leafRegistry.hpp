@@ -0,0 +1,78 @@
+#pragma once
+
+#ifndef QUAKE_LEAFREGISTRY_HPP
+#define QUAKE_LEAFREGISTRY_HPP
+
+#include <vector>
+#include <cstdint>
+#include <unordered_map>
+#include <boost/optional.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include "structure/aabb.hpp"
+
+namespace Platform::Game::Objects { struct GameObject; }
+namespace Rendering::Scene { struct BSP; }
+
+namespace Scenes {
+    // Links game objects to the BSP leaves their world bounds touch, so that rendering only has to
+    // look at objects in the leaves that are visible this frame. An object is relinked only when
+    // its bounds change. Objects without bounds, or outside every leaf, are kept on an always
+    // visible list.
+    struct LeafRegistry {
+        typedef Structure::AABB3<float> AABBType;
+        typedef Platform::Game::Objects::GameObject GameObjectType;
+
+        // Drops every link and sizes the leaf lists for a new level (or none).
+        void reset(const boost::shared_ptr<Rendering::Scene::BSP>& bsp);
+
+        // Links a new object or relinks a known one. Returns false when its bounds did not change.
+        bool update(GameObjectType& gameObject, const boost::optional<AABBType>& bounds);
+        void remove(const GameObjectType& gameObject);
+
+        // Starts a query, every object is handed out at most once until the next call.
+        void beginQuery();
+
+        // Calls fn(gameObject, bounds) for the objects linked to a leaf not yet handed out this query.
+        template<typename F>
+        void forEachInLeaf(int leafIndex, F&& fn) {
+            if (leafIndex < 0 || static_cast<size_t>(leafIndex) >= this->leafRecords.size()) return;
+
+            for (const uint32_t recordIndex : this->leafRecords[leafIndex]) {
+                Record& record = this->records[recordIndex];
+                if (record.queryFrame == this->queryFrame) continue;
+                record.queryFrame = this->queryFrame;
+                fn(*record.gameObject, record.bounds.get());
+            }
+        }
+
+        // Calls fn(gameObject) for the objects that are not linked to any leaf.
+        template<typename F>
+        void forEachUnlinked(F&& fn) const {
+            for (const uint32_t recordIndex : this->unlinkedRecords) {
+                fn(*this->records[recordIndex].gameObject);
+            }
+        }
+
+    private:
+        struct Record {
+            GameObjectType* gameObject = nullptr;
+            boost::optional<AABBType> bounds;
+            std::vector<int> leafIndices;
+            uint32_t queryFrame = 0;
+        };
+
+        boost::shared_ptr<Rendering::Scene::BSP> bsp;
+        std::vector<Record> records;
+        std::vector<uint32_t> freeRecords;
+        std::unordered_map<size_t, uint32_t> recordIndices;     //game object id to record
+        std::vector<std::vector<uint32_t>> leafRecords;
+        std::vector<uint32_t> unlinkedRecords;
+        uint32_t queryFrame = 0;
+
+        void link(uint32_t recordIndex);
+        void unlink(uint32_t recordIndex);
+    };
+}
+
+#endif //QUAKE_LEAFREGISTRY_HPP
@@ -6,6 +6,12 @@
 #include "../physics/physicsSimulation.hpp"
 #include "../resources/resourceManager.hpp"
 #include "../rendering/scene/bsp/bsp.hpp"
+#include "../physics/collision.hpp"
+
+#include <algorithm>
+#include <array>
+#include <vector>
+#include <stdexcept>
 
 namespace Scenes {
     Scene::Scene() {
@@ -33,12 +39,23 @@ namespace Scenes {
             if (camera_comp) {
                 auto camera_parameters = camera_comp->getParameters(viewport);
 
-                // TODO: this is inefficient, have components
-                // register themselves with the scene
-                // and only iterate over components that can
-                // be drawn
-                for (const boost::shared_ptr<Platform::Game::Objects::GameObject>& game_object : gameObjects) {
-                    game_object->render(camera_parameters);
+                if (this->bsp) {
+                    //only objects linked to leaves in the PVS and the frustum, each checked against its own bounds
+                    this->leafRegistry.beginQuery();
+                    this->bsp->forEachLeafInView(camera_parameters, [&](int leaf_index) {
+                        this->leafRegistry.forEachInLeaf(leaf_index, [&](Platform::Game::Objects::GameObject& game_object, const Structure::AABB3<float>& bounds) {
+                            unsigned int plane_mask = Physics::FRUSTUM_PLANE_MASK_ALL;
+                            if (Physics::intersects(camera_parameters.frustum, bounds, plane_mask) == Physics::IntersectType::DISJOINT) return;
+                            game_object.render(camera_parameters);
+                        });
+                    });
+                    this->leafRegistry.forEachUnlinked([&](Platform::Game::Objects::GameObject& game_object) {
+                        game_object.render(camera_parameters);
+                    });
+                } else {
+                    for (const boost::shared_ptr<Platform::Game::Objects::GameObject>& game_object : gameObjects) {
+                        game_object->render(camera_parameters);
+                    }
                 }
             }
         }
@@ -50,10 +67,51 @@ namespace Scenes {
 
     void Scene::tick(float dt) {
         physics->step(dt);
+        if (this->bsp) this->bsp->tick(dt);
 
         for (boost::shared_ptr<Platform::Game::Objects::GameObject>& game_object : gameObjects) {
             game_object->onTick(dt);
         }
+
+        //relinks only the objects whose bounds moved
+        for (boost::shared_ptr<Platform::Game::Objects::GameObject>& game_object : gameObjects) {
+            this->leafRegistry.update(*game_object, game_object->getWorldBounds());
+        }
+
+        locateGameObjects();
+    }
+
+    void Scene::locateGameObjects() {
+        static const size_t LOCATE_BATCH_SIZE = 64;
+        if (!this->bsp) return;
+
+        std::array<glm::vec3, LOCATE_BATCH_SIZE> locations;
+        std::array<Rendering::Scene::BSP::LeafLocation, LOCATE_BATCH_SIZE> leaf_locations;
+        for (size_t begin = 0; begin < this->gameObjects.size(); begin += LOCATE_BATCH_SIZE) {
+            const size_t count = std::min(LOCATE_BATCH_SIZE, this->gameObjects.size() - begin);
+            for (size_t i = 0; i < count; ++i) {
+                locations[i] = this->gameObjects[begin + i]->pose.location;
+            }
+
+            this->bsp->locate(std::span<const glm::vec3>(locations.data(), count), std::span<Rendering::Scene::BSP::LeafLocation>(leaf_locations.data(), count));
+            for (size_t i = 0; i < count; ++i) {
+                Platform::Game::Objects::GameObject& game_object = *this->gameObjects[begin + i];
+                game_object.leafIndex = leaf_locations[i].leafIndex;
+                game_object.leafContents = static_cast<int>(leaf_locations[i].contentType);
+            }
+        }
+    }
+
+    void Scene::setBSP(const boost::shared_ptr<Rendering::Scene::BSP>& bsp) {
+        this->bsp = bsp;
+        this->leafRegistry.reset(bsp);
+        if (!bsp) {
+            for (boost::shared_ptr<Platform::Game::Objects::GameObject>& game_object : gameObjects) {
+                game_object->leafIndex = 0;
+                game_object->leafContents = -1;
+            }
+        }
+        locateGameObjects();
     }
 
     void Scene::onInputEvent(Input::InputEvent& input_event) {
@@ -66,6 +124,7 @@ namespace Scenes {
         boost::shared_ptr<Platform::Game::Objects::GameObject> game_object = boost::make_shared<Platform::Game::Objects::GameObject>();
         game_object->scene = shared_from_this();
         gameObjects.emplace_back(game_object);
+        this->leafRegistry.update(*game_object, game_object->getWorldBounds());
         return game_object;
     }
 
@@ -74,9 +133,72 @@ namespace Scenes {
         if (game_object->getScene() != shared_from_this()) {
             throw std::runtime_error("Could not get scene");
         }
+
+        //the argument may be an element of gameObjects itself, hold on to it while erasing
+        const boost::shared_ptr<Platform::Game::Objects::GameObject> removed_game_object = game_object;
+        this->leafRegistry.remove(*removed_game_object);
+        this->gameObjects.erase(std::remove(this->gameObjects.begin(), this->gameObjects.end(), removed_game_object), this->gameObjects.end());
     }
 
+    void Scene::getGameObjectsInHearing(const glm::vec3& location, std::vector<boost::shared_ptr<Platform::Game::Objects::GameObject>>& game_objects) const {
+        if (!this->bsp) {
+            game_objects.insert(game_objects.end(), this->gameObjects.begin(), this->gameObjects.end());
+            return;
+        }
+
+        const int leaf_index = this->bsp->getLeafIndexFromLocation(location);
+        for (const boost::shared_ptr<Platform::Game::Objects::GameObject>& game_object : this->gameObjects) {
+            if (this->bsp->isLeafHearableFrom(leaf_index, game_object->leafIndex)) {
+                game_objects.push_back(game_object);
+            }
+        }
+    }
+
+    static Rendering::Query::TraceResult toQueryResult(const Rendering::Scene::BSP::TraceResult& bsp_result) {
+        Rendering::Query::TraceResult trace_result;
+        trace_result.didHit = bsp_result.didHit;
+        trace_result.location = bsp_result.location;
+        trace_result.normal = bsp_result.plane.normal;
+        return trace_result;
+    }
+
+    //the level is not in the physics world, so the ray goes through the BSP first and then through
+    //the physics objects only up to the level hit, an object in front of the wall wins
     Rendering::Query::TraceResult Scene::trace(const glm::vec3& start, const glm::vec3& end) const {
-        return physics->trace(start, end);
+        if (!this->bsp) return physics->trace(start, end);
+
+        Rendering::Scene::BSP::TraceArgs args;
+        args.line = Structure::Line3<float>(start, end);
+        const Rendering::Query::TraceResult level_result = toQueryResult(this->bsp->trace(args));
+        const Rendering::Query::TraceResult object_result = physics->trace(start, level_result.didHit ? level_result.location : end);
+        return object_result.didHit ? object_result : level_result;
+    }
+
+    void Scene::trace(std::span<const Structure::Line3<float>> lines, std::span<Rendering::Query::TraceResult> results) const {
+        if (!this->bsp) {
+            physics->trace(lines, results);
+            return;
+        }
+        if (results.size() < lines.size()) throw std::runtime_error("Trace results are smaller than the trace lines");
+
+        std::vector<Rendering::Scene::BSP::TraceArgs> args(lines.size());
+        std::vector<Rendering::Scene::BSP::TraceResult> level_results(lines.size());
+        for (size_t i = 0; i < lines.size(); ++i) {
+            args[i].line = lines[i];
+        }
+        this->bsp->trace(args, level_results);
+
+        //the object rays stop at the level hits and go through the physics batch, which spreads them over the pool
+        std::vector<Structure::Line3<float>> object_lines(lines.size());
+        for (size_t i = 0; i < lines.size(); ++i) {
+            results[i] = toQueryResult(level_results[i]);
+            object_lines[i] = Structure::Line3<float>(lines[i].start, results[i].didHit ? results[i].location : lines[i].end);
+        }
+        std::vector<Rendering::Query::TraceResult> object_results(lines.size());
+        physics->trace(object_lines, object_results);
+
+        for (size_t i = 0; i < lines.size(); ++i) {
+            if (object_results[i].didHit) results[i] = object_results[i];
+        }
     }
 }
\ No newline at end of file
@@ -2,6 +2,7 @@
 
 #include <vector>
 #include <set>
+#include <span>
 #include <boost/shared_ptr.hpp>
 #include <boost/enable_shared_from_this.hpp>
 #include <glm/glm.hpp>
@@ -9,6 +10,8 @@
 #include "../logic/structures/octtree.hpp"
 #include "../platform/game/objects/gameObjectCollection.hpp"
 #include "../rendering/query/traceResult.hpp"
+#include "structure/line.hpp"
+#include "leafRegistry.hpp"
 
 namespace Platform::Game::Objects { struct GameObject; }
 namespace Device::GPU::Buffers { struct FrameBuffer; }
@@ -32,7 +35,18 @@ namespace Scenes {
 
         const boost::shared_ptr<Physics::PhysicsSimulation>& getPhysics() const { return this->physics; }
 
+        // Game objects are relinked against the new level's leaves.
+        void setBSP(const boost::shared_ptr<Rendering::Scene::BSP>& bsp);
+        const boost::shared_ptr<Rendering::Scene::BSP>& getBSP() const { return this->bsp; }
+
+        // Appends the objects that can hear a sound or event at location: those whose leaf (as of
+        // the last tick) is in the PHS of the location's leaf. Without a level everyone hears it.
+        void getGameObjectsInHearing(const glm::vec3& location, std::vector<boost::shared_ptr<Platform::Game::Objects::GameObject>>& game_objects) const;
+
+        // With a level the lines are traced through its point hull, batches through the packet
+        // walk, and physics objects in front of the level hit take precedence.
         Rendering::Query::TraceResult trace(const glm::vec3& start, const glm::vec3& end) const;
+        void trace(std::span<const Structure::Line3<float>> lines, std::span<Rendering::Query::TraceResult> results) const;
 
     private:
         friend struct GameObject;
@@ -42,5 +56,10 @@ namespace Scenes {
         boost::shared_ptr<Physics::PhysicsSimulation> physics;
         Logic::Structures::OctTree<float> octtree;
         boost::shared_ptr<Rendering::Scene::BSP> bsp;
+        //query stamps change while rendering
+        mutable LeafRegistry leafRegistry;
+
+        // Batch looks up the leaf and contents at every game object's location.
+        void locateGameObjects();
     };
 }
\ No newline at end of file
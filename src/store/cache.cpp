@@ -29,7 +29,13 @@ namespace Store {
         boost::filesystem::path file_path(CACHE_DIRECTORY);
         file_path /= file_name;
 
-        return std::make_unique<std::ifstream>(file_path.string());
+        return std::make_unique<std::ifstream>(file_path.string(), std::ios::binary);
+    }
+
+	std::string Cache::getPath(const std::string& file_name) const {
+        boost::filesystem::path file_path(CACHE_DIRECTORY);
+        file_path /= file_name;
+        return file_path.string();
     }
 
 	int Cache::put_buffer(const std::string& file_name, const void* data, size_t count) {
@@ -39,11 +45,39 @@ namespace Store {
         boost::filesystem::path file_path(CACHE_DIRECTORY);
         file_path /= file_name;
 
-        std::ofstream ofstream(file_path.c_str(), std::ios::out);
-        Resources::IO::write(ofstream, data, count);
+        try {
+            boost::filesystem::create_directories(CACHE_DIRECTORY);
+        } catch (boost::filesystem::filesystem_error& e) {
+            spdlog::error(e.what());
+        }
+
+        //the old file may still be mapped by a reader, so the blob goes to a temporary next to it and is
+        //renamed over it once complete. binary, cached blobs must round trip byte for byte
+        boost::filesystem::path temp_path(file_path);
+        temp_path += "." + boost::filesystem::unique_path().string() + ".tmp";
 
         unsigned int checksum = crc32.checksum();
-        fileChecksums.insert(std::make_pair(file_name, checksum));
+        std::ofstream ofstream(temp_path.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+        Resources::IO::write(ofstream, data, count);
+        ofstream.close();
+        if (!ofstream) {
+            spdlog::error("Could not write cache file {}", temp_path.string());
+            boost::system::error_code error_code;
+            boost::filesystem::remove(temp_path, error_code);
+            return checksum;
+        }
+
+        try {
+            boost::filesystem::rename(temp_path, file_path);
+        } catch (boost::filesystem::filesystem_error& e) {
+            spdlog::error(e.what());
+            boost::system::error_code error_code;
+            boost::filesystem::remove(temp_path, error_code);
+            return checksum;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        fileChecksums[file_name] = checksum;
         return checksum;
     }
 
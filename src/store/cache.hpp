@@ -11,6 +11,7 @@ namespace Store {
 		~Cache();
 
         [[nodiscard]] std::unique_ptr<std::ifstream> get(const std::string& file_name) const;
+        [[nodiscard]] std::string getPath(const std::string& file_name) const;
         int put_buffer(const std::string& file_name, const void* buffer, size_t count);
         int put(const std::string& file_name, const std::string& contents);
         void erase(const std::string& file_name);
@@ -3,6 +3,9 @@
 #ifndef QUAKE_FNV_HPP
 #define QUAKE_FNV_HPP
 
+#include <cstddef>
+#include <string_view>
+
 namespace Utils {
     template<typename Value>
     struct FNV1A;
@@ -36,6 +39,17 @@ namespace Utils {
 
         return hash;
     }
+
+    // Usable in constant expressions, so string keys can be hashed at compile time.
+    template<typename ValueType = unsigned int>
+    constexpr ValueType fnv1a(std::string_view string) {
+        ValueType hash = Utils::FNV1A<ValueType>::OFFSET_BASIS;
+        for (const char c : string) {
+            hash ^= static_cast<unsigned char>(c);
+            hash *= Utils::FNV1A<ValueType>::PRIME;
+        }
+        return hash;
+    }
 }
 
 #endif //QUAKE_FNV_HPP
@@ -4,6 +4,7 @@
 #define QUAKE_HASH_HPP
 
 #include <string>
+#include <string_view>
 
 #include "FNV.hpp"
 
@@ -15,8 +16,8 @@ namespace Utils {
 
         Hash(): value(0){}
 
-        explicit Hash(const StringType& string) :
-                value(fnv1a<ValueType>(reinterpret_cast<StringType::value_type*>(const_cast<StringType::value_type*>(string.c_str())), string.length())) {}
+        explicit Hash(std::string_view string) :
+                value(fnv1a<ValueType>(const_cast<char*>(string.data()), string.length())) {}
 
         Hash(Type&& copy) :
                 value(copy.value) {}
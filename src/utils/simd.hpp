@@ -0,0 +1,23 @@
+#pragma once
+
+#ifndef QUAKE_SIMD_HPP
+#define QUAKE_SIMD_HPP
+
+// SSE2 is baseline on every x86-64 target we build for (MSVC x64, clang/gcc x86-64).
+// Other targets (e.g. arm64) take the scalar fallbacks.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define QUAKE_SIMD_SSE2 1
+#include <emmintrin.h>
+#else
+#define QUAKE_SIMD_SSE2 0
+#endif
+
+// AVX2 is only used when the build enables it (-mavx2, /arch:AVX2), every AVX2 path keeps a fallback.
+#if defined(__AVX2__)
+#define QUAKE_SIMD_AVX2 1
+#include <immintrin.h>
+#else
+#define QUAKE_SIMD_AVX2 0
+#endif
+
+#endif //QUAKE_SIMD_HPP
@@ -0,0 +1,47 @@
+#include <string>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <spdlog/spdlog.h>
+
+#include "../src/core/logging/logger.hpp"
+#include "../src/resources/io/mappedFile.hpp"
+#include "../src/rendering/scene/bsp/bsp.hpp"
+#include "../src/debug/traceBenchmark.hpp"
+#include "../src/debug/occlusionBenchmark.hpp"
+
+// bspBenchmark <level.bsp> [ray count] [view count]
+// Loads the level without a GPU and runs the trace and occlusion benchmarks against it.
+int main(int argc, char** argv) {
+    static const size_t DEFAULT_RAY_COUNT = 1 << 16;
+    static const size_t DEFAULT_VIEW_COUNT = 256;
+
+    if (argc < 2) {
+        std::fprintf(stderr, "usage: %s <level.bsp> [ray count] [view count]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    const size_t rayCount = argc > 2 ? std::stoul(argv[2]) : DEFAULT_RAY_COUNT;
+    const size_t viewCount = argc > 3 ? std::stoul(argv[3]) : DEFAULT_VIEW_COUNT;
+
+    Core::Logger::init();
+
+    try {
+        Rendering::Scene::BSPLoadOptions options;
+        options.useEmbeddedTextures = true;
+        options.shouldUpload = false;
+
+        const Resources::IO::MappedFile file(argv[1]);
+        Rendering::Scene::BSP bsp(file, options);
+
+        const Debug::TraceBenchmark::Result traceResult = Debug::TraceBenchmark::run(bsp, rayCount);
+        const Debug::OcclusionBenchmark::Result occlusionResult = Debug::OcclusionBenchmark::run(bsp, viewCount);
+        if (traceResult.rayCount != rayCount || occlusionResult.visibleLeafCount > occlusionResult.pvsLeafCount) {
+            spdlog::error("Benchmark results are inconsistent");
+            return EXIT_FAILURE;
+        }
+    } catch (const std::exception& e) {
+        spdlog::error("Benchmark failed: {}", e.what());
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,152 @@
+#include "../src/device/gpu/gpuStateCache.hpp"
+
+#include <array>
+#include <stack>
+#include <cstdio>
+#include <cstdlib>
+
+#define CHECK(condition) do { if (!(condition)) { std::printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); std::exit(EXIT_FAILURE); } } while (false)
+
+using Device::GPU::GpuStateCache;
+
+namespace {
+    static const unsigned int GL_LESS = 0x0201;
+    static const unsigned int GL_LEQUAL = 0x0203;
+
+    struct DepthState {
+        bool shouldTest = false;
+        bool shouldWriteMask = true;
+        unsigned int function = GL_LESS;
+    };
+
+    //records the calls the Gpu state managers would make, in place of GL
+    struct RecordingDriver {
+        size_t callCount = 0;
+        boost::optional<bool> depthWriteMask;
+        boost::optional<std::array<bool, 4>> colorMask;
+
+        void setDepthTestEnabled(bool) { ++this->callCount; }
+        void setDepthWriteMask(bool mask) { ++this->callCount; this->depthWriteMask = mask; }
+        void setDepthFunction(unsigned int) { ++this->callCount; }
+        void setColorMask(const std::array<bool, 4>& mask) { ++this->callCount; this->colorMask = mask; }
+    };
+
+    //the same push/pop pattern as Gpu::Depth, applied through the same GpuStateCache::applyDepth
+    struct DepthManager {
+        explicit DepthManager(GpuStateCache& cache) : cache(cache) { }
+
+        GpuStateCache& cache;
+        RecordingDriver driver;
+        std::stack<DepthState> states;
+
+        void pushState(const DepthState& state) {
+            apply(state);
+            this->states.push(state);
+        }
+
+        void popState() {
+            this->states.pop();
+            apply(this->states.empty() ? DepthState() : this->states.top());
+        }
+
+        void apply(const DepthState& state) {
+            this->cache.applyDepth(this->driver, state.shouldTest, state.shouldWriteMask, state.function);
+        }
+    };
+
+    void testPushPop() {
+        GpuStateCache cache;
+        DepthManager depth(cache);
+
+        //nothing is known yet, every field goes through
+        depth.pushState({ true, true, GL_LESS });
+        CHECK(cache.getStats().appliedCount == 3);
+        CHECK(cache.getStats().skippedCount == 0);
+
+        //the same state again is dropped whole
+        depth.pushState({ true, true, GL_LESS });
+        CHECK(cache.getStats().appliedCount == 3);
+        CHECK(cache.getStats().skippedCount == 3);
+
+        //only the field that differs reaches the driver, on the push and on the pop back
+        depth.pushState({ true, false, GL_LESS });
+        CHECK(cache.getStats().appliedCount == 4);
+        CHECK(cache.getStats().skippedCount == 5);
+        depth.popState();
+        CHECK(cache.getStats().appliedCount == 5);
+        CHECK(cache.getStats().skippedCount == 7);
+
+        depth.popState();
+        CHECK(cache.getStats().appliedCount == 5);
+        CHECK(cache.getStats().skippedCount == 10);
+
+        depth.pushState({ true, true, GL_LEQUAL });
+        depth.popState();
+        CHECK(cache.getStats().appliedCount == 7);
+        CHECK(cache.getStats().skippedCount == 14);
+        CHECK(depth.driver.callCount == cache.getStats().appliedCount);
+    }
+
+    void testInvalidate() {
+        GpuStateCache cache;
+        DepthManager depth(cache);
+
+        depth.pushState({ true, true, GL_LESS });
+        cache.invalidate();
+        depth.pushState({ true, true, GL_LESS });
+        CHECK(cache.getStats().appliedCount == 6);
+        CHECK(cache.getStats().skippedCount == 0);
+        CHECK(*cache.depthFunction.get() == GL_LESS);
+    }
+
+    //popping the last frame buffer resets the masks through the cache, so pushing the masks
+    //that were set before has to reach the driver again
+    void testDefaultMasks() {
+        GpuStateCache cache;
+        DepthManager depth(cache);
+
+        depth.pushState({ true, false, GL_LESS });
+        cache.applyColorMask(depth.driver, { false, false, false, false });
+        CHECK(depth.driver.depthWriteMask == false);
+
+        cache.applyDefaultMasks(depth.driver);
+        CHECK(depth.driver.depthWriteMask == true);
+        CHECK((depth.driver.colorMask == std::array<bool, 4>{ true, true, true, true }));
+
+        const size_t callCount = depth.driver.callCount;
+        depth.pushState({ true, false, GL_LESS });
+        cache.applyColorMask(depth.driver, { false, false, false, false });
+        CHECK(depth.driver.callCount == callCount + 2);
+        CHECK(depth.driver.depthWriteMask == false);
+        CHECK((depth.driver.colorMask == std::array<bool, 4>{ false, false, false, false }));
+    }
+
+    void testFrames() {
+        GpuStateCache cache;
+
+        CHECK(cache.update(cache.unpackAlignment, 1));
+        CHECK(!cache.update(cache.unpackAlignment, 1));
+        CHECK(!cache.update(cache.unpackAlignment, 1));
+
+        cache.beginFrame();
+        CHECK(cache.getLastFrameStats().appliedCount == 1);
+        CHECK(cache.getLastFrameStats().skippedCount == 2);
+        CHECK(cache.getStats().appliedCount == 0);
+        CHECK(cache.getStats().skippedCount == 0);
+
+        //the shadow carries over between frames
+        CHECK(!cache.update(cache.unpackAlignment, 1));
+        CHECK(cache.update(cache.colorMask, { true, false, true, true }));
+        CHECK(!cache.update(cache.colorMask, { true, false, true, true }));
+        CHECK(cache.update(cache.colorMask, { true, true, true, true }));
+    }
+}
+
+int main() {
+    testPushPop();
+    testInvalidate();
+    testDefaultMasks();
+    testFrames();
+    std::printf("gpuStateCache: ok\n");
+    return EXIT_SUCCESS;
+}
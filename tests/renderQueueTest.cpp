@@ -0,0 +1,121 @@
+#include "../src/rendering/commands/renderQueue.hpp"
+
+#include <cmath>
+#include <random>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <utility>
+#include <algorithm>
+
+#define CHECK(condition) do { if (!(condition)) { std::printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); std::exit(EXIT_FAILURE); } } while (false)
+
+using Rendering::Commands::RenderKey;
+using Rendering::Commands::RenderQueue;
+using Rendering::Commands::CommandBuffer;
+
+namespace {
+    std::vector<unsigned int> executedIds;
+
+    struct IdPacket {
+        unsigned int id = 0;
+
+        static void execute(const IdPacket& packet) {
+            executedIds.push_back(packet.id);
+        }
+    };
+
+    void testKeyOrder() {
+        typedef RenderKey::Layer Layer;
+
+        //the layer wins over everything below it
+        CHECK(RenderKey::make(Layer::WORLD, 4095, 65535, 1e30f) < RenderKey::make(Layer::ENTITIES, 0, 0, 0.0f));
+        CHECK(RenderKey::make(Layer::DEBUG, 4095, 65535, 1e30f) < RenderKey::make(Layer::GUI, 0, 0, 0.0f));
+        CHECK(RenderKey::getLayer(RenderKey::make(Layer::TRANSLUCENT, 7, 9, 3.0f)) == Layer::TRANSLUCENT);
+
+        //then the program, then the texture, then the depth
+        CHECK(RenderKey::make(Layer::WORLD, 1, 65535, 1e30f) < RenderKey::make(Layer::WORLD, 2, 0, 0.0f));
+        CHECK(RenderKey::make(Layer::WORLD, 1, 1, 1e30f) < RenderKey::make(Layer::WORLD, 1, 2, 0.0f));
+        CHECK(RenderKey::make(Layer::WORLD, 1, 1, 1.0f) < RenderKey::make(Layer::WORLD, 1, 1, 2.0f));
+        CHECK(RenderKey::make(Layer::WORLD, 1, 1, 2.0f, true) < RenderKey::make(Layer::WORLD, 1, 1, 1.0f, true));
+
+        //ids are masked to their fields, they do not spill into the layer
+        CHECK(RenderKey::getLayer(RenderKey::make(Layer::WORLD, 0xFFFFFFFF, 0xFFFFFFFF, 0.0f)) == Layer::WORLD);
+
+        //behind the camera counts as distance 0
+        CHECK(RenderKey::make(Layer::WORLD, 1, 1, -5.0f) == RenderKey::make(Layer::WORLD, 1, 1, 0.0f));
+    }
+
+    void testEqualKeysKeepSubmissionOrder() {
+        RenderQueue queue;
+        CommandBuffer first;
+        CommandBuffer second;
+        const uint64_t key = RenderKey::make(RenderKey::Layer::DEBUG, 0, 0, 0.0f);
+
+        first.record(key, IdPacket{ 0 });
+        first.record(key, IdPacket{ 1 });
+        second.record(key, IdPacket{ 2 });
+        first.record(RenderKey::make(RenderKey::Layer::WORLD, 0, 0, 0.0f), IdPacket{ 3 });
+        queue.submit(first);
+        queue.submit(second);
+        CHECK(first.empty());
+        CHECK(second.empty());
+
+        executedIds.clear();
+        queue.flush();
+        CHECK((executedIds == std::vector<unsigned int>{ 3, 0, 1, 2 }));
+        CHECK(queue.getLastFlushStats().bufferCount == 2);
+        CHECK(queue.getLastFlushStats().commandCount == 4);
+
+        //everything was consumed, the next flush is empty
+        executedIds.clear();
+        queue.flush();
+        CHECK(executedIds.empty());
+        CHECK(queue.getLastFlushStats().commandCount == 0);
+    }
+
+    //keys drawn from small pools so every byte varies and equal keys are common, checked against
+    //std::stable_sort over the submission order
+    void testMatchesStableSort() {
+        static const size_t BUFFER_COUNT = 3;
+        static const size_t COMMAND_COUNT = 5000;
+
+        std::mt19937 random(1234);
+        std::uniform_int_distribution<unsigned int> layers(0, 4);
+        std::uniform_int_distribution<unsigned int> ids(0, 5);
+        std::uniform_real_distribution<float> depths(0.0f, 4.0f);
+
+        RenderQueue queue;
+        std::vector<CommandBuffer> buffers(BUFFER_COUNT);
+        std::vector<std::vector<std::pair<uint64_t, unsigned int>>> recorded(BUFFER_COUNT);
+        for (unsigned int id = 0; id < COMMAND_COUNT; ++id) {
+            const float depth = std::floor(depths(random));
+            const uint64_t key = RenderKey::make(static_cast<RenderKey::Layer>(layers(random)), ids(random) * 257, ids(random) * 4097, depth, id % 2 == 0);
+            const size_t bufferIndex = random() % BUFFER_COUNT;
+            buffers[bufferIndex].record(key, IdPacket{ id });
+            recorded[bufferIndex].emplace_back(key, id);
+        }
+
+        std::vector<std::pair<uint64_t, unsigned int>> expected;
+        for (size_t i = 0; i < BUFFER_COUNT; ++i) {
+            queue.submit(buffers[i]);
+            expected.insert(expected.end(), recorded[i].begin(), recorded[i].end());
+        }
+        std::stable_sort(expected.begin(), expected.end(), [](const auto& lhs, const auto& rhs) { return lhs.first < rhs.first; });
+
+        executedIds.clear();
+        queue.flush();
+        CHECK(executedIds.size() == expected.size());
+        for (size_t i = 0; i < expected.size(); ++i) {
+            CHECK(executedIds[i] == expected[i].second);
+        }
+    }
+}
+
+int main() {
+    testKeyOrder();
+    testEqualKeysKeepSubmissionOrder();
+    testMatchesStableSort();
+    std::printf("renderQueue: ok\n");
+    return EXIT_SUCCESS;
+}